@@ -2,6 +2,8 @@
 def generate(env, **kw):
     if not kw.get('depsOnly',0):
         env.Tool('addLibrary', library = ['pulsePhase'])
+        if env['PLATFORM'] != 'win32':
+            env.AppendUnique(LINKFLAGS = ['-pthread'])
     env.Tool('pulsarDbLib')
     env.Tool('st_appLib')
     env.Tool('st_facilitiesLib')
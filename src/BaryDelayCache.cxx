@@ -0,0 +1,225 @@
+/** \file BaryDelayCache.cxx
+    \brief Implementation of BaryDelayCache class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "BaryDelayCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "PhaseUtil.h"
+
+#include "timeSystem/BaryTimeComputer.h"
+#include "timeSystem/Duration.h"
+#include "timeSystem/ElapsedTime.h"
+#include "timeSystem/glastscorbit.h"
+
+namespace {
+
+  /// \brief Speed of light in meters per second.
+  const double s_speed_of_light = 299792458.;
+
+  /// \brief Number of rows in a window of spacecraft data read only to find rows around arrival times.
+  const long s_row_window_size = 4096;
+
+  /// \brief Length of a cell of tables of delays at the geocenter, in seconds.
+  const double s_geocentric_cell_length = 3600.;
+
+}
+
+// The geocenter moves around the solar system barycenter mainly in the orbit of the Earth-Moon barycenter, 499
+// light-seconds in radius with an angular frequency of 2 pi per year, and in the orbit around the Earth-Moon
+// barycenter, 0.0156 light-seconds in radius with an angular frequency of 2 pi per 27.3 days. Each orbit contributes
+// about 8.e-25 to the fourth derivative of the delay, and the bound leaves a margin of two orders of magnitude for
+// eccentricities, other planets and the difference between TDB and TT.
+const double BaryDelayCache::s_max_geocentric_derivative = 1.e-22;
+
+BaryDelayCache::BaryDelayCache(const std::string & sc_file_name, const std::string & sc_table_name,
+  const std::string & solar_eph, double ang_tol, double tolerance, long window_size,
+  const std::string & index_file_name, std::size_t max_num_source): m_sc_file(0), m_sc_window(nullptr),
+  m_row_window(nullptr), m_row_position(3, 0.), m_next_row_position(3, 0.),
+  m_bary_computer(timeSystem::BaryTimeComputer::getComputer(solar_eph)), m_ang_tol(ang_tol), m_tolerance(tolerance),
+  m_max_num_source(max_num_source), m_time_system_name(), m_mjd_ref_int(0), m_mjd_ref_frac(0.), m_time_origin(),
+  m_geocentric(false), m_source_dict(), m_source_queue(), m_current_source(0) {
+  if (m_tolerance < 0.) throw std::runtime_error("Tolerance of barycentric delays must be zero or positive");
+  if (0 == m_max_num_source) throw std::runtime_error("Maximum number of sources of barycentric delays must be positive");
+  if (window_size < 0) throw std::runtime_error("Number of rows of spacecraft data in memory must be zero or positive");
+
+  // Read the spacecraft file a window of rows at a time if the number of rows in a window is given.
+  if (0 < window_size) {
+    m_sc_window.reset(new ScDataWindow(sc_file_name, sc_table_name, window_size, index_file_name));
+    return;
+  }
+
+  // Open the spacecraft file, copying the names because the C interface takes non-const strings.
+  std::vector<char> sc_file_buf(sc_file_name.begin(), sc_file_name.end());
+  sc_file_buf.push_back('\0');
+  std::vector<char> sc_table_buf(sc_table_name.begin(), sc_table_name.end());
+  sc_table_buf.push_back('\0');
+  m_sc_file = glastscorbit_open(&sc_file_buf[0], &sc_table_buf[0]);
+  if (0 == m_sc_file || 0 != glastscorbit_getstatus(m_sc_file)) {
+    if (0 != m_sc_file) glastscorbit_close(m_sc_file);
+    throw std::runtime_error("Could not open spacecraft file " + sc_file_name + "[" + sc_table_name + "]");
+  }
+
+  // Find rows of the spacecraft file around arrival times by reading a window of rows at a time, if delays are
+  // tabulated.
+  if (0. < m_tolerance) {
+    try {
+      m_row_window.reset(new ScDataWindow(sc_file_name, sc_table_name, s_row_window_size, std::string()));
+    } catch (...) {
+      glastscorbit_close(m_sc_file);
+      throw;
+    }
+  }
+}
+
+BaryDelayCache::~BaryDelayCache() {
+  if (0 != m_sc_file) glastscorbit_close(m_sc_file);
+}
+
+void BaryDelayCache::setTimeOrigin(const std::string & time_system_name, const timeSystem::Mjd & mjd_ref,
+  bool geocentric) {
+  if (time_system_name != m_time_system_name || mjd_ref.m_int != m_mjd_ref_int || mjd_ref.m_frac != m_mjd_ref_frac
+    || geocentric != m_geocentric) {
+    m_time_system_name = time_system_name;
+    m_mjd_ref_int = mjd_ref.m_int;
+    m_mjd_ref_frac = mjd_ref.m_frac;
+    m_time_origin = PhaseTime(m_mjd_ref_int, m_mjd_ref_frac * PhaseTime::s_sec_per_day);
+    m_geocentric = geocentric;
+    m_source_queue.clear();
+    m_source_dict.clear();
+    m_current_source = 0;
+  }
+}
+
+timeSystem::AbsoluteTime BaryDelayCache::computeArrivalTime(double elapsed_time) const {
+  if (m_time_system_name.empty()) throw std::runtime_error("Time origin of barycentric delays has not been set");
+  return timeSystem::AbsoluteTime(m_time_system_name, timeSystem::Mjd(m_mjd_ref_int, m_mjd_ref_frac))
+    + timeSystem::ElapsedTime(m_time_system_name, timeSystem::Duration(0, elapsed_time));
+}
+
+double BaryDelayCache::computeDelay(double elapsed_time, double ra, double dec) {
+  // Compute the delay exactly if no tolerance is given.
+  if (0. == m_tolerance) return computeExactDelay(elapsed_time, ra, dec);
+
+  // Interpolate the delay from the table for the source.
+  if (0 == m_current_source || computeSeparation(m_current_source->m_ra, m_current_source->m_dec, ra, dec) > m_ang_tol) {
+    m_current_source = &findSource(ra, dec);
+  }
+  return m_current_source->m_table->compute(elapsed_time);
+}
+
+double BaryDelayCache::computeSeparation(double ra1, double dec1, double ra2, double dec2) {
+  const double deg_to_rad = pulsePhaseUtil::s_deg_to_rad;
+  double sin_half_ddec = std::sin((dec2 - dec1) * deg_to_rad * .5);
+  double sin_half_dra = std::sin((ra2 - ra1) * deg_to_rad * .5);
+  double hav = sin_half_ddec * sin_half_ddec + std::cos(dec1 * deg_to_rad) * std::cos(dec2 * deg_to_rad) * sin_half_dra * sin_half_dra;
+  return 2. * std::asin(std::sqrt(std::min(hav, 1.))) / deg_to_rad;
+}
+
+double BaryDelayCache::computeExactDelay(double elapsed_time, double ra, double dec) const {
+  // Get the spacecraft position at the arrival time, or leave the position at the geocenter for geocentric times.
+  std::vector<double> sc_position(3, 0.);
+  int status = 0;
+  if (!m_geocentric) {
+    if (0 != m_sc_window.get()) m_sc_window->computePosition(elapsed_time, sc_position);
+    else status = glastscorbit_calcpos(m_sc_file, elapsed_time, &sc_position[0]);
+  }
+  if (0 != status) {
+    std::ostringstream os;
+    os << "Could not get spacecraft position for mission elapsed time " << elapsed_time << " (status " << status << ")";
+    throw std::runtime_error(os.str());
+  }
+
+  // Compute the barycentric arrival time, and return its offset from the sum of the reference MJD and the mission
+  // elapsed time.
+  timeSystem::AbsoluteTime bary_time = computeArrivalTime(elapsed_time);
+  m_bary_computer.computeBaryTime(ra, dec, sc_position, bary_time);
+  return (PhaseTime::create(bary_time) - m_time_origin) - elapsed_time;
+}
+
+DelayTable::Interval BaryDelayCache::computeInterval(double elapsed_time) {
+  // Divide time into cells of equal length for arrival times at the geocenter.
+  DelayTable::Interval interval = { 0., 0., s_max_geocentric_derivative };
+  if (m_geocentric) {
+    interval.m_start = std::floor(elapsed_time / s_geocentric_cell_length) * s_geocentric_cell_length;
+    interval.m_stop = interval.m_start + s_geocentric_cell_length;
+    return interval;
+  }
+
+  // Find the rows of the spacecraft file between which the spacecraft position is interpolated.
+  ScDataWindow & row_window(0 != m_sc_window.get() ? *m_sc_window : *m_row_window);
+  double next_time = 0.;
+  row_window.findRowInterval(elapsed_time, interval.m_start, interval.m_stop, next_time, m_row_position,
+    m_next_row_position);
+
+  // The position x(t) = x0 + (t - t0) v is interpolated linearly between the rows, and scaled to the distance
+  // r(t) = r0 + (t - t0) r' interpolated linearly, where t0, x0 and r0 are the time, the position and the distance in
+  // the first row. The n-th derivative of 1 / |x| is at most n! |v|^n / |x|^(n + 1) in magnitude, as seen from the
+  // generating function of Legendre polynomials. With w = |v| / |x|, the third and the fourth derivatives of x / |x|
+  // are then at most 12 w^3 and 48 w^4 in magnitude, respectively, and the fourth derivative of r x / |x| is at most
+  // 48 r w^4 + 48 |r'| w^3 in magnitude. The bound is evaluated with the maximum of r and the minimum of |x| over
+  // the interval, and divided by the speed of light to obtain that of the delay.
+  double row_span = next_time - interval.m_start;
+  double velocity[3] = { 0., 0., 0. };
+  double radius0 = 0.;
+  double radius1 = 0.;
+  double speed2 = 0.;
+  double dot_product = 0.;
+  for (int axis = 0; axis < 3; ++axis) {
+    if (row_span > 0.) velocity[axis] = (m_next_row_position[axis] - m_row_position[axis]) / row_span;
+    radius0 += m_row_position[axis] * m_row_position[axis];
+    radius1 += m_next_row_position[axis] * m_next_row_position[axis];
+    speed2 += velocity[axis] * velocity[axis];
+    dot_product += m_row_position[axis] * velocity[axis];
+  }
+  radius0 = std::sqrt(radius0);
+  radius1 = std::sqrt(radius1);
+  double radial_speed = (row_span > 0. ? (radius1 - radius0) / row_span : 0.);
+  double max_radius = std::max(radius0, std::fabs(radius0 + (interval.m_stop - interval.m_start) * radial_speed));
+  if (speed2 > 0.) {
+    double min_elapsed = std::min(std::max(-dot_product / speed2, 0.), interval.m_stop - interval.m_start);
+    double min_distance2 = 0.;
+    for (int axis = 0; axis < 3; ++axis) {
+      double position = m_row_position[axis] + min_elapsed * velocity[axis];
+      min_distance2 += position * position;
+    }
+    double ww = std::sqrt(speed2 / min_distance2);
+    interval.m_max_derivative += 48. * (max_radius * ww + std::fabs(radial_speed)) * ww * ww * ww / s_speed_of_light;
+  }
+  return interval;
+}
+
+BaryDelayCache::Source & BaryDelayCache::findSource(double ra, double dec) {
+  // Search sources whose declinations are within the angular tolerance, because the angular separation of two
+  // positions is never smaller than the difference of their declinations.
+  SourceDict::iterator itor_end = m_source_dict.upper_bound(dec + m_ang_tol);
+  for (SourceDict::iterator itor = m_source_dict.lower_bound(dec - m_ang_tol); itor != itor_end; ++itor) {
+    if (computeSeparation(itor->second->m_ra, itor->second->m_dec, ra, dec) <= m_ang_tol) return *itor->second;
+  }
+
+  // Discard the oldest source if the number of sources would exceed the limit.
+  if (m_source_queue.size() >= m_max_num_source) {
+    if (m_source_queue.front()->second.get() == m_current_source) m_current_source = 0;
+    m_source_dict.erase(m_source_queue.front());
+    m_source_queue.pop_front();
+  }
+
+  // Add a source with an empty table of delays.
+  std::unique_ptr<Source> source(new Source);
+  source->m_ra = ra;
+  source->m_dec = dec;
+  source->m_table.reset(new DelayTable([this, ra, dec](double elapsed_time) {
+    return computeExactDelay(elapsed_time, ra, dec);
+  }, [this](double elapsed_time) {
+    return computeInterval(elapsed_time);
+  }, m_tolerance));
+  SourceDict::iterator itor = m_source_dict.insert(std::make_pair(dec, std::move(source)));
+  m_source_queue.push_back(itor);
+  return *itor->second;
+}
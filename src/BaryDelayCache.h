@@ -0,0 +1,155 @@
+/** \file BaryDelayCache.h
+    \brief Declaration of BaryDelayCache class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_BaryDelayCache_h
+#define pulsePhase_BaryDelayCache_h
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DelayTable.h"
+#include "PhaseTime.h"
+#include "ScDataWindow.h"
+
+#include "timeSystem/AbsoluteTime.h"
+
+extern "C" {
+  typedef struct GlastScFile GlastScFile;
+}
+
+namespace timeSystem {
+  class BaryTimeComputer;
+}
+
+/** \class BaryDelayCache
+    \brief Cache of barycentric delays of photon arrival times, as a function of arrival time at the spacecraft in
+           mission elapsed time. A delay here is the number of seconds to be added to the sum of the reference MJD and
+           the mission elapsed time, in order to obtain the barycentric arrival time in TDB. It consists of the
+           barycentric correction and the difference between TDB and the time system of the mission elapsed time.
+           Because the delay varies smoothly over the spacecraft orbit, it is tabulated per source position by
+           a DelayTable object, so that the delay for an event is interpolated within a given tolerance instead of
+           being computed from the spacecraft position and the solar system ephemeris every time. Spacecraft
+           positions are read from the whole spacecraft file by glastscorbit functions, or a window of rows at a time
+           by an ScDataWindow object if the number of rows in a window is given. Cells of the tables are the
+           intervals between rows of the spacecraft file, because the spacecraft position interpolated between two
+           rows changes its velocity abruptly at every row. In each interval, the fourth derivative of the delay is
+           bounded by the sum of a bound for the motion of the geocenter and a bound for the spacecraft position
+           interpolated between the two rows, which is derived from the positions in the rows. The rows are found by
+           an ScDataWindow object, also when spacecraft positions are computed by glastscorbit functions. Tables are
+           kept for a limited number of source positions, looked up by declination, and the oldest table is discarded
+           when a new position would exceed the limit, so that a source moving on the sky does not make the cache grow
+           without bound.
+*/
+class BaryDelayCache {
+  public:
+    /** \brief Construct a BaryDelayCache object.
+        \param sc_file_name Name of spacecraft file.
+        \param sc_table_name Name of the table in the spacecraft file.
+        \param solar_eph Name of solar system ephemeris.
+        \param ang_tol Angular tolerance in degrees, within which two source positions are considered the same.
+        \param tolerance Maximum error of interpolated delays in seconds. Delays are computed exactly if zero.
+        \param window_size Number of rows of the spacecraft file kept in memory, or zero to load the whole file.
+        \param index_file_name Name of the time index file of the spacecraft file, or an empty string for no file.
+        \param max_num_source Maximum number of source positions for which tables of delays are kept.
+    */
+    BaryDelayCache(const std::string & sc_file_name, const std::string & sc_table_name, const std::string & solar_eph,
+      double ang_tol, double tolerance, long window_size = 0, const std::string & index_file_name = std::string(),
+      std::size_t max_num_source = 256);
+
+    /// \brief Destruct this BaryDelayCache object.
+    ~BaryDelayCache();
+
+    /** \brief Set the time system and the reference MJD of mission elapsed times given to this object, and whether
+               the arrival times are at the geocenter instead of the spacecraft. All cached delays are discarded if
+               they are different from those currently set.
+        \param time_system_name Name of the time system of arrival times.
+        \param mjd_ref Reference MJD of mission elapsed times.
+        \param geocentric Whether arrival times are at the geocenter. The spacecraft file is not used if true.
+    */
+    void setTimeOrigin(const std::string & time_system_name, const timeSystem::Mjd & mjd_ref, bool geocentric = false);
+
+    /** \brief Compute the barycentric delay for the given arrival time and source position, in seconds.
+        \param elapsed_time Arrival time at the spacecraft in mission elapsed time, in seconds.
+        \param ra Right ascension of the source in degrees.
+        \param dec Declination of the source in degrees.
+    */
+    double computeDelay(double elapsed_time, double ra, double dec);
+
+    /** \brief Bound of the absolute value of the fourth derivative of barycentric delays at the geocenter, in
+               seconds per second to the fourth, which also bounds that of the difference between TDB and TT.
+    */
+    static const double s_max_geocentric_derivative;
+
+    /** \brief Compute the angular separation between two positions on the sky, in degrees.
+        \param ra1 Right ascension of the first position in degrees.
+        \param dec1 Declination of the first position in degrees.
+        \param ra2 Right ascension of the second position in degrees.
+        \param dec2 Declination of the second position in degrees.
+    */
+    static double computeSeparation(double ra1, double dec1, double ra2, double dec2);
+
+  private:
+    /// \brief Source position and the table of delays computed for it.
+    struct Source {
+      double m_ra;
+      double m_dec;
+      std::unique_ptr<DelayTable> m_table;
+    };
+
+    typedef std::multimap<double, std::unique_ptr<Source> > SourceDict;
+    typedef std::deque<SourceDict::iterator> SourceQueue;
+
+    GlastScFile * m_sc_file;
+    std::unique_ptr<ScDataWindow> m_sc_window;
+    std::unique_ptr<ScDataWindow> m_row_window;
+    std::vector<double> m_row_position;
+    std::vector<double> m_next_row_position;
+    const timeSystem::BaryTimeComputer & m_bary_computer;
+    double m_ang_tol;
+    double m_tolerance;
+    std::size_t m_max_num_source;
+    std::string m_time_system_name;
+    long m_mjd_ref_int;
+    double m_mjd_ref_frac;
+    PhaseTime m_time_origin;
+    bool m_geocentric;
+    SourceDict m_source_dict;
+    SourceQueue m_source_queue;
+    Source * m_current_source;
+
+    /** \brief Compute an arrival time at the spacecraft from the given mission elapsed time.
+        \param elapsed_time Mission elapsed time in seconds.
+    */
+    timeSystem::AbsoluteTime computeArrivalTime(double elapsed_time) const;
+
+    /** \brief Compute the barycentric delay for the given arrival time and source position exactly.
+        \param elapsed_time Arrival time at the spacecraft in mission elapsed time, in seconds.
+        \param ra Right ascension of the source in degrees.
+        \param dec Declination of the source in degrees.
+    */
+    double computeExactDelay(double elapsed_time, double ra, double dec) const;
+
+    /** \brief Compute the interval of time containing the given arrival time in which the delay is smooth, and a
+               bound of the absolute value of the fourth derivative of the delay in it, for any source position.
+        \param elapsed_time Arrival time at the spacecraft in mission elapsed time, in seconds.
+    */
+    DelayTable::Interval computeInterval(double elapsed_time);
+
+    /** \brief Find the source within the angular tolerance from the given position, or add one if not found,
+               discarding the oldest source if the number of sources would exceed the limit.
+        \param ra Right ascension of the source in degrees.
+        \param dec Declination of the source in degrees.
+    */
+    Source & findSource(double ra, double dec);
+
+    // Prohibit copying.
+    BaryDelayCache(const BaryDelayCache &);
+    BaryDelayCache & operator =(const BaryDelayCache &);
+};
+
+#endif
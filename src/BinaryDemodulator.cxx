@@ -0,0 +1,130 @@
+/** \file BinaryDemodulator.cxx
+    \brief Implementation of BinaryDemodulator class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "BinaryDemodulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+#include "pulsarDb/EphChooser.h"
+#include "pulsarDb/EphComputer.h"
+#include "pulsarDb/OrbitalEph.h"
+
+#include "timeSystem/AbsoluteTime.h"
+#include "timeSystem/ElapsedTime.h"
+
+namespace {
+
+  /// \brief Maximum distance in seconds between two events, over which the delay of one is extrapolated to the other.
+  const double s_max_extrapolation = 60.;
+
+  /// \brief Margin in seconds around boundaries of validity windows, within which an ephemeris is always chosen anew.
+  const double s_segment_guard = 1.;
+
+  /// \brief Compare two PhaseTime objects in time order.
+  bool isEarlier(const PhaseTime & time1, const PhaseTime & time2) {
+    return time1 - time2 < 0.;
+  }
+
+}
+
+BinaryDemodulator::BinaryDemodulator(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser,
+  double tolerance, int max_iteration): m_computer(computer), m_chooser(chooser), m_tolerance(tolerance),
+  m_max_iteration(max_iteration), m_last_eph(0), m_last_time(), m_last_delay(0.), m_last_slope(0.), m_eph_cont(0),
+  m_num_eph(0), m_boundary_cont(), m_in_segment(false), m_segment_start(), m_segment_stop() {}
+
+void BinaryDemodulator::demodulate(PhaseTime & time) {
+  // Choose an orbital ephemeris for the arrival time, as EphComputer::demodulateBinary method does, unless the arrival
+  // time is still in the segment of the last choice. The arrival time in AbsoluteTime is kept for the first iteration.
+  std::unique_ptr<timeSystem::AbsoluteTime> arrival_time(nullptr);
+  bool reuse = (m_in_segment && &m_computer.getOrbitalEphCont() == m_eph_cont
+    && m_computer.getOrbitalEphCont().size() == m_num_eph && isEarlier(m_segment_start, time)
+    && isEarlier(time, m_segment_stop));
+  if (!reuse) arrival_time.reset(new timeSystem::AbsoluteTime(time.getAbsoluteTime()));
+  const pulsarDb::OrbitalEph & eph(reuse ? *m_last_eph : chooseEph(time, *arrival_time));
+
+  // Start from the solution for the previous event, extrapolated if the previous event is close in time.
+  double delay = 0.;
+  if (&eph == m_last_eph) {
+    double distance = time - m_last_time;
+    delay = m_last_delay;
+    if (std::fabs(distance) <= s_max_extrapolation) delay += m_last_slope * distance;
+  }
+
+  // Iterate until the orbital delay converges.
+  bool converged = false;
+  for (int iteration = 0; !converged && iteration < m_max_iteration; ++iteration) {
+    double new_delay = 0.;
+    if (0. == delay && arrival_time.get()) {
+      new_delay = computeDelay(eph, *arrival_time);
+    } else {
+      PhaseTime emission_time(time);
+      emission_time += -delay;
+      new_delay = computeDelay(eph, emission_time.getAbsoluteTime());
+    }
+    converged = (std::fabs(new_delay - delay) < m_tolerance);
+    delay = new_delay;
+  }
+  if (!converged) {
+    m_in_segment = false;
+    throw std::runtime_error("Binary demodulation did not converge");
+  }
+
+  // Remember the solution, and the rate of change of the delay if the previous event is close in time.
+  double distance = (&eph == m_last_eph ? time - m_last_time : 0.);
+  if (&eph != m_last_eph || std::fabs(distance) > s_max_extrapolation) m_last_slope = 0.;
+  else if (0. != distance) m_last_slope = (delay - m_last_delay) / distance;
+  m_last_eph = &eph;
+  m_last_time = time;
+  m_last_delay = delay;
+
+  time += -delay;
+}
+
+const pulsarDb::OrbitalEph & BinaryDemodulator::chooseEph(const PhaseTime & time,
+  const timeSystem::AbsoluteTime & abs_time) {
+  const pulsarDb::OrbitalEphCont & eph_cont(m_computer.getOrbitalEphCont());
+  const pulsarDb::OrbitalEph & eph(m_chooser.choose(eph_cont, abs_time));
+
+  // Collect boundaries of validity windows in time order, if not yet collected for the current ephemerides.
+  if (&eph_cont != m_eph_cont || eph_cont.size() != m_num_eph) {
+    m_eph_cont = &eph_cont;
+    m_num_eph = eph_cont.size();
+    m_boundary_cont.clear();
+    for (pulsarDb::OrbitalEphCont::const_iterator itor = eph_cont.begin(); itor != eph_cont.end(); ++itor) {
+      m_boundary_cont.push_back(PhaseTime::create((*itor)->getValidSince()));
+      m_boundary_cont.push_back(PhaseTime::create((*itor)->getValidUntil()));
+    }
+    std::sort(m_boundary_cont.begin(), m_boundary_cont.end(), isEarlier);
+  }
+
+  // Remember the segment that contains the arrival time, if the chosen ephemeris is valid throughout the segment,
+  // because the set of ephemerides valid at a time, hence the ephemeris to be chosen, does not change within it.
+  m_in_segment = false;
+  std::vector<PhaseTime>::const_iterator boundary_itor =
+    std::upper_bound(m_boundary_cont.begin(), m_boundary_cont.end(), time, isEarlier);
+  if (boundary_itor != m_boundary_cont.begin() && boundary_itor != m_boundary_cont.end()) {
+    PhaseTime segment_start(*(boundary_itor - 1));
+    PhaseTime segment_stop(*boundary_itor);
+    if (!isEarlier(segment_start, PhaseTime::create(eph.getValidSince()))
+      && !isEarlier(PhaseTime::create(eph.getValidUntil()), segment_stop)) {
+      m_segment_start = segment_start;
+      m_segment_start += s_segment_guard;
+      m_segment_stop = segment_stop;
+      m_segment_stop += -s_segment_guard;
+      m_in_segment = (isEarlier(m_segment_start, time) && isEarlier(time, m_segment_stop));
+    }
+  }
+
+  return eph;
+}
+
+double BinaryDemodulator::computeDelay(const pulsarDb::OrbitalEph & eph, const timeSystem::AbsoluteTime & time) const {
+  double delay = 0.;
+  eph.calcOrbitalDelay(time).computeDuration("Sec", delay);
+  return delay;
+}
@@ -0,0 +1,78 @@
+/** \file BinaryDemodulator.h
+    \brief Declaration of BinaryDemodulator class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_BinaryDemodulator_h
+#define pulsePhase_BinaryDemodulator_h
+
+#include <vector>
+
+#include "PhaseTime.h"
+
+namespace pulsarDb {
+  class EphChooser;
+  class EphComputer;
+  class OrbitalEph;
+}
+
+namespace timeSystem {
+  class AbsoluteTime;
+}
+
+/** \class BinaryDemodulator
+    \brief Binary demodulation of a sequence of event times, which solves the equation of an emission time t,
+           t + d(t) = T, for an arrival time T and the orbital delay d(t), by fixed-point iteration. The iteration for
+           an event is started from the solution for the previous event, extrapolated to the arrival time of the event,
+           so that only one or two evaluations of the orbital model are needed per event when events are in time order.
+           The chosen ephemeris is reused without converting the arrival time to AbsoluteTime while arrival times stay
+           well inside the same segment of time, bounded by the start and the stop of validity windows of all orbital
+           ephemerides, so that an event time is converted to AbsoluteTime only once per evaluation of the orbital model.
+*/
+class BinaryDemodulator {
+  public:
+    /** \brief Construct a BinaryDemodulator object.
+        \param computer EphComputer whose orbital ephemerides are used.
+        \param chooser Ephemeris chooser to choose an orbital ephemeris for an arrival time.
+        \param tolerance Tolerance of the orbital delay in seconds, below which the iteration is considered converged.
+        \param max_iteration Maximum number of iterations per event.
+    */
+    BinaryDemodulator(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser,
+      double tolerance = 10.e-9, int max_iteration = 100);
+
+    /** \brief Demodulate the given event time in place, replacing its arrival time with its emission time.
+        \param time Event time to demodulate.
+    */
+    void demodulate(PhaseTime & time);
+
+  private:
+    const pulsarDb::EphComputer & m_computer;
+    const pulsarDb::EphChooser & m_chooser;
+    double m_tolerance;
+    int m_max_iteration;
+    const pulsarDb::OrbitalEph * m_last_eph;
+    PhaseTime m_last_time;
+    double m_last_delay;
+    double m_last_slope;
+    const std::vector<pulsarDb::OrbitalEph *> * m_eph_cont;
+    std::vector<pulsarDb::OrbitalEph *>::size_type m_num_eph;
+    std::vector<PhaseTime> m_boundary_cont;
+    bool m_in_segment;
+    PhaseTime m_segment_start;
+    PhaseTime m_segment_stop;
+
+    /** \brief Choose an orbital ephemeris for the given arrival time, and remember the segment of time in which the
+               same ephemeris is chosen, if any.
+        \param time Arrival time.
+        \param abs_time Arrival time in AbsoluteTime.
+    */
+    const pulsarDb::OrbitalEph & chooseEph(const PhaseTime & time, const timeSystem::AbsoluteTime & abs_time);
+
+    /** \brief Compute the orbital delay at the given emission time, in seconds.
+        \param eph Orbital ephemeris to compute the delay with.
+        \param time Emission time.
+    */
+    double computeDelay(const pulsarDb::OrbitalEph & eph, const timeSystem::AbsoluteTime & time) const;
+};
+
+#endif
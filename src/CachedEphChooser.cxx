@@ -0,0 +1,116 @@
+/** \file CachedEphChooser.cxx
+    \brief Implementation of CachedEphChooser class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "CachedEphChooser.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "pulsarDb/OrbitalEph.h"
+#include "pulsarDb/PulsarEph.h"
+
+CachedEphChooser::CachedEphChooser(const pulsarDb::EphChooser & chooser, const timeSystem::ElapsedTime & guard):
+  m_chooser(chooser.clone()), m_guard(guard), m_statistics(new Statistics), m_pulsar_index(), m_orbital_index() {
+  m_statistics->m_num_call = 0;
+  m_statistics->m_num_search = 0;
+}
+
+CachedEphChooser::CachedEphChooser(const CachedEphChooser & other): pulsarDb::EphChooser(other),
+  m_chooser(other.m_chooser->clone()), m_guard(other.m_guard), m_statistics(other.m_statistics), m_pulsar_index(),
+  m_orbital_index() {}
+
+CachedEphChooser::~CachedEphChooser() {}
+
+const pulsarDb::PulsarEph & CachedEphChooser::choose(const pulsarDb::PulsarEphCont & ephemerides,
+  const timeSystem::AbsoluteTime & t) const {
+  return chooseEph(ephemerides, t, m_pulsar_index);
+}
+
+const pulsarDb::OrbitalEph & CachedEphChooser::choose(const pulsarDb::OrbitalEphCont & ephemerides,
+  const timeSystem::AbsoluteTime & t) const {
+  return chooseEph(ephemerides, t, m_orbital_index);
+}
+
+pulsarDb::EphChooser * CachedEphChooser::clone() const {
+  return new CachedEphChooser(*this);
+}
+
+void CachedEphChooser::examinePulsarEph(const pulsarDb::PulsarEphCont & ephemerides, const timeSystem::AbsoluteTime & start_time,
+  const timeSystem::AbsoluteTime & stop_time, pulsarDb::EphStatusCont & eph_status) const {
+  m_chooser->examinePulsarEph(ephemerides, start_time, stop_time, eph_status);
+}
+
+long CachedEphChooser::getNumCall() const {
+  return m_statistics->m_num_call;
+}
+
+long CachedEphChooser::getNumSearch() const {
+  return m_statistics->m_num_search;
+}
+
+template <typename EphType>
+const EphType & CachedEphChooser::chooseEph(const std::vector<EphType *> & ephemerides, const timeSystem::AbsoluteTime & t,
+  SegmentIndex<EphType> & index) const {
+  m_statistics->m_num_call.fetch_add(1, std::memory_order_relaxed);
+
+  // Rebuild the index if it was built for other ephemerides.
+  if (index.m_eph_cont != &ephemerides || index.m_num_eph != ephemerides.size()) buildIndex(ephemerides, index);
+
+  // Return the last choice if the given time is still in the segment of the last choice.
+  if (index.m_segment >= 0) {
+    const std::pair<timeSystem::AbsoluteTime, timeSystem::AbsoluteTime> & inner(index.m_inner_cont[index.m_segment]);
+    if (inner.first < t && t < inner.second) return *index.m_eph;
+  }
+
+  // Delegate the choice to the chooser.
+  m_statistics->m_num_search.fetch_add(1, std::memory_order_relaxed);
+  index.m_segment = -1;
+  index.m_eph = 0;
+  const EphType & eph(m_chooser->choose(ephemerides, t));
+
+  // Remember the choice if the given time is well inside a segment covered by a validity window. Note that the choice
+  // may vary within a segment that is not covered by any validity window, depending on the rules of the chooser.
+  typename std::vector<timeSystem::AbsoluteTime>::const_iterator boundary_itor =
+    std::upper_bound(index.m_boundary_cont.begin(), index.m_boundary_cont.end(), t);
+  if (boundary_itor != index.m_boundary_cont.begin() && boundary_itor != index.m_boundary_cont.end()) {
+    long segment = (boundary_itor - index.m_boundary_cont.begin()) - 1;
+    const std::pair<timeSystem::AbsoluteTime, timeSystem::AbsoluteTime> & inner(index.m_inner_cont[segment]);
+    if (index.m_covered_cont[segment] && inner.first < t && t < inner.second) {
+      index.m_segment = segment;
+      index.m_eph = &eph;
+    }
+  }
+
+  return eph;
+}
+
+template <typename EphType>
+void CachedEphChooser::buildIndex(const std::vector<EphType *> & ephemerides, SegmentIndex<EphType> & index) const {
+  typedef typename std::vector<EphType *>::const_iterator eph_itor_type;
+
+  index = SegmentIndex<EphType>();
+  index.m_eph_cont = &ephemerides;
+  index.m_num_eph = ephemerides.size();
+
+  // Collect boundaries of validity windows in time order.
+  for (eph_itor_type itor = ephemerides.begin(); itor != ephemerides.end(); ++itor) {
+    index.m_boundary_cont.push_back((*itor)->getValidSince());
+    index.m_boundary_cont.push_back((*itor)->getValidUntil());
+  }
+  std::sort(index.m_boundary_cont.begin(), index.m_boundary_cont.end());
+
+  // Compute the inner part of each segment, and determine whether the segment is covered by a validity window.
+  for (std::vector<timeSystem::AbsoluteTime>::size_type ii = 1; ii < index.m_boundary_cont.size(); ++ii) {
+    const timeSystem::AbsoluteTime & segment_start(index.m_boundary_cont[ii - 1]);
+    const timeSystem::AbsoluteTime & segment_stop(index.m_boundary_cont[ii]);
+    index.m_inner_cont.push_back(std::make_pair(segment_start + m_guard, segment_stop - m_guard));
+
+    bool covered = false;
+    for (eph_itor_type itor = ephemerides.begin(); !covered && itor != ephemerides.end(); ++itor) {
+      covered = ((*itor)->getValidSince() <= segment_start && segment_stop <= (*itor)->getValidUntil());
+    }
+    index.m_covered_cont.push_back(covered);
+  }
+}
@@ -0,0 +1,123 @@
+/** \file CachedEphChooser.h
+    \brief Declaration of CachedEphChooser class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_CachedEphChooser_h
+#define pulsePhase_CachedEphChooser_h
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "pulsarDb/EphChooser.h"
+
+#include "timeSystem/AbsoluteTime.h"
+#include "timeSystem/ElapsedTime.h"
+
+/** \class CachedEphChooser
+    \brief Ephemeris chooser which remembers the ephemeris chosen last time, and returns it without a search as long as
+           a given time stays in the same segment of time. Segments of time are bounded by the start and the stop of
+           validity windows of all ephemerides, so that the set of ephemerides valid at a time, hence the ephemeris to
+           be chosen, does not change within a segment. The search itself is delegated to another chooser, whose rules
+           of choice are therefore preserved.
+*/
+class CachedEphChooser : public pulsarDb::EphChooser {
+  public:
+    /** \brief Construct a CachedEphChooser object.
+        \param chooser Ephemeris chooser to which a search for an ephemeris is delegated.
+        \param guard Margin around segment boundaries, within which every time is delegated to the chooser. This must
+               be larger than the tolerance the chooser allows at the boundary of a validity window.
+    */
+    CachedEphChooser(const pulsarDb::EphChooser & chooser,
+      const timeSystem::ElapsedTime & guard = timeSystem::ElapsedTime("TT", timeSystem::Duration(0, 1.)));
+
+    /// \brief Construct a CachedEphChooser object from another, without the memory of the last choice.
+    CachedEphChooser(const CachedEphChooser & other);
+
+    /// \brief Destruct this CachedEphChooser object.
+    virtual ~CachedEphChooser();
+
+    /** \brief Choose a spin ephemeris for the given time.
+        \param ephemerides Spin ephemerides to choose from.
+        \param t Time for which to choose an ephemeris.
+    */
+    virtual const pulsarDb::PulsarEph & choose(const pulsarDb::PulsarEphCont & ephemerides, const timeSystem::AbsoluteTime & t) const;
+
+    /** \brief Choose an orbital ephemeris for the given time.
+        \param ephemerides Orbital ephemerides to choose from.
+        \param t Time for which to choose an ephemeris.
+    */
+    virtual const pulsarDb::OrbitalEph & choose(const pulsarDb::OrbitalEphCont & ephemerides, const timeSystem::AbsoluteTime & t) const;
+
+    /// \brief Create a copy of this object.
+    virtual pulsarDb::EphChooser * clone() const;
+
+    /** \brief Examine the given spin ephemerides, and report findings to the given container, as the chooser does.
+        \param ephemerides Spin ephemerides to examine.
+        \param start_time Start time of the interval of examination.
+        \param stop_time Stop time of the interval of examination.
+        \param eph_status Container to put ephemeris status in.
+    */
+    virtual void examinePulsarEph(const pulsarDb::PulsarEphCont & ephemerides, const timeSystem::AbsoluteTime & start_time,
+      const timeSystem::AbsoluteTime & stop_time, pulsarDb::EphStatusCont & eph_status) const;
+
+    /// \brief Return the number of calls of choose methods, summed over this object and all its copies.
+    long getNumCall() const;
+
+    /// \brief Return the number of searches delegated to the chooser, summed over this object and all its copies.
+    long getNumSearch() const;
+
+  private:
+    /** \class SegmentIndex
+        \brief Segments of time built from validity windows of a set of ephemerides, and the segment of the last choice.
+    */
+    template <typename EphType>
+    struct SegmentIndex {
+      typedef std::vector<EphType *> EphCont;
+
+      SegmentIndex(): m_eph_cont(0), m_num_eph(0), m_boundary_cont(), m_inner_cont(), m_covered_cont(), m_segment(-1),
+        m_eph(0) {}
+
+      const EphCont * m_eph_cont;
+      typename EphCont::size_type m_num_eph;
+      std::vector<timeSystem::AbsoluteTime> m_boundary_cont;
+      std::vector<std::pair<timeSystem::AbsoluteTime, timeSystem::AbsoluteTime> > m_inner_cont;
+      std::vector<bool> m_covered_cont;
+      long m_segment;
+      const EphType * m_eph;
+    };
+
+    /// \brief Numbers of calls and searches, shared by a CachedEphChooser object and all its copies.
+    struct Statistics {
+      std::atomic<long> m_num_call;
+      std::atomic<long> m_num_search;
+    };
+
+    std::unique_ptr<pulsarDb::EphChooser> m_chooser;
+    timeSystem::ElapsedTime m_guard;
+    std::shared_ptr<Statistics> m_statistics;
+    mutable SegmentIndex<pulsarDb::PulsarEph> m_pulsar_index;
+    mutable SegmentIndex<pulsarDb::OrbitalEph> m_orbital_index;
+
+    /** \brief Choose an ephemeris from the given segment index, or delegate the choice to the chooser when necessary.
+        \param ephemerides Ephemerides to choose from.
+        \param t Time for which to choose an ephemeris.
+        \param index Segment index to use, which is rebuilt if it does not represent the given ephemerides.
+    */
+    template <typename EphType>
+    const EphType & chooseEph(const std::vector<EphType *> & ephemerides, const timeSystem::AbsoluteTime & t,
+      SegmentIndex<EphType> & index) const;
+
+    /** \brief Build a segment index for the given ephemerides.
+        \param ephemerides Ephemerides to build the index for.
+        \param index Segment index to build.
+    */
+    template <typename EphType>
+    void buildIndex(const std::vector<EphType *> & ephemerides, SegmentIndex<EphType> & index) const;
+
+    // Prohibit assignment.
+    CachedEphChooser & operator =(const CachedEphChooser &);
+};
+
+#endif
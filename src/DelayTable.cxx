@@ -0,0 +1,191 @@
+/** \file DelayTable.cxx
+    \brief Implementation of DelayTable class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "DelayTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+  /// \brief Maximum number of cells kept in a table, which is about 35 days of spacecraft data in 30-second rows.
+  const std::size_t s_max_num_cell = 100000;
+
+}
+
+DelayTable::DelayTable(const FunctionType & function, const IntervalFunctionType & interval_function,
+  double tolerance, double min_piece_length): m_function(function), m_interval_function(interval_function),
+  m_tolerance(tolerance), m_min_piece_length(min_piece_length), m_cell_dict(), m_current_cell(0),
+  m_pending_interval(), m_num_pending(0), m_pending_cost(0), m_dense(false),
+  m_node_time(std::numeric_limits<double>::quiet_NaN()), m_node_value(0.), m_num_evaluation(0) {
+  m_pending_interval.m_start = m_pending_interval.m_stop = std::numeric_limits<double>::quiet_NaN();
+  m_pending_interval.m_max_derivative = 0.;
+  if (!(m_tolerance > 0.)) throw std::runtime_error("Tolerance of a delay table must be positive");
+  if (!(m_min_piece_length > 0.)) throw std::runtime_error("Minimum piece length of a delay table must be positive");
+}
+
+DelayTable::DelayTable(const FunctionType & function, double tolerance, double max_derivative, double cell_length):
+  m_function(function), m_interval_function(), m_tolerance(tolerance), m_min_piece_length(1.), m_cell_dict(),
+  m_current_cell(0), m_pending_interval(), m_num_pending(0), m_pending_cost(0), m_dense(false),
+  m_node_time(std::numeric_limits<double>::quiet_NaN()), m_node_value(0.), m_num_evaluation(0) {
+  m_pending_interval.m_start = m_pending_interval.m_stop = std::numeric_limits<double>::quiet_NaN();
+  m_pending_interval.m_max_derivative = 0.;
+  if (!(m_tolerance > 0.)) throw std::runtime_error("Tolerance of a delay table must be positive");
+  if (!(cell_length > 0.)) throw std::runtime_error("Cell length of a delay table must be positive");
+  m_interval_function = [cell_length, max_derivative](double time) {
+    double start = std::floor(time / cell_length) * cell_length;
+    Interval interval = { start, start + cell_length, max_derivative };
+    return interval;
+  };
+}
+
+double DelayTable::compute(double time) {
+  // Count requests in the interval of the latest cell, to estimate how dense the requested times are.
+  if (0 != m_current_cell && m_current_cell->m_start <= time && time < m_current_cell->m_stop) {
+    ++m_num_pending;
+    return computeFromCell(*m_current_cell, time);
+  }
+
+  m_current_cell = findCell(time);
+  if (0 == m_current_cell) {
+    if (!(m_pending_interval.m_start <= time && time <= m_pending_interval.m_stop)) {
+      m_dense = (0 < m_pending_cost && m_num_pending >= m_pending_cost);
+      m_pending_interval = m_interval_function(time);
+      if (!(m_pending_interval.m_start <= time && time <= m_pending_interval.m_stop)) {
+        throw std::logic_error("Interval of a delay table does not contain the requested time");
+      }
+      m_num_pending = 0;
+      m_pending_cost = countEvaluation(m_pending_interval);
+    }
+
+    // Compute the function directly until it is requested in the interval as many times as it is computed to build
+    // the cell, so that the table never costs much more than direct computation for sparse times. Build the cell
+    // on the first request if the function was requested as many times in the previous interval, because times are
+    // probably dense.
+    if (++m_num_pending < m_pending_cost && !m_dense) {
+      ++m_num_evaluation;
+      return m_function(time);
+    }
+    m_current_cell = &buildCell(m_pending_interval);
+  }
+  return computeFromCell(*m_current_cell, time);
+}
+
+long DelayTable::getNumEvaluation() const {
+  return m_num_evaluation;
+}
+
+const DelayTable::Cell * DelayTable::findCell(double time) const {
+  CellDict::const_iterator cell_itor = m_cell_dict.upper_bound(time);
+  if (m_cell_dict.begin() == cell_itor) return 0;
+  --cell_itor;
+  return (time <= cell_itor->second.m_stop ? &cell_itor->second : 0);
+}
+
+long DelayTable::countPiece(const Interval & interval) const {
+  // Choose the number of pieces so that the node interval h satisfies M h^4 / 24 <= tolerance, where M is the bound
+  // of the fourth derivative. Return zero to compute the function directly in the whole cell if the pieces would be
+  // too short, or if the bound is not a finite number.
+  double length = interval.m_stop - interval.m_start;
+  if (!(length > 0.) || !(interval.m_max_derivative >= 0.) ||
+    !(interval.m_max_derivative < std::numeric_limits<double>::infinity())) return 0;
+  double num_piece = 1.;
+  if (interval.m_max_derivative > 0.) {
+    double max_node_interval = std::pow(24. * m_tolerance / interval.m_max_derivative, .25);
+    num_piece = std::max(1., std::ceil(length / (3. * max_node_interval)));
+  }
+  if (num_piece > 1. && !(length / num_piece >= m_min_piece_length)) return 0;
+  return static_cast<long>(num_piece);
+}
+
+long DelayTable::countEvaluation(const Interval & interval) const {
+  // Count three nodes per piece plus the end point of the cell, and the middle of each piece.
+  long num_piece = countPiece(interval);
+  return (0 == num_piece ? 0 : 4 * num_piece + 1);
+}
+
+const DelayTable::Cell & DelayTable::buildCell(const Interval & interval) {
+  Cell cell;
+  cell.m_start = interval.m_start;
+  cell.m_stop = interval.m_stop;
+  double length = cell.m_stop - cell.m_start;
+  long num_piece = countPiece(interval);
+  bool exact = (0 == num_piece);
+  if (exact) {
+    Piece piece;
+    piece.m_exact = true;
+    cell.m_piece_length = (length > 0. ? length : 1.);
+    cell.m_piece_cont.assign(1, piece);
+
+  } else {
+    // Compute the function at nodes, three nodes per piece plus the end point of the cell.
+    cell.m_piece_length = length / num_piece;
+    double node_interval = cell.m_piece_length / 3.;
+    std::vector<double> node_value_cont(3 * num_piece + 1);
+    for (long node_index = 0; node_index < 3 * num_piece; ++node_index) {
+      node_value_cont[node_index] = computeNode(cell.m_start + node_index * node_interval);
+    }
+    node_value_cont.back() = computeNode(cell.m_stop);
+
+    // Compute coefficients of the interpolating polynomial of each piece, in the form of forward differences.
+    cell.m_piece_cont.resize(num_piece);
+    for (long piece_index = 0; piece_index < num_piece; ++piece_index) {
+      const double * node_value = &node_value_cont[3 * piece_index];
+      Piece & piece(cell.m_piece_cont[piece_index]);
+      double diff1[3] = { node_value[1] - node_value[0], node_value[2] - node_value[1], node_value[3] - node_value[2] };
+      double diff2[2] = { diff1[1] - diff1[0], diff1[2] - diff1[1] };
+      piece.m_exact = false;
+      piece.m_coeff[0] = node_value[0];
+      piece.m_coeff[1] = diff1[0];
+      piece.m_coeff[2] = diff2[0] / 2.;
+      piece.m_coeff[3] = (diff2[1] - diff2[0]) / 6.;
+
+      // Check the error in the middle of the piece, which cannot exceed the tolerance if the bound of the fourth
+      // derivative is correct. Compute the function directly in this piece otherwise.
+      double probe_time = cell.m_start + (piece_index + .5) * cell.m_piece_length;
+      ++m_num_evaluation;
+      double error = std::fabs(computeFromCell(cell, probe_time) - m_function(probe_time));
+      if (!(error <= m_tolerance)) piece.m_exact = true;
+    }
+  }
+
+  // Discard all the cells if too many cells are kept.
+  if (m_cell_dict.size() >= s_max_num_cell) {
+    m_cell_dict.clear();
+    m_current_cell = 0;
+  }
+  return m_cell_dict[cell.m_start] = cell;
+}
+
+double DelayTable::computeNode(double time) {
+  if (time != m_node_time) {
+    ++m_num_evaluation;
+    m_node_value = m_function(time);
+    m_node_time = time;
+  }
+  return m_node_value;
+}
+
+double DelayTable::computeFromCell(const Cell & cell, double time) const {
+  // Find the piece that contains the given time.
+  double elapsed = (time - cell.m_start) / cell.m_piece_length;
+  long piece_index = static_cast<long>(std::floor(elapsed));
+  long num_piece = cell.m_piece_cont.size();
+  if (piece_index < 0) piece_index = 0;
+  else if (piece_index >= num_piece) piece_index = num_piece - 1;
+  const Piece & piece(cell.m_piece_cont[piece_index]);
+  if (piece.m_exact) {
+    ++m_num_evaluation;
+    return m_function(time);
+  }
+
+  // Evaluate the polynomial in Newton form, with the time measured in units of the node interval.
+  double uu = 3. * (elapsed - piece_index);
+  const double * coeff = piece.m_coeff;
+  return coeff[0] + uu * (coeff[1] + (uu - 1.) * (coeff[2] + (uu - 2.) * coeff[3]));
+}
@@ -0,0 +1,136 @@
+/** \file DelayTable.h
+    \brief Declaration of DelayTable class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_DelayTable_h
+#define pulsePhase_DelayTable_h
+
+#include <functional>
+#include <map>
+#include <vector>
+
+/** \class DelayTable
+    \brief Table of a smooth function of time, such as a delay in photon arrival, which computes the function by
+           piecewise cubic interpolation. The table is built on demand, one cell of time at a time. A cell is an
+           interval of time in which the function is smooth, such as the interval between two rows of a spacecraft
+           file, given along with a bound M of the absolute value of the fourth derivative of the function in it.
+           Each cell is divided into pieces of equal length, each interpolated through four equally spaced nodes.
+           With a node interval h, the interpolation error is M h^4 |u (u - 1) (u - 2) (u - 3)| / 24 at most, where
+           u is the time from the first node in units of h, and the polynomial factor is at most 1 in magnitude within
+           a piece. The number of pieces is chosen so that M h^4 / 24 does not exceed the tolerance, which therefore
+           bounds the interpolation error, apart from rounding errors of floating-point arithmetic. As a guard against
+           a wrong bound M, such as a discontinuity inside a cell, the error is also measured at the middle of each
+           piece, and the function is computed directly in a piece where the error exceeds the tolerance. A cell is
+           built only when the function has been requested in it as many times as the function is computed to build
+           the cell, and the function is computed directly until then, so that the table never costs more than twice
+           as much as direct computation, even for sparse times. Cells
+           built are kept up to a limit, beyond which all of them are discarded, so that a long span of time does not
+           make the table grow without bound. Cells built again are identical to the discarded ones.
+*/
+class DelayTable {
+  public:
+    typedef std::function<double (double)> FunctionType;
+
+    /// \brief Interval of time in which the function is smooth, and a bound of the absolute value of its fourth
+    ///        derivative there, in seconds per second to the fourth.
+    struct Interval {
+      double m_start;
+      double m_stop;
+      double m_max_derivative;
+    };
+
+    typedef std::function<Interval (double)> IntervalFunctionType;
+
+    /** \brief Construct a DelayTable object with cells given by a function.
+        \param function Function to tabulate, which takes time in seconds and returns a value in seconds.
+        \param interval_function Function which returns the interval of time containing a given time, in which the
+               function is smooth. Intervals returned for different times must not overlap except at their ends.
+        \param tolerance Maximum interpolation error allowed, in seconds.
+        \param min_piece_length Minimum length of a piece, in seconds. The function is computed directly in a cell
+               which would need shorter pieces.
+    */
+    DelayTable(const FunctionType & function, const IntervalFunctionType & interval_function, double tolerance,
+      double min_piece_length = 1.);
+
+    /** \brief Construct a DelayTable object with cells of equal length, for a function smooth at all times.
+        \param function Function to tabulate, which takes time in seconds and returns a value in seconds.
+        \param tolerance Maximum interpolation error allowed, in seconds.
+        \param max_derivative Bound of the absolute value of the fourth derivative of the function.
+        \param cell_length Length of a cell of time, in seconds.
+    */
+    DelayTable(const FunctionType & function, double tolerance, double max_derivative, double cell_length = 3600.);
+
+    /** \brief Compute the function for the given time, building the table for the time if not built yet.
+        \param time Time in seconds.
+    */
+    double compute(double time);
+
+    /// \brief Return the number of times the tabulated function has been computed, to build the table or directly.
+    long getNumEvaluation() const;
+
+  private:
+    /// \brief A piece of a cell, holding coefficients of the interpolating polynomial in Newton form.
+    struct Piece {
+      bool m_exact;
+      double m_coeff[4];
+    };
+
+    /// \brief A cell of time, divided into pieces of equal length.
+    struct Cell {
+      double m_start;
+      double m_stop;
+      double m_piece_length;
+      std::vector<Piece> m_piece_cont;
+    };
+
+    typedef std::map<double, Cell> CellDict;
+
+    FunctionType m_function;
+    IntervalFunctionType m_interval_function;
+    double m_tolerance;
+    double m_min_piece_length;
+    CellDict m_cell_dict;
+    const Cell * m_current_cell;
+    Interval m_pending_interval;
+    long m_num_pending;
+    long m_pending_cost;
+    bool m_dense;
+    double m_node_time;
+    double m_node_value;
+    mutable long m_num_evaluation;
+
+    /** \brief Find the cell that contains the given time, or return 0 if it has not been built.
+        \param time Time in seconds.
+    */
+    const Cell * findCell(double time) const;
+
+    /** \brief Return the number of pieces of the cell for the given interval, or zero if the function is computed
+               directly in the whole cell.
+        \param interval Interval of time of the cell.
+    */
+    long countPiece(const Interval & interval) const;
+
+    /** \brief Return the number of times the function is computed to build the cell for the given interval.
+        \param interval Interval of time of the cell.
+    */
+    long countEvaluation(const Interval & interval) const;
+
+    /** \brief Build the cell for the given interval of time, and return a reference to it.
+        \param interval Interval of time of the cell.
+    */
+    const Cell & buildCell(const Interval & interval);
+
+    /** \brief Compute the tabulated function, reusing the value at the last node of the previous cell built.
+        \param time Time in seconds.
+    */
+    double computeNode(double time);
+
+    /** \brief Compute the function from the given cell.
+        \param cell Cell to compute the function from.
+        \param time Time in seconds.
+    */
+    double computeFromCell(const Cell & cell, double time) const;
+};
+
+#endif
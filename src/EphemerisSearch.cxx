@@ -0,0 +1,181 @@
+/** \file EphemerisSearch.cxx
+    \brief Implementation of EphemerisSearch class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "EphemerisSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PeriodicityTest.h"
+
+#include "fitsio.h"
+
+namespace {
+
+  /// \brief Number of harmonics over which the H-test statistic is maximized.
+  const long s_max_harmonic = 20;
+
+  /// \brief Number of events whose trial phases are computed together.
+  const long s_chunk_size = 1024;
+
+  /** \brief Throw an exception describing a CFITSIO error if the given status is not zero.
+      \param status CFITSIO status code.
+      \param file_name Name of the file being written.
+  */
+  void checkStatus(int status, const std::string & file_name) {
+    if (0 == status) return;
+    char message[FLEN_ERRMSG];
+    fits_get_errstatus(status, message);
+    fits_clear_errmsg();
+    throw std::runtime_error("Cannot write results of ephemeris search into file \"" + file_name + "\": " + message);
+  }
+
+}
+
+EphemerisSearch::EphemerisSearch(const PhaseTime & epoch): m_epoch(epoch), m_elapsed_cont(), m_phase_cont(),
+  m_weight_cont() {}
+
+void EphemerisSearch::add(const PhaseTime * time_begin, const double * phase_begin, const double * phase_end,
+  const double * weight_begin) {
+  for (const double * phase_itor = phase_begin; phase_itor != phase_end; ++phase_itor, ++time_begin) {
+    double weight = (weight_begin ? weight_begin[phase_itor - phase_begin] : 1.);
+    if (!std::isfinite(*phase_itor) || !std::isfinite(weight)) continue;
+    m_elapsed_cont.push_back(*time_begin - m_epoch);
+    m_phase_cont.push_back(*phase_itor);
+    m_weight_cont.push_back(weight);
+  }
+}
+
+void EphemerisSearch::merge(const EphemerisSearch & other) {
+  if (other.m_epoch - m_epoch != 0.) throw std::logic_error("Cannot merge ephemeris searches with different epochs");
+  m_elapsed_cont.insert(m_elapsed_cont.end(), other.m_elapsed_cont.begin(), other.m_elapsed_cont.end());
+  m_phase_cont.insert(m_phase_cont.end(), other.m_phase_cont.begin(), other.m_phase_cont.end());
+  m_weight_cont.insert(m_weight_cont.end(), other.m_weight_cont.begin(), other.m_weight_cont.end());
+}
+
+long EphemerisSearch::getNumEvent() const {
+  return m_phase_cont.size();
+}
+
+void EphemerisSearch::search(long num_f0, double f0_step, long num_f1, double f1_step, long z2_harmonic,
+  long num_thread, TrialCont & trial_cont) const {
+  if (num_f0 <= 0 || num_f1 <= 0) throw std::runtime_error("Number of trials of ephemeris search must be positive");
+  if (z2_harmonic <= 0 || z2_harmonic > s_max_harmonic) {
+    throw std::runtime_error("Number of harmonics of Z^2_m statistic must be between 1 and 20");
+  }
+  if (num_thread <= 0) {
+    num_thread = std::thread::hardware_concurrency();
+    if (num_thread <= 0) num_thread = 1;
+  }
+
+  // Lay out the grid of trials, centered on the ephemeris.
+  trial_cont.assign(num_f0 * num_f1, Trial());
+  for (long f1_index = 0; f1_index < num_f1; ++f1_index) {
+    for (long f0_index = 0; f0_index < num_f0; ++f0_index) {
+      Trial & trial(trial_cont[f1_index * num_f0 + f0_index]);
+      trial.m_f0_offset = (f0_index - .5 * (num_f0 - 1)) * f0_step;
+      trial.m_f1_offset = (f1_index - .5 * (num_f1 - 1)) * f1_step;
+    }
+  }
+
+  // Evaluate trials by a pool of threads, each taking the next trial not taken yet. The calling thread is one of
+  // the pool.
+  std::atomic<TrialCont::size_type> next_trial(0);
+  std::vector<std::exception_ptr> error_cont(num_thread);
+  auto evaluate_trial = [&](long thread_index) {
+    try {
+      std::vector<double> phase_chunk(s_chunk_size);
+      for (TrialCont::size_type trial_index = next_trial++; trial_index < trial_cont.size(); trial_index = next_trial++) {
+        Trial & trial(trial_cont[trial_index]);
+        PeriodicityTest test(s_max_harmonic);
+        for (std::vector<double>::size_type event_index = 0; event_index < m_phase_cont.size();
+          event_index += s_chunk_size) {
+          long num_event = std::min<long>(s_chunk_size, m_phase_cont.size() - event_index);
+          const double * elapsed = &m_elapsed_cont[event_index];
+          const double * phase = &m_phase_cont[event_index];
+          for (long index = 0; index < num_event; ++index) {
+            double trial_phase = phase[index] + (trial.m_f0_offset + .5 * trial.m_f1_offset * elapsed[index]) *
+              elapsed[index];
+            phase_chunk[index] = trial_phase - std::floor(trial_phase);
+          }
+          test.fill(&phase_chunk[0], &phase_chunk[0] + num_event, &m_weight_cont[event_index]);
+        }
+        trial.m_h = test.computeH(trial.m_h_harmonic);
+        trial.m_z2 = test.computeZ2(z2_harmonic);
+      }
+    } catch (...) {
+      error_cont[thread_index] = std::current_exception();
+      next_trial = trial_cont.size();
+    }
+  };
+  std::vector<std::thread> thread_cont;
+  for (long thread_index = 1; thread_index < num_thread; ++thread_index) {
+    thread_cont.push_back(std::thread(evaluate_trial, thread_index));
+  }
+  evaluate_trial(0);
+  for (std::vector<std::thread>::iterator itor = thread_cont.begin(); itor != thread_cont.end(); ++itor) itor->join();
+  for (std::vector<std::exception_ptr>::iterator itor = error_cont.begin(); itor != error_cont.end(); ++itor) {
+    if (*itor) std::rethrow_exception(*itor);
+  }
+}
+
+void EphemerisSearch::write(const std::string & file_name, const TrialCont & trial_cont, long z2_harmonic,
+  bool clobber) {
+  // Compute columns of the output table.
+  long num_trial = trial_cont.size();
+  std::vector<double> f0_offset_cont(num_trial);
+  std::vector<double> f1_offset_cont(num_trial);
+  std::vector<double> h_cont(num_trial);
+  std::vector<long> h_harmonic_cont(num_trial);
+  std::vector<double> h_sigma_cont(num_trial);
+  std::vector<double> z2_cont(num_trial);
+  for (long trial_index = 0; trial_index < num_trial; ++trial_index) {
+    const Trial & trial(trial_cont[trial_index]);
+    f0_offset_cont[trial_index] = trial.m_f0_offset;
+    f1_offset_cont[trial_index] = trial.m_f1_offset;
+    h_cont[trial_index] = trial.m_h;
+    h_harmonic_cont[trial_index] = trial.m_h_harmonic;
+    h_sigma_cont[trial_index] = PeriodicityTest::computeSigma(PeriodicityTest::computeHLogProbability(trial.m_h));
+    z2_cont[trial_index] = trial.m_z2;
+  }
+
+  // Create the output file, with "!" prepended to the name to overwrite an existing file.
+  int status = 0;
+  fitsfile * fits_file = 0;
+  std::string url((clobber ? "!" : "") + file_name);
+  fits_create_file(&fits_file, url.c_str(), &status);
+  checkStatus(status, file_name);
+
+  // Create the table, write header keywords and columns, and close the file even if an error occurs.
+  char ttype[][FLEN_VALUE] = { "DF0", "DF1", "H", "H_NHARM", "H_SIGMA", "Z2M" };
+  char tform[][FLEN_VALUE] = { "1D", "1D", "1D", "1J", "1D", "1D" };
+  char tunit[][FLEN_VALUE] = { "Hz", "Hz/s", "", "", "", "" };
+  char * ttype_ptr[] = { ttype[0], ttype[1], ttype[2], ttype[3], ttype[4], ttype[5] };
+  char * tform_ptr[] = { tform[0], tform[1], tform[2], tform[3], tform[4], tform[5] };
+  char * tunit_ptr[] = { tunit[0], tunit[1], tunit[2], tunit[3], tunit[4], tunit[5] };
+  fits_create_tbl(fits_file, BINARY_TBL, num_trial, 6, ttype_ptr, tform_ptr, tunit_ptr, "SEARCH", &status);
+  fits_update_key(fits_file, TLONG, "ZHARMON", &z2_harmonic, "Number of harmonics of Z^2_m statistic", &status);
+  if (0 < num_trial) {
+    fits_write_col_dbl(fits_file, 1, 1, 1, num_trial, &f0_offset_cont[0], &status);
+    fits_write_col_dbl(fits_file, 2, 1, 1, num_trial, &f1_offset_cont[0], &status);
+    fits_write_col_dbl(fits_file, 3, 1, 1, num_trial, &h_cont[0], &status);
+    fits_write_col_lng(fits_file, 4, 1, 1, num_trial, &h_harmonic_cont[0], &status);
+    fits_write_col_dbl(fits_file, 5, 1, 1, num_trial, &h_sigma_cont[0], &status);
+    fits_write_col_dbl(fits_file, 6, 1, 1, num_trial, &z2_cont[0], &status);
+  }
+  int close_status = 0;
+  if (0 != status) {
+    fits_delete_file(fits_file, &close_status);
+  } else {
+    fits_close_file(fits_file, &status);
+  }
+  checkStatus(status, file_name);
+}
@@ -0,0 +1,88 @@
+/** \file EphemerisSearch.h
+    \brief Declaration of EphemerisSearch class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_EphemerisSearch_h
+#define pulsePhase_EphemerisSearch_h
+
+#include <string>
+#include <vector>
+
+#include "PhaseTime.h"
+
+/** \class EphemerisSearch
+    \brief Search for the spin frequency and its first derivative around those of an ephemeris, by the H-test and
+           the Z^2_m statistics of pulse phases computed for a grid of trial offsets. Arrival times of events after
+           all corrections are kept in memory as seconds since the epoch of the ephemeris, along with the pulse phases
+           computed by the ephemeris and the weights of events, so that arrival time corrections are applied only
+           once for all trials. The pulse phase of an event for a trial is that by the ephemeris plus
+           df0 * dt + df1 * dt^2 / 2, where dt is the arrival time since the epoch, and df0 and df1 are the trial
+           offsets of the frequency and its derivative. Trials are evaluated by multiple threads, each trial by one
+           thread, so that the statistics do not depend on the number of threads.
+*/
+class EphemerisSearch {
+  public:
+    /// \brief Statistics of one trial.
+    struct Trial {
+      double m_f0_offset;
+      double m_f1_offset;
+      double m_h;
+      long m_h_harmonic;
+      double m_z2;
+    };
+
+    typedef std::vector<Trial> TrialCont;
+
+    /** \brief Construct an EphemerisSearch object with no events.
+        \param epoch Epoch of the ephemeris, at which the trial offsets are applied.
+    */
+    explicit EphemerisSearch(const PhaseTime & epoch);
+
+    /** \brief Add events to the search.
+        \param time_begin Pointer to the arrival time of the first event, after all corrections.
+        \param phase_begin Pointer to the pulse phase of the first event, computed by the ephemeris.
+        \param phase_end Pointer to one past the pulse phase of the last event.
+        \param weight_begin Pointer to the weight of the first event, or a null pointer if events are not weighted.
+    */
+    void add(const PhaseTime * time_begin, const double * phase_begin, const double * phase_end,
+      const double * weight_begin = 0);
+
+    /** \brief Add the events of another object with the same epoch to this object, after the events of this object.
+        \param other Object whose events are added.
+    */
+    void merge(const EphemerisSearch & other);
+
+    /// \brief Return the number of events added.
+    long getNumEvent() const;
+
+    /** \brief Compute the statistics for a grid of trial offsets, centered on the ephemeris.
+        \param num_f0 Number of trial offsets of the frequency.
+        \param f0_step Step of trial offsets of the frequency, in Hz.
+        \param num_f1 Number of trial offsets of the first derivative of the frequency.
+        \param f1_step Step of trial offsets of the first derivative of the frequency, in Hz/s.
+        \param z2_harmonic Number of harmonics of the Z^2_m statistic.
+        \param num_thread Number of threads to evaluate trials with.
+        \param trial_cont Statistics of the trials, ordered by the offset of the derivative and then by the offset of
+               the frequency, set by this method.
+    */
+    void search(long num_f0, double f0_step, long num_f1, double f1_step, long z2_harmonic, long num_thread,
+      TrialCont & trial_cont) const;
+
+    /** \brief Write statistics of trials into a FITS binary table named SEARCH, with columns DF0, DF1, H, H_NHARM,
+               H_SIGMA and Z2M, one row per trial.
+        \param file_name Name of the output file.
+        \param trial_cont Statistics of the trials.
+        \param z2_harmonic Number of harmonics of the Z^2_m statistic, recorded in the header.
+        \param clobber Flag to overwrite an existing file.
+    */
+    static void write(const std::string & file_name, const TrialCont & trial_cont, long z2_harmonic, bool clobber);
+
+  private:
+    PhaseTime m_epoch;
+    std::vector<double> m_elapsed_cont;
+    std::vector<double> m_phase_cont;
+    std::vector<double> m_weight_cont;
+};
+
+#endif
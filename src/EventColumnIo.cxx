@@ -0,0 +1,238 @@
+/** \file EventColumnIo.cxx
+    \brief Implementation of EventColumnIo class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "EventColumnIo.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "tip/IFileSvc.h"
+#include "tip/Table.h"
+
+EventColumnIo::EventColumnIo(const FileNameCont & file_name_cont, const std::string & table_name):
+  m_file_name_cont(file_name_cont), m_table_name(table_name), m_table_cont(), m_first_record_cont(), m_num_records(0),
+  m_fits_file_cont(file_name_cont.size(), 0) {
+  try {
+    for (FileNameCont::const_iterator itor = file_name_cont.begin(); itor != file_name_cont.end(); ++itor) {
+      tip::Table * table = tip::IFileSvc::instance().editTable(*itor, table_name);
+      m_table_cont.push_back(table);
+      m_first_record_cont.push_back(m_num_records);
+      m_num_records += table->getNumRecords();
+    }
+  } catch (...) {
+    for (TableCont::reverse_iterator itor = m_table_cont.rbegin(); itor != m_table_cont.rend(); ++itor) delete *itor;
+    throw;
+  }
+}
+
+EventColumnIo::~EventColumnIo() {
+  closeFitsFile();
+  for (TableCont::reverse_iterator itor = m_table_cont.rbegin(); itor != m_table_cont.rend(); ++itor) delete *itor;
+}
+
+void EventColumnIo::updateChecksum(const std::string & file_name, const std::string & table_name) {
+  // Open the table through CFITSIO, which shares the buffers of the file with tip if the file is also open in tip.
+  fitsfile * fits_file = 0;
+  int status = 0;
+  std::string table_url = file_name + "[" + table_name + "]";
+  fits_open_file(&fits_file, table_url.c_str(), READWRITE, &status);
+  if (0 != status) {
+    char message[FLEN_ERRMSG];
+    fits_get_errstatus(status, message);
+    fits_clear_errmsg();
+    throw std::runtime_error("Cannot open table \"" + table_url + "\" to update its checksum: " + message);
+  }
+
+  // Update DATASUM and CHECKSUM keywords, only if the table already has them.
+  char value[FLEN_VALUE];
+  char comment[FLEN_COMMENT];
+  fits_read_keyword(fits_file, "DATASUM", value, comment, &status);
+  if (0 == status) {
+    fits_write_chksum(fits_file, &status);
+  } else {
+    status = 0;
+  }
+  int close_status = 0;
+  fits_close_file(fits_file, &close_status);
+  if (0 != status || 0 != close_status) {
+    char message[FLEN_ERRMSG];
+    fits_get_errstatus(0 != status ? status : close_status, message);
+    fits_clear_errmsg();
+    throw std::runtime_error("Cannot update checksum of table \"" + table_url + "\": " + message);
+  }
+}
+
+tip::Index_t EventColumnIo::getNumRecords() const {
+  return m_num_records;
+}
+
+EventColumnIo::TableCont::size_type EventColumnIo::getNumTables() const {
+  return m_table_cont.size();
+}
+
+tip::Index_t EventColumnIo::getFirstRecord(TableCont::size_type table_index) const {
+  return m_first_record_cont.at(table_index);
+}
+
+tip::Index_t EventColumnIo::getNumRecords(TableCont::size_type table_index) const {
+  return m_table_cont.at(table_index)->getNumRecords();
+}
+
+const tip::Header & EventColumnIo::getHeader(TableCont::size_type table_index) const {
+  return m_table_cont.at(table_index)->getHeader();
+}
+
+tip::Header & EventColumnIo::getHeader(TableCont::size_type table_index) {
+  return m_table_cont.at(table_index)->getHeader();
+}
+
+void EventColumnIo::createField(const std::string & field_name, const std::string & field_format) {
+  // Make a lower-case copy of the field name, because field names are stored in lower case in tip.
+  std::string field_name_lc(field_name);
+  for (std::string::iterator itor = field_name_lc.begin(); itor != field_name_lc.end(); ++itor) *itor = std::tolower(*itor);
+
+  for (TableCont::iterator table_itor = m_table_cont.begin(); table_itor != m_table_cont.end(); ++table_itor) {
+    tip::Table & table = **table_itor;
+    const tip::Table::FieldCont & field_cont = table.getValidFields();
+    if (field_cont.end() == std::find(field_cont.begin(), field_cont.end(), field_name_lc)) {
+      table.appendField(field_name, field_format);
+    }
+  }
+}
+
+void EventColumnIo::readColumn(const std::string & field_name, tip::Index_t record_index, double * begin, double * end) const {
+  if (record_index < 0 || record_index + (end - begin) > m_num_records) {
+    throw std::runtime_error("Cannot read values of field \"" + field_name + "\" beyond the end of the event table(s)");
+  }
+
+  // Read values, moving onto the next event table as needed.
+  for (TableCont::size_type table_index = findTable(record_index); begin != end; ++table_index) {
+    tip::Table & table = *m_table_cont[table_index];
+    tip::Index_t local_index = record_index - m_first_record_cont[table_index];
+    tip::Index_t num_to_read = std::min<tip::Index_t>(end - begin, table.getNumRecords() - local_index);
+
+    int column_number = findScalarColumn(table_index, field_name, false);
+    if (0 < column_number) {
+      // Read all values at once, leaving conversion from the column format to CFITSIO, with null values set to NaN.
+      int status = 0;
+      int any_null = 0;
+      fits_read_col_dbl(m_fits_file_cont[table_index], column_number, local_index + 1, 1, num_to_read,
+        std::numeric_limits<double>::quiet_NaN(), begin, &any_null, &status);
+      if (0 != status) {
+        char message[FLEN_ERRMSG];
+        fits_get_errstatus(status, message);
+        fits_clear_errmsg();
+        throw std::runtime_error("Cannot read values of field \"" + field_name + "\" from file \"" +
+          m_file_name_cont[table_index] + "\": " + message);
+      }
+      begin += num_to_read;
+
+    } else {
+      tip::Table::Iterator record_itor = table.begin();
+      record_itor += local_index;
+      for (double * value_end = begin + num_to_read; begin != value_end; ++begin, ++record_itor) {
+        (*record_itor)[field_name].get(*begin);
+      }
+    }
+    record_index += num_to_read;
+  }
+}
+
+void EventColumnIo::writeColumn(const std::string & field_name, tip::Index_t record_index, const double * begin,
+  const double * end) {
+  if (record_index < 0 || record_index + (end - begin) > m_num_records) {
+    throw std::runtime_error("Cannot write values of field \"" + field_name + "\" beyond the end of the event table(s)");
+  }
+
+  // Write values, moving onto the next event table as needed.
+  for (TableCont::size_type table_index = findTable(record_index); begin != end; ++table_index) {
+    tip::Table & table = *m_table_cont[table_index];
+    tip::Index_t local_index = record_index - m_first_record_cont[table_index];
+    tip::Index_t num_to_write = std::min<tip::Index_t>(end - begin, table.getNumRecords() - local_index);
+
+    int column_number = findScalarColumn(table_index, field_name, true);
+    if (0 < column_number) {
+      // Write all values at once, leaving conversion to big-endian to CFITSIO.
+      int status = 0;
+      fits_write_col_dbl(m_fits_file_cont[table_index], column_number, local_index + 1, 1, num_to_write,
+        const_cast<double *>(begin), &status);
+      if (0 != status) {
+        char message[FLEN_ERRMSG];
+        fits_get_errstatus(status, message);
+        throw std::runtime_error("Cannot write values of field \"" + field_name + "\" into file \"" +
+          m_file_name_cont[table_index] + "\": " + message);
+      }
+      begin += num_to_write;
+
+    } else {
+      tip::Table::Iterator record_itor = table.begin();
+      record_itor += local_index;
+      for (const double * value_end = begin + num_to_write; begin != value_end; ++begin, ++record_itor) {
+        (*record_itor)[field_name].set(*begin);
+      }
+    }
+    record_index += num_to_write;
+  }
+}
+
+EventColumnIo::TableCont::size_type EventColumnIo::findTable(tip::Index_t record_index) const {
+  // Find the last table whose first record is at or before the given record, skipping empty tables.
+  IndexCont::const_iterator itor = std::upper_bound(m_first_record_cont.begin(), m_first_record_cont.end(), record_index);
+  return (itor - m_first_record_cont.begin()) - 1;
+}
+
+int EventColumnIo::findScalarColumn(TableCont::size_type table_index, const std::string & field_name,
+  bool double_only) const {
+  // Leave files with extended file name syntax to tip, which may have opened a filtered copy of the file.
+  const std::string & file_name = m_file_name_cont[table_index];
+  if (std::string::npos != file_name.find_first_of("[]")) return 0;
+
+  // Open a CFITSIO file handle for the event table, which shares the file buffers with the handle opened by tip.
+  int status = 0;
+  fitsfile *& fits_file = m_fits_file_cont[table_index];
+  if (0 == fits_file) {
+    std::string table_url = file_name + "[" + m_table_name + "]";
+    fits_open_file(&fits_file, table_url.c_str(), READWRITE, &status);
+    if (0 != status) {
+      fits_file = 0;
+      fits_clear_errmsg();
+      return 0;
+    }
+  }
+
+  // Look for the field, and check its format.
+  int column_number = 0;
+  int type_code = 0;
+  long repeat = 0;
+  long width = 0;
+  std::string column_name(field_name);
+  fits_get_colnum(fits_file, CASEINSEN, &column_name[0], &column_number, &status);
+  fits_get_coltype(fits_file, column_number, &type_code, &repeat, &width, &status);
+  if (0 != status) {
+    fits_clear_errmsg();
+    return 0;
+  }
+  if (1 != repeat) return 0;
+
+  // Accept numeric types only, whose codes range from TBYTE to TDOUBLE except for TLOGICAL and TSTRING.
+  if (double_only) return (TDOUBLE == type_code ? column_number : 0);
+  bool numeric = (TBYTE <= type_code && type_code <= TDOUBLE && TLOGICAL != type_code && TSTRING != type_code);
+  return numeric ? column_number : 0;
+}
+
+void EventColumnIo::closeFitsFile() {
+  for (FitsFileCont::size_type table_index = 0; table_index != m_fits_file_cont.size(); ++table_index) {
+    fitsfile * fits_file = m_fits_file_cont[table_index];
+    if (0 == fits_file) continue;
+
+    int status = 0;
+    fits_close_file(fits_file, &status);
+    fits_clear_errmsg();
+    m_fits_file_cont[table_index] = 0;
+  }
+}
@@ -0,0 +1,133 @@
+/** \file EventColumnIo.h
+    \brief Declaration of EventColumnIo class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_EventColumnIo_h
+#define pulsePhase_EventColumnIo_h
+
+#include <string>
+#include <vector>
+
+#include "fitsio.h"
+
+#include "tip/Header.h"
+
+namespace tip {
+  class Table;
+}
+
+/** \class EventColumnIo
+    \brief Bulk access to columns of the event table(s), addressed by record indices counted across all event files
+           in the order given by the user. This is the same order as events are visited by PulsarToolApp::setFirstEvent
+           and PulsarToolApp::setNextEvent methods. Values of a numeric scalar column are read, and values of
+           a double-precision scalar column are written, a block at a time by CFITSIO, through a file handle which
+           shares the buffers of the file with tip. Data checksums are not updated by this object, because the header
+           of a table may be modified after this object is destroyed; call updateChecksum method after all the
+           modifications instead.
+*/
+class EventColumnIo {
+  public:
+    typedef std::vector<std::string> FileNameCont;
+    typedef std::vector<tip::Table *> TableCont;
+
+    /** \brief Construct an EventColumnIo object, opening event tables in all the given files for editing.
+        \param file_name_cont Names of the event files, in the order events are visited.
+        \param table_name Name of the event table in each event file.
+    */
+    EventColumnIo(const FileNameCont & file_name_cont, const std::string & table_name);
+
+    /// \brief Destruct this EventColumnIo object.
+    virtual ~EventColumnIo();
+
+    /** \brief Update DATASUM and CHECKSUM keywords of the event table in the given file, only if the table already has
+               them. This must be called after all modifications to the table, including those to its header.
+        \param file_name Name of the event file.
+        \param table_name Name of the event table.
+    */
+    static void updateChecksum(const std::string & file_name, const std::string & table_name);
+
+    /// \brief Return the total number of records in all the event tables.
+    tip::Index_t getNumRecords() const;
+
+    /// \brief Return the number of event tables.
+    TableCont::size_type getNumTables() const;
+
+    /** \brief Return the index of the first record of the given event table, counted across all event tables.
+        \param table_index Index of the event table, in the order of the event files.
+    */
+    tip::Index_t getFirstRecord(TableCont::size_type table_index) const;
+
+    /** \brief Return the number of records in the given event table.
+        \param table_index Index of the event table, in the order of the event files.
+    */
+    tip::Index_t getNumRecords(TableCont::size_type table_index) const;
+
+    /** \brief Return the header of the given event table.
+        \param table_index Index of the event table, in the order of the event files.
+    */
+    const tip::Header & getHeader(TableCont::size_type table_index) const;
+
+    /** \brief Return the header of the given event table, for editing.
+        \param table_index Index of the event table, in the order of the event files.
+    */
+    tip::Header & getHeader(TableCont::size_type table_index);
+
+    /** \brief Create a field in all the event tables, unless it already exists.
+        \param field_name Name of the field to create.
+        \param field_format Format of the field to create, such as "1D".
+    */
+    void createField(const std::string & field_name, const std::string & field_format);
+
+    /** \brief Read a block of values from a field, starting at the given record. Values are read by one call to
+               CFITSIO per event table if the field is a numeric scalar column, or one at a time through tip otherwise.
+        \param field_name Name of the field to read the values from.
+        \param record_index Index of the first record to read, counted across all event tables.
+        \param begin Pointer to the first element of the array to store the values in.
+        \param end Pointer to one past the last element of the array to store the values in.
+    */
+    void readColumn(const std::string & field_name, tip::Index_t record_index, double * begin, double * end) const;
+
+    /** \brief Write a block of values into a field, starting at the given record. Values are written by one call to
+               CFITSIO per event table if the field is a double-precision scalar column (1D format), or one at a time
+               through tip otherwise.
+        \param field_name Name of the field to write the values into.
+        \param record_index Index of the first record to write, counted across all event tables.
+        \param begin Pointer to the first value to write.
+        \param end Pointer to one past the last value to write.
+    */
+    void writeColumn(const std::string & field_name, tip::Index_t record_index, const double * begin, const double * end);
+
+  private:
+    typedef std::vector<tip::Index_t> IndexCont;
+    typedef std::vector<fitsfile *> FitsFileCont;
+
+    FileNameCont m_file_name_cont;
+    std::string m_table_name;
+    TableCont m_table_cont;
+    IndexCont m_first_record_cont;
+    tip::Index_t m_num_records;
+    mutable FitsFileCont m_fits_file_cont;
+
+    /** \brief Find the event table that contains the given record.
+        \param record_index Index of the record, counted across all event tables.
+    */
+    TableCont::size_type findTable(tip::Index_t record_index) const;
+
+    /** \brief Return the CFITSIO column number of the given field, if it is a numeric scalar column, or 0 otherwise,
+               opening a CFITSIO file handle for the event table as needed.
+        \param table_index Index of the event table, in the order of the event files.
+        \param field_name Name of the field.
+        \param double_only If true, accept double-precision columns only.
+    */
+    int findScalarColumn(TableCont::size_type table_index, const std::string & field_name, bool double_only) const;
+
+    /// \brief Close all the CFITSIO file handles.
+    void closeFitsFile();
+
+    // Prohibit copying, because this object owns the event tables.
+    EventColumnIo(const EventColumnIo &);
+    EventColumnIo & operator =(const EventColumnIo &);
+};
+
+#endif
@@ -12,6 +12,9 @@
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <vector>
+
+#include "CachedEphChooser.h"
 
 #include "pulsarDb/EphChooser.h"
 #include "pulsarDb/EphComputer.h"
@@ -29,7 +32,7 @@ const std::string s_cvs_id("$Name:  $");
 
 OrbitalPhaseApp::~OrbitalPhaseApp() throw() {}
 
-OrbitalPhaseApp::OrbitalPhaseApp(): pulsarDb::PulsarToolApp(), m_os("OrbitalPhaseApp", "", 2) {
+OrbitalPhaseApp::OrbitalPhaseApp(): PhaseToolApp(), m_os("OrbitalPhaseApp", "", 2) {
   setName("gtophase");
   setVersion(s_cvs_id);
 }
@@ -42,6 +45,7 @@ void OrbitalPhaseApp::runApp() {
   par_group.Prompt("evfile");
   par_group.Prompt("evtable");
   par_group.Prompt("timefield");
+  par_group.Prompt("outfile");
   par_group.Prompt("scfile");
   par_group.Prompt("sctable");
   par_group.Prompt("psrdbfile");
@@ -62,6 +66,22 @@ void OrbitalPhaseApp::runApp() {
   par_group.Prompt("angtol");
   par_group.Prompt("ophasefield");
   par_group.Prompt("ophaseoffset");
+  par_group.Prompt("blocksize");
+  par_group.Prompt("nthreads");
+  par_group.Prompt("barytol");
+  par_group.Prompt("filethreads");
+  par_group.Prompt("perfreport");
+  par_group.Prompt("perffile");
+  par_group.Prompt("incremental");
+  par_group.Prompt("psrdbcache");
+  par_group.Prompt("timeorder");
+  par_group.Prompt("barycol");
+  par_group.Prompt("roiradius");
+  par_group.Prompt("scwindow");
+  par_group.Prompt("scindex");
+  par_group.Prompt("nbins");
+  par_group.Prompt("profile");
+  par_group.Prompt("weightfield");
   par_group.Prompt("reportephstatus");
 
   par_group.Prompt("chatter");
@@ -72,25 +92,38 @@ void OrbitalPhaseApp::runApp() {
 
   par_group.Save();
 
-  // Open the event file(s).
-  openEventFile(par_group, false);
+  // Record times spent in stages of processing, if requested.
+  initPerformanceMonitor(par_group);
+  PerformanceMonitor & monitor(getPerformanceMonitor());
+
+  // Fingerprint the parameters which affect phase values, to skip events whose phases are up to date, if requested.
+  std::vector<std::string> par_name_cont = { "evtable", "timefield", "sctable", "psrname", "ra", "dec", "srcposition",
+    "strict", "solareph", "matchsolareph", "angtol", "ophasefield", "ophaseoffset", "barytol", "roiradius", "scwindow",
+    "leapsecfile" };
+  initIncrementalMode(par_group, par_name_cont);
+
+  // Copy the input event file into the output file, if requested, and open the event file(s).
+  {
+    PerformanceMonitor::Stage stage(monitor, "openEventFile");
+    prepareEventFile(par_group);
+    openEventFile(par_group, false);
+  }
 
   // Handle leap seconds.
   std::string leap_sec_file = par_group["leapsecfile"];
   timeSystem::TimeSystem::setDefaultLeapSecFileName(leap_sec_file);
 
   // Setup time correction mode.
-  defineTimeCorrectionMode("DEFAULT", REQUIRED, REQUIRED, SUPPRESSED);
+  TimeCorrectionSetting tcmode(readTimeCorrectionSetting(par_group));
+  defineTimeCorrectionMode("DEFAULT", tcmode.m_bary, tcmode.m_bin, tcmode.m_pdot);
   selectTimeCorrectionMode("DEFAULT");
 
   // Set variables to initialize ephemeris computations and arrival time corrections.
   std::unique_ptr<pulsarDb::EphChooser> chooser(nullptr);
   std::string eph_style;
-  bool vary_ra_dec = false;
   if ("USER" == src_position_uc) {
     chooser.reset(new pulsarDb::StrictEphChooser);
     eph_style = "NONE";
-    vary_ra_dec = false;
 
   } else if ("DB" == src_position_uc) {
     bool strict = par_group["strict"];
@@ -100,49 +133,61 @@ void OrbitalPhaseApp::runApp() {
       chooser.reset(new pulsarDb::SloppyEphChooser);
     }
     eph_style = "DB";
-    vary_ra_dec = true;
 
   } else {
     throw std::runtime_error("Unsupported type of source position \"" + src_position + "\" was specified");
   }
 
-  // Set up EphComputer for arrival time corrections.
-  initEphComputer(par_group, *chooser, eph_style, m_os.info(4));
+  // Set up EphComputer for arrival time corrections, with an ephemeris chooser that saves a search for an ephemeris
+  // while event times stay in the same segment of ephemeris validity.
+  CachedEphChooser cached_chooser(*chooser);
+  {
+    PerformanceMonitor::Stage stage(monitor, "initEphComputer");
+    preparePulsarDb(par_group);
+    initEphComputer(par_group, cached_chooser, eph_style, m_os.info(4));
+  }
 
   // Use user input (parameters) together with computer to determine corrections to apply.
   bool guess_pdot = false;
-  initTimeCorrection(par_group, vary_ra_dec, guess_pdot, m_os.info(3), "START");
+  {
+    PerformanceMonitor::Stage stage(monitor, "initTimeCorrection");
+    initTimeCorrection(par_group, tcmode.m_vary_ra_dec, guess_pdot, m_os.info(3), "START");
+  }
 
   // Report ephemeris status.
   std::set<pulsarDb::EphStatusCodeType> code_to_report;
   code_to_report.insert(pulsarDb::Remarked);
   reportEphStatus(m_os.warn(), code_to_report);
 
-  // Reserve output column for creation if not existing in the event file(s).
+  // Read output column name and global phase offset.
   std::string phase_field = par_group["ophasefield"];
-  reserveOutputField(phase_field, "1D");
-
-  // Get EphComputer for orbital phase computation.
-  pulsarDb::EphComputer & computer(getEphComputer());
-
-  // Read global phase offset.
   double phase_offset = par_group["ophaseoffset"];
 
-  // Iterate over events.
-  for (setFirstEvent(); !isEndOfEventList(); setNextEvent()) {
-    // Get event time as AbsoluteTime.
-    timeSystem::AbsoluteTime abs_evt_time(getEventTime());
-
-    // Compute phase.
-    double phase = computer.calcOrbitalPhase(abs_evt_time, phase_offset);
-
-    // Write phase into output column.
-    setFieldValue(phase_field, phase);
+  // Compute phases and write them into the event file(s).
+  {
+    PerformanceMonitor::Stage stage(monitor, "assignPhase");
+    assignPhase(par_group, cached_chooser, ORBITAL_PHASE, phase_field, phase_offset);
   }
 
   // Write parameter values to the event file(s).
   std::string creator_name = getName() + " " + getVersion();
   std::string file_modification_time(createUtcTimeString());
   std::string header_line("File modified by " + creator_name + " on " + file_modification_time);
-  writeParameter(par_group, header_line);
+  {
+    PerformanceMonitor::Stage stage(monitor, "writeParameter");
+    restoreParameter(par_group);
+    writeParameter(par_group, header_line);
+    updateChecksum();
+  }
+
+  // Report times spent in stages of processing, if requested.
+  reportPerformance(par_group, cached_chooser, m_os.info(2));
+}
+
+PhaseToolApp::TimeCorrectionSetting OrbitalPhaseApp::readTimeCorrectionSetting(const st_app::AppParGroup & pars) const {
+  std::string src_position = pars["srcposition"];
+  std::string src_position_uc(src_position);
+  for (std::string::iterator itor = src_position_uc.begin(); itor != src_position_uc.end(); ++itor) *itor = std::toupper(*itor);
+  TimeCorrectionSetting setting = { REQUIRED, REQUIRED, SUPPRESSED, "DB" == src_position_uc };
+  return setting;
 }
@@ -6,14 +6,14 @@
 #ifndef pulsePhase_OrbitalPhaseApp_h
 #define pulsePhase_OrbitalPhaseApp_h
 
-#include "pulsarDb/PulsarToolApp.h"
+#include "PhaseToolApp.h"
 
 #include "st_stream/StreamFormatter.h"
 
 /** \class OrbitalPhaseApp
     \brief Main application class for orbital phase assignment.
 */
-class OrbitalPhaseApp : public pulsarDb::PulsarToolApp {
+class OrbitalPhaseApp : public PhaseToolApp {
   public:
     /// \brief Construct a OrbitalPhaseApp object.
     OrbitalPhaseApp();
@@ -24,6 +24,13 @@ class OrbitalPhaseApp : public pulsarDb::PulsarToolApp {
     /// \brief Run the application.
     virtual void runApp();
 
+  protected:
+    /** \brief Return the setting of arrival time corrections, which always requires barycentric corrections and binary
+               demodulation, with source positions taken from the spin ephemerides if srcposition parameter is DB.
+        \param pars Parameter group.
+    */
+    virtual TimeCorrectionSetting readTimeCorrectionSetting(const st_app::AppParGroup & pars) const;
+
   private:
     st_stream::StreamFormatter m_os;
 };
@@ -0,0 +1,106 @@
+/** \file PerformanceMonitor.cxx
+    \brief Implementation of PerformanceMonitor class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "PerformanceMonitor.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "st_stream/Stream.h"
+
+PerformanceMonitor::Stage::Stage(PerformanceMonitor & monitor, const char * stage_name): m_monitor(monitor),
+  m_stage_name(stage_name), m_wall_start(), m_cpu_start(0) {
+  if (m_monitor.isEnabled()) {
+    m_wall_start = std::chrono::steady_clock::now();
+    m_cpu_start = std::clock();
+  }
+}
+
+PerformanceMonitor::Stage::~Stage() {
+  if (m_monitor.isEnabled()) {
+    double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wall_start).count();
+    double cpu_time = double(std::clock() - m_cpu_start) / CLOCKS_PER_SEC;
+    try {
+      m_monitor.addTime(m_stage_name, wall_time, cpu_time);
+    } catch (...) {
+      // Losing a record is preferable to throwing from a destructor.
+    }
+  }
+}
+
+PerformanceMonitor::PerformanceMonitor(): m_enabled(false), m_mutex(), m_stage_name_cont(), m_stage_time_dict(),
+  m_counter_name_cont(), m_counter_dict() {}
+
+void PerformanceMonitor::enable(bool enabled) {
+  m_enabled = enabled;
+}
+
+bool PerformanceMonitor::isEnabled() const {
+  return m_enabled;
+}
+
+void PerformanceMonitor::addTime(const std::string & stage_name, double wall_time, double cpu_time) {
+  if (!m_enabled) return;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  StageTimeDict::iterator itor = m_stage_time_dict.find(stage_name);
+  if (m_stage_time_dict.end() == itor) {
+    StageTime stage_time = { 0., 0., 0 };
+    itor = m_stage_time_dict.insert(std::make_pair(stage_name, stage_time)).first;
+    m_stage_name_cont.push_back(stage_name);
+  }
+  itor->second.m_wall_time += wall_time;
+  itor->second.m_cpu_time += cpu_time;
+  ++itor->second.m_num_call;
+}
+
+void PerformanceMonitor::addCount(const std::string & counter_name, long count) {
+  if (!m_enabled) return;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  CounterDict::iterator itor = m_counter_dict.find(counter_name);
+  if (m_counter_dict.end() == itor) {
+    itor = m_counter_dict.insert(std::make_pair(counter_name, 0L)).first;
+    m_counter_name_cont.push_back(counter_name);
+  }
+  itor->second += count;
+}
+
+void PerformanceMonitor::report(st_stream::OStream & os) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (std::vector<std::string>::const_iterator itor = m_stage_name_cont.begin(); itor != m_stage_name_cont.end(); ++itor) {
+    const StageTime & stage_time(m_stage_time_dict.find(*itor)->second);
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(6) << "Time spent in " << *itor << ": " << stage_time.m_wall_time <<
+      " s (wall), " << stage_time.m_cpu_time << " s (CPU), " << stage_time.m_num_call << " call(s)";
+    os.prefix() << oss.str() << std::endl;
+  }
+  for (std::vector<std::string>::const_iterator itor = m_counter_name_cont.begin(); itor != m_counter_name_cont.end();
+    ++itor) {
+    os.prefix() << "Count of " << *itor << ": " << m_counter_dict.find(*itor)->second << std::endl;
+  }
+}
+
+void PerformanceMonitor::writeJson(const std::string & file_name, const std::string & tool_name) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::ofstream ofs(file_name.c_str());
+  if (!ofs) throw std::runtime_error("Cannot open file \"" + file_name + "\" to write a performance report");
+
+  ofs << std::setprecision(9) << "{\n  \"tool\": \"" << tool_name << "\",\n  \"stages\": [";
+  for (std::vector<std::string>::const_iterator itor = m_stage_name_cont.begin(); itor != m_stage_name_cont.end(); ++itor) {
+    const StageTime & stage_time(m_stage_time_dict.find(*itor)->second);
+    ofs << (m_stage_name_cont.begin() == itor ? "\n" : ",\n") << "    {\"name\": \"" << *itor << "\", \"wall_sec\": " <<
+      stage_time.m_wall_time << ", \"cpu_sec\": " << stage_time.m_cpu_time << ", \"calls\": " << stage_time.m_num_call <<
+      "}";
+  }
+  ofs << "\n  ],\n  \"counters\": {";
+  for (std::vector<std::string>::const_iterator itor = m_counter_name_cont.begin(); itor != m_counter_name_cont.end();
+    ++itor) {
+    ofs << (m_counter_name_cont.begin() == itor ? "\n" : ",\n") << "    \"" << *itor << "\": " <<
+      m_counter_dict.find(*itor)->second;
+  }
+  ofs << "\n  }\n}\n";
+  if (!ofs) throw std::runtime_error("Cannot write a performance report into file \"" + file_name + "\"");
+}
@@ -0,0 +1,112 @@
+/** \file PerformanceMonitor.h
+    \brief Declaration of PerformanceMonitor class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PerformanceMonitor_h
+#define pulsePhase_PerformanceMonitor_h
+
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace st_stream {
+  class OStream;
+}
+
+/** \class PerformanceMonitor
+    \brief Accumulator of wall-clock time and CPU time spent in named stages of processing, and of named counters.
+           Stages and counters are reported in the order they are first recorded. Nothing is recorded while this object
+           is disabled, so that stage timers in the event loop cost only a test of a flag unless a report is requested.
+           Times and counts may be recorded from multiple threads. CPU time is that of the whole process, including
+           all threads running during a stage.
+*/
+class PerformanceMonitor {
+  public:
+    /** \class Stage
+        \brief Helper class to record time spent in a stage, from construction to destruction of an object.
+    */
+    class Stage {
+      public:
+        /** \brief Construct a Stage object, starting the clocks if the monitor is enabled.
+            \param monitor Performance monitor to record time in.
+            \param stage_name Name of the stage.
+        */
+        Stage(PerformanceMonitor & monitor, const char * stage_name);
+
+        /// \brief Destruct this Stage object, recording the time spent since construction.
+        ~Stage();
+
+      private:
+        PerformanceMonitor & m_monitor;
+        const char * m_stage_name;
+        std::chrono::steady_clock::time_point m_wall_start;
+        std::clock_t m_cpu_start;
+
+        // Prohibit copying.
+        Stage(const Stage &);
+        Stage & operator =(const Stage &);
+    };
+
+    /// \brief Construct a disabled PerformanceMonitor object.
+    PerformanceMonitor();
+
+    /** \brief Enable or disable recording.
+        \param enabled Flag to enable recording.
+    */
+    void enable(bool enabled);
+
+    /// \brief Return true if recording is enabled, or false otherwise.
+    bool isEnabled() const;
+
+    /** \brief Add time spent in a stage.
+        \param stage_name Name of the stage.
+        \param wall_time Wall-clock time in seconds.
+        \param cpu_time CPU time in seconds.
+    */
+    void addTime(const std::string & stage_name, double wall_time, double cpu_time);
+
+    /** \brief Add a number to a counter.
+        \param counter_name Name of the counter.
+        \param count Number to add.
+    */
+    void addCount(const std::string & counter_name, long count);
+
+    /** \brief Write the times and the counters to the given stream, one per line.
+        \param os Output stream to write to.
+    */
+    void report(st_stream::OStream & os) const;
+
+    /** \brief Write the times and the counters to a file in JSON format.
+        \param file_name Name of the file to write.
+        \param tool_name Name of the application, to be written into the file.
+    */
+    void writeJson(const std::string & file_name, const std::string & tool_name) const;
+
+  private:
+    /// \brief Time spent in a stage.
+    struct StageTime {
+      double m_wall_time;
+      double m_cpu_time;
+      long m_num_call;
+    };
+
+    typedef std::map<std::string, StageTime> StageTimeDict;
+    typedef std::map<std::string, long> CounterDict;
+
+    bool m_enabled;
+    mutable std::mutex m_mutex;
+    std::vector<std::string> m_stage_name_cont;
+    StageTimeDict m_stage_time_dict;
+    std::vector<std::string> m_counter_name_cont;
+    CounterDict m_counter_dict;
+
+    // Prohibit copying.
+    PerformanceMonitor(const PerformanceMonitor &);
+    PerformanceMonitor & operator =(const PerformanceMonitor &);
+};
+
+#endif
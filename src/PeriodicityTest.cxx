@@ -0,0 +1,161 @@
+/** \file PeriodicityTest.cxx
+    \brief Implementation of PeriodicityTest class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "PeriodicityTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+  /// \brief Number of events whose moments are computed together.
+  const long s_chunk_size = 256;
+
+  /** \brief Return the natural logarithm of the one-sided tail probability of the standard normal distribution.
+      \param sigma Lower bound of the tail.
+  */
+  double computeLogTail(double sigma) {
+    static const double s_sqrt_2 = std::sqrt(2.);
+    static const double s_log_sqrt_2pi = .5 * std::log(2. * M_PI);
+    if (sigma < 30.) return std::log(.5 * std::erfc(sigma / s_sqrt_2));
+
+    // Use the asymptotic expansion where the complementary error function underflows.
+    return -.5 * sigma * sigma - std::log(sigma) - s_log_sqrt_2pi + std::log(1. - 1. / (sigma * sigma));
+  }
+
+}
+
+PeriodicityTest::PeriodicityTest(long max_harmonic): m_max_harmonic(max_harmonic), m_num_event(0),
+  m_square_weight_sum(0.), m_cos_sum_cont(), m_sin_sum_cont() {
+  if (m_max_harmonic <= 0) throw std::runtime_error("Maximum number of harmonics must be positive");
+  m_cos_sum_cont.resize(m_max_harmonic, 0.);
+  m_sin_sum_cont.resize(m_max_harmonic, 0.);
+}
+
+long PeriodicityTest::getMaxHarmonic() const {
+  return m_max_harmonic;
+}
+
+void PeriodicityTest::fill(const double * phase_begin, const double * phase_end, const double * weight_begin) {
+  double weight_chunk[s_chunk_size];
+  double cos1_chunk[s_chunk_size];
+  double sin1_chunk[s_chunk_size];
+  double cos_chunk[s_chunk_size];
+  double sin_chunk[s_chunk_size];
+  for (const double * phase_itor = phase_begin; phase_itor != phase_end; ) {
+    // Collect a chunk of events with finite phases and weights, computing the first harmonic of each.
+    long num_chunk = 0;
+    for (; phase_itor != phase_end && num_chunk < s_chunk_size; ++phase_itor) {
+      double phase = *phase_itor;
+      double weight = (weight_begin ? weight_begin[phase_itor - phase_begin] : 1.);
+      if (!std::isfinite(phase) || !std::isfinite(weight)) continue;
+      double angle = 2. * M_PI * phase;
+      weight_chunk[num_chunk] = weight;
+      cos1_chunk[num_chunk] = std::cos(angle);
+      sin1_chunk[num_chunk] = std::sin(angle);
+      ++num_chunk;
+    }
+    m_num_event += num_chunk;
+    for (long index = 0; index < num_chunk; ++index) m_square_weight_sum += weight_chunk[index] * weight_chunk[index];
+    std::copy(cos1_chunk, cos1_chunk + num_chunk, cos_chunk);
+    std::copy(sin1_chunk, sin1_chunk + num_chunk, sin_chunk);
+
+    // Accumulate moments of each harmonic, computing the next harmonic by the angle-addition recurrence.
+    for (long harmonic_index = 0; harmonic_index < m_max_harmonic; ++harmonic_index) {
+      double cos_sum = 0.;
+      double sin_sum = 0.;
+      for (long index = 0; index < num_chunk; ++index) {
+        cos_sum += weight_chunk[index] * cos_chunk[index];
+        sin_sum += weight_chunk[index] * sin_chunk[index];
+      }
+      m_cos_sum_cont[harmonic_index] += cos_sum;
+      m_sin_sum_cont[harmonic_index] += sin_sum;
+      for (long index = 0; index < num_chunk; ++index) {
+        double cos_next = cos_chunk[index] * cos1_chunk[index] - sin_chunk[index] * sin1_chunk[index];
+        double sin_next = sin_chunk[index] * cos1_chunk[index] + cos_chunk[index] * sin1_chunk[index];
+        cos_chunk[index] = cos_next;
+        sin_chunk[index] = sin_next;
+      }
+    }
+  }
+}
+
+void PeriodicityTest::merge(const PeriodicityTest & other) {
+  if (other.m_max_harmonic != m_max_harmonic) {
+    throw std::logic_error("Cannot merge periodicity tests with different numbers of harmonics");
+  }
+  m_num_event += other.m_num_event;
+  m_square_weight_sum += other.m_square_weight_sum;
+  for (long harmonic_index = 0; harmonic_index < m_max_harmonic; ++harmonic_index) {
+    m_cos_sum_cont[harmonic_index] += other.m_cos_sum_cont[harmonic_index];
+    m_sin_sum_cont[harmonic_index] += other.m_sin_sum_cont[harmonic_index];
+  }
+}
+
+long PeriodicityTest::getNumEvent() const {
+  return m_num_event;
+}
+
+double PeriodicityTest::computeZ2(long num_harmonic) const {
+  if (num_harmonic <= 0 || num_harmonic > m_max_harmonic) {
+    throw std::runtime_error("Number of harmonics of Z^2_m statistic must be between 1 and the maximum number of harmonics");
+  }
+  if (0. == m_square_weight_sum) return 0.;
+  double sum = 0.;
+  for (long harmonic_index = 0; harmonic_index < num_harmonic; ++harmonic_index) {
+    sum += m_cos_sum_cont[harmonic_index] * m_cos_sum_cont[harmonic_index] +
+      m_sin_sum_cont[harmonic_index] * m_sin_sum_cont[harmonic_index];
+  }
+  return 2. * sum / m_square_weight_sum;
+}
+
+double PeriodicityTest::computeH(long & num_harmonic) const {
+  double h = 0.;
+  num_harmonic = 1;
+  for (long harmonic = 1; harmonic <= m_max_harmonic; ++harmonic) {
+    double value = computeZ2(harmonic) - 4. * harmonic + 4.;
+    if (1 == harmonic || value > h) {
+      h = value;
+      num_harmonic = harmonic;
+    }
+  }
+  return h;
+}
+
+double PeriodicityTest::computeZ2LogProbability(double z2, long num_harmonic) {
+  // Sum terms of exp(-x) * x^k / k! for k < m in logarithm, where x = z2 / 2.
+  double half_z2 = std::max(0., .5 * z2);
+  if (0. == half_z2) return 0.;
+  double log_half_z2 = std::log(half_z2);
+  double max_term = -HUGE_VAL;
+  std::vector<double> log_term_cont(num_harmonic);
+  for (long index = 0; index < num_harmonic; ++index) {
+    log_term_cont[index] = index * log_half_z2 - std::lgamma(index + 1.);
+    max_term = std::max(max_term, log_term_cont[index]);
+  }
+  double sum = 0.;
+  for (long index = 0; index < num_harmonic; ++index) sum += std::exp(log_term_cont[index] - max_term);
+  return std::min(0., -half_z2 + max_term + std::log(sum));
+}
+
+double PeriodicityTest::computeHLogProbability(double h) {
+  return std::min(0., -.4 * h);
+}
+
+double PeriodicityTest::computeSigma(double log_probability) {
+  if (log_probability >= std::log(.5)) return 0.;
+
+  // Find the lower bound of the tail by bisection. The tail beyond sqrt(-2 log p) is smaller than p.
+  double sigma_min = 0.;
+  double sigma_max = std::max(1., std::sqrt(-2. * log_probability));
+  for (int iteration = 0; iteration < 100; ++iteration) {
+    double sigma = .5 * (sigma_min + sigma_max);
+    if (computeLogTail(sigma) > log_probability) sigma_min = sigma;
+    else sigma_max = sigma;
+  }
+  return .5 * (sigma_min + sigma_max);
+}
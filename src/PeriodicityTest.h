@@ -0,0 +1,84 @@
+/** \file PeriodicityTest.h
+    \brief Declaration of PeriodicityTest class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PeriodicityTest_h
+#define pulsePhase_PeriodicityTest_h
+
+#include <vector>
+
+/** \class PeriodicityTest
+    \brief Running sums of trigonometric moments of phases, from which the Z^2_m statistic and the H-test statistic
+           (de Jager, Raubenheimer & Swanepoel 1989) are computed, so that a periodicity test needs no extra pass over
+           the events. Moments of all harmonics are computed from the cosine and the sine of the first harmonic by the
+           angle-addition recurrence, a chunk of events at a time, so that the inner loops over events can be
+           vectorized by the compiler. Events may be weighted, in which case the statistics are normalized by the sum
+           of squared weights (Kerr 2011). Phases or weights which are not finite are ignored. A PeriodicityTest object
+           is not thread-safe; threads should fill their own objects and merge them in a fixed order, so that the
+           statistics do not depend on the order in which the threads finish.
+*/
+class PeriodicityTest {
+  public:
+    /** \brief Construct a PeriodicityTest object with no events.
+        \param max_harmonic Maximum number of harmonics to accumulate moments for.
+    */
+    explicit PeriodicityTest(long max_harmonic);
+
+    /// \brief Return the maximum number of harmonics.
+    long getMaxHarmonic() const;
+
+    /** \brief Add events to the sums.
+        \param phase_begin Pointer to the phase of the first event.
+        \param phase_end Pointer to one past the phase of the last event.
+        \param weight_begin Pointer to the weight of the first event, or a null pointer if events are not weighted.
+    */
+    void fill(const double * phase_begin, const double * phase_end, const double * weight_begin = 0);
+
+    /** \brief Add the sums of another object with the same maximum number of harmonics to the sums of this object.
+        \param other Object to add.
+    */
+    void merge(const PeriodicityTest & other);
+
+    /// \brief Return the number of events added to the sums.
+    long getNumEvent() const;
+
+    /** \brief Return the Z^2_m statistic.
+        \param num_harmonic Number of harmonics m, from 1 to the maximum number of harmonics.
+    */
+    double computeZ2(long num_harmonic) const;
+
+    /** \brief Return the H-test statistic, which is the maximum of Z^2_m - 4 * m + 4 over m up to the maximum number
+               of harmonics.
+        \param num_harmonic Number of harmonics at which the maximum is attained, set by this method.
+    */
+    double computeH(long & num_harmonic) const;
+
+    /** \brief Return the natural logarithm of the chance probability of the Z^2_m statistic exceeding the given
+               value, which follows the chi-square distribution with 2 * m degrees of freedom.
+        \param z2 Value of the Z^2_m statistic.
+        \param num_harmonic Number of harmonics m.
+    */
+    static double computeZ2LogProbability(double z2, long num_harmonic);
+
+    /** \brief Return the natural logarithm of the chance probability of the H-test statistic exceeding the given
+               value, exp(-0.4 * H) by de Jager & Buesching (2010).
+        \param h Value of the H-test statistic.
+    */
+    static double computeHLogProbability(double h);
+
+    /** \brief Return the significance in units of the standard deviation of a normal distribution whose one-sided
+               tail has the given chance probability.
+        \param log_probability Natural logarithm of the chance probability.
+    */
+    static double computeSigma(double log_probability);
+
+  private:
+    long m_max_harmonic;
+    long m_num_event;
+    double m_square_weight_sum;
+    std::vector<double> m_cos_sum_cont;
+    std::vector<double> m_sin_sum_cont;
+};
+
+#endif
@@ -0,0 +1,267 @@
+/** \file PhaseEngine.cxx
+    \brief Implementation of PhaseEngine class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "PhaseEngine.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "BaryDelayCache.h"
+#include "BinaryDemodulator.h"
+#include "DelayTable.h"
+#include "PhaseTime.h"
+#include "SpinPhaseTable.h"
+
+#include "pulsarDb/EphChooser.h"
+#include "pulsarDb/EphComputer.h"
+#include "pulsarDb/PulsarDb.h"
+#include "pulsarDb/PulsarEph.h"
+
+#include "st_facilities/Env.h"
+#include "st_facilities/FileSys.h"
+
+#include "timeSystem/AbsoluteTime.h"
+#include "timeSystem/Duration.h"
+#include "timeSystem/ElapsedTime.h"
+#include "timeSystem/MjdFormat.h"
+
+namespace {
+
+  /// \brief Mutex to apply arrival time corrections by one thread at a time, shared by all PhaseEngine objects.
+  std::mutex s_library_mutex;
+
+  /** \brief Create a copy of the given EphComputer object, loaded with the same spin and orbital ephemerides.
+      \param computer EphComputer to copy.
+      \param chooser Ephemeris chooser to be used by the copy.
+  */
+  std::unique_ptr<pulsarDb::EphComputer> copyEphComputer(const pulsarDb::EphComputer & computer,
+    const pulsarDb::EphChooser & chooser) {
+    std::unique_ptr<pulsarDb::EphComputer> computer_copy(new pulsarDb::EphComputer(chooser));
+    const pulsarDb::PulsarEphCont & pulsar_eph_cont(computer.getPulsarEphCont());
+    for (pulsarDb::PulsarEphCont::const_iterator itor = pulsar_eph_cont.begin(); itor != pulsar_eph_cont.end(); ++itor) {
+      computer_copy->loadPulsarEph(**itor);
+    }
+    const pulsarDb::OrbitalEphCont & orbital_eph_cont(computer.getOrbitalEphCont());
+    for (pulsarDb::OrbitalEphCont::const_iterator itor = orbital_eph_cont.begin(); itor != orbital_eph_cont.end(); ++itor) {
+      computer_copy->loadOrbitalEph(**itor);
+    }
+    return computer_copy;
+  }
+
+}
+
+/** \class PhaseEngine::Workspace
+    \brief State of phase computation owned by one calling thread at a time.
+*/
+class PhaseEngine::Workspace {
+  public:
+    /** \brief Construct a Workspace object.
+        \param computer EphComputer whose ephemerides are copied.
+        \param chooser Ephemeris chooser whose copy is used.
+        \param setting Settings of phase computation.
+    */
+    Workspace(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser, const Setting & setting);
+
+    /** \brief Compute phases for a block of event times, no more than the block size.
+        \param time_begin Pointer to the first event time.
+        \param time_end Pointer to one past the last event time.
+        \param phase_begin Pointer to the first element of the array to store the phases in.
+    */
+    void compute(const double * time_begin, const double * time_end, double * phase_begin);
+
+  private:
+    const Setting & m_setting;
+    std::unique_ptr<pulsarDb::EphChooser> m_chooser;
+    std::unique_ptr<pulsarDb::EphComputer> m_computer;
+    timeSystem::AbsoluteTime m_abs_time_origin;
+    PhaseTime m_time_origin;
+    std::unique_ptr<BaryDelayCache> m_delay_cache;
+    DelayTable::FunctionType m_offset_function;
+    std::unique_ptr<DelayTable> m_offset_table;
+    std::unique_ptr<BinaryDemodulator> m_demodulator;
+    std::unique_ptr<SpinPhaseTable> m_phase_table;
+    std::vector<PhaseTime> m_time_block;
+    std::vector<long> m_poly_block;
+    std::vector<double> m_elapsed_block;
+};
+
+PhaseEngine::Workspace::Workspace(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser,
+  const Setting & setting): m_setting(setting), m_chooser(chooser.clone()), m_computer(copyEphComputer(computer, *m_chooser)),
+  m_abs_time_origin(setting.m_time_system_name, timeSystem::Mjd(setting.m_mjd_ref_int, setting.m_mjd_ref_frac)),
+  m_time_origin(setting.m_mjd_ref_int, setting.m_mjd_ref_frac * PhaseTime::s_sec_per_day), m_delay_cache(nullptr),
+  m_offset_function(), m_offset_table(nullptr), m_demodulator(nullptr), m_phase_table(nullptr), m_time_block(),
+  m_poly_block(), m_elapsed_block() {
+  // Set up the computation of the offset of event times in TDB from the sum of the reference MJD and the mission
+  // elapsed time, in the same way as PhaseToolApp does.
+  if (m_setting.m_bary) {
+    m_delay_cache.reset(new BaryDelayCache(m_setting.m_sc_file, m_setting.m_sc_table, m_setting.m_solar_eph,
+      m_setting.m_ang_tol, m_setting.m_bary_tol, m_setting.m_sc_window_size));
+    m_delay_cache->setTimeOrigin(m_setting.m_time_system_name, timeSystem::Mjd(m_setting.m_mjd_ref_int,
+      m_setting.m_mjd_ref_frac));
+  } else if ("TDB" != m_setting.m_time_system_name) {
+    timeSystem::AbsoluteTime abs_time_origin(m_abs_time_origin);
+    std::string time_system_name(m_setting.m_time_system_name);
+    PhaseTime time_origin(m_time_origin);
+    m_offset_function = [abs_time_origin, time_system_name, time_origin](double elapsed_time) {
+      timeSystem::AbsoluteTime abs_time(abs_time_origin + timeSystem::ElapsedTime(time_system_name,
+        timeSystem::Duration(0, elapsed_time)));
+      return (PhaseTime::create(abs_time) - time_origin) - elapsed_time;
+    };
+    if (0. < m_setting.m_bary_tol) {
+      m_offset_table.reset(new DelayTable(m_offset_function, m_setting.m_bary_tol,
+        BaryDelayCache::s_max_geocentric_derivative));
+    }
+  }
+  if (m_setting.m_bin) m_demodulator.reset(new BinaryDemodulator(*m_computer, *m_chooser));
+  if (PULSE_PHASE == m_setting.m_phase_type && 0. < m_setting.m_bary_tol) {
+    m_phase_table.reset(new SpinPhaseTable(*m_computer, *m_chooser, m_setting.m_phase_offset));
+  }
+
+  // Allocate buffers for a block of events.
+  m_time_block.reserve(m_setting.m_block_size);
+  m_poly_block.resize(m_setting.m_block_size);
+  m_elapsed_block.resize(m_setting.m_block_size);
+}
+
+void PhaseEngine::Workspace::compute(const double * time_begin, const double * time_end, double * phase_begin) {
+  // Apply arrival time corrections to event times, one thread at a time. All calls into the pulsarDb and timeSystem
+  // libraries, including those which create AbsoluteTime objects, are made while the library mutex is locked.
+  std::unique_lock<std::mutex> lock(s_library_mutex);
+  m_time_block.clear();
+  std::pair<double, double> src_position(m_setting.m_ra, m_setting.m_dec);
+  for (const double * time_itor = time_begin; time_itor != time_end; ++time_itor) {
+    double elapsed_time = *time_itor;
+    double offset = 0.;
+    if (m_delay_cache.get()) {
+      if (m_setting.m_vary_ra_dec) {
+        src_position = m_computer->calcSkyPosition(m_abs_time_origin + timeSystem::ElapsedTime(
+          m_setting.m_time_system_name, timeSystem::Duration(0, elapsed_time)));
+      }
+      offset = m_delay_cache->computeDelay(elapsed_time, src_position.first, src_position.second);
+    } else if (m_offset_table.get()) {
+      offset = m_offset_table->compute(elapsed_time);
+    } else if (m_offset_function) {
+      offset = m_offset_function(elapsed_time);
+    }
+    PhaseTime event_time(m_time_origin);
+    event_time += elapsed_time + offset;
+    if (m_demodulator.get()) m_demodulator->demodulate(event_time);
+    m_time_block.push_back(event_time);
+  }
+
+  // Compute phases by the EphComputer without the table of polynomials, still one thread at a time.
+  std::vector<PhaseTime>::size_type num_event = m_time_block.size();
+  if (!m_phase_table.get()) {
+    for (std::vector<PhaseTime>::size_type event_index = 0; event_index < num_event; ++event_index) {
+      timeSystem::AbsoluteTime abs_time(m_time_block[event_index].getAbsoluteTime());
+      phase_begin[event_index] = (PULSE_PHASE == m_setting.m_phase_type ?
+        m_computer->calcPulsePhase(abs_time, m_setting.m_phase_offset) :
+        m_computer->calcOrbitalPhase(abs_time, m_setting.m_phase_offset));
+    }
+    return;
+  }
+
+  // Find polynomials for event times, building the table of polynomials as needed by the EphComputer.
+  long num_exact = 0;
+  for (std::vector<PhaseTime>::size_type event_index = 0; event_index < num_event; ++event_index) {
+    m_poly_block[event_index] = m_phase_table->findPolynomial(m_time_block[event_index], m_elapsed_block[event_index]);
+    if (m_poly_block[event_index] < 0) ++num_exact;
+  }
+
+  // Evaluate polynomials in parallel with other threads. SpinPhaseTable::evaluate is pure arithmetic on the given
+  // arrays, and calls no library.
+  lock.unlock();
+  SpinPhaseTable::evaluate(m_phase_table->getCoefficient(), &m_poly_block[0], &m_poly_block[0] + num_event,
+    &m_elapsed_block[0], phase_begin);
+
+  // Compute phases of events not covered by polynomials by the EphComputer, one thread at a time again.
+  if (0 < num_exact) {
+    lock.lock();
+    for (std::vector<PhaseTime>::size_type event_index = 0; event_index < num_event; ++event_index) {
+      if (m_poly_block[event_index] < 0) {
+        phase_begin[event_index] = m_computer->calcPulsePhase(m_time_block[event_index].getAbsoluteTime(),
+          m_setting.m_phase_offset);
+      }
+    }
+  }
+}
+
+PhaseEngine::Setting::Setting(): m_phase_type(PULSE_PHASE), m_phase_offset(0.), m_time_system_name("TT"),
+  m_mjd_ref_int(51910), m_mjd_ref_frac(7.428703703703703e-4), m_bary(true), m_bin(false), m_sc_file(),
+  m_sc_table("SC_DATA"), m_solar_eph("JPL DE405"), m_ang_tol(1.e-8), m_bary_tol(1.e-7), m_sc_window_size(0),
+  m_vary_ra_dec(false), m_ra(0.), m_dec(0.), m_block_size(10000) {}
+
+PhaseEngine::PhaseEngine(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser,
+  const Setting & setting): m_chooser(chooser.clone()), m_computer(copyEphComputer(computer, *m_chooser)),
+  m_setting(setting), m_mutex(), m_workspace_cont(), m_free_workspace_cont() {
+  if (0 == m_setting.m_block_size) throw std::runtime_error("Block size must be positive");
+  if (m_setting.m_bary_tol < 0.) throw std::runtime_error("Tolerance of barycentric delays must be zero or positive");
+
+  // Create the first workspace now, so that errors in the settings are reported by the constructor.
+  std::lock_guard<std::mutex> lock(s_library_mutex);
+  m_workspace_cont.push_back(std::unique_ptr<Workspace>(new Workspace(*m_computer, *m_chooser, m_setting)));
+  m_free_workspace_cont.push_back(m_workspace_cont.back().get());
+}
+
+PhaseEngine::~PhaseEngine() {
+  std::lock_guard<std::mutex> lock(s_library_mutex);
+  m_workspace_cont.clear();
+}
+
+void PhaseEngine::computePhase(const double * time_begin, const double * time_end, double * phase_begin) const {
+  Workspace & workspace(acquireWorkspace());
+  try {
+    while (time_begin != time_end) {
+      const double * block_end = time_begin + std::min<std::size_t>(m_setting.m_block_size, time_end - time_begin);
+      workspace.compute(time_begin, block_end, phase_begin);
+      phase_begin += block_end - time_begin;
+      time_begin = block_end;
+    }
+  } catch (...) {
+    releaseWorkspace(workspace);
+    throw;
+  }
+  releaseWorkspace(workspace);
+}
+
+void PhaseEngine::loadEph(const std::string & psrdb_file, const std::string & psr_name, pulsarDb::EphComputer & computer) {
+  std::string tpl_file = st_facilities::Env::appendFileName(st_facilities::Env::getDataDir("pulsarDb"), "PulsarDb.tpl");
+  pulsarDb::PulsarDb data_base(tpl_file);
+  st_facilities::FileSys::FileNameCont file_name_cont(st_facilities::FileSys::expandFileList(psrdb_file));
+  for (st_facilities::FileSys::FileNameCont::const_iterator itor = file_name_cont.begin(); itor != file_name_cont.end();
+    ++itor) {
+    data_base.load(*itor);
+  }
+  data_base.filterName(psr_name);
+  computer.load(data_base);
+}
+
+PhaseEngine::Workspace & PhaseEngine::acquireWorkspace() const {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_free_workspace_cont.empty()) {
+      Workspace * workspace = m_free_workspace_cont.back();
+      m_free_workspace_cont.pop_back();
+      return *workspace;
+    }
+  }
+
+  // Create a workspace for one more thread, opening the spacecraft file one thread at a time.
+  std::unique_ptr<Workspace> workspace(nullptr);
+  {
+    std::lock_guard<std::mutex> library_lock(s_library_mutex);
+    workspace.reset(new Workspace(*m_computer, *m_chooser, m_setting));
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_workspace_cont.push_back(std::move(workspace));
+  m_free_workspace_cont.reserve(m_workspace_cont.size());
+  return *m_workspace_cont.back();
+}
+
+void PhaseEngine::releaseWorkspace(Workspace & workspace) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_free_workspace_cont.push_back(&workspace);
+}
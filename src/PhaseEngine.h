@@ -0,0 +1,124 @@
+/** \file PhaseEngine.h
+    \brief Declaration of PhaseEngine class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PhaseEngine_h
+#define pulsePhase_PhaseEngine_h
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pulsarDb {
+  class EphChooser;
+  class EphComputer;
+}
+
+/** \class PhaseEngine
+    \brief Phase computation for arrays of event times in mission elapsed time, for use by other programs without
+           parameter files or event files. Arrival time corrections and phase computation are the same as those of
+           gtpphase and gtophase with the same barytol parameter.
+
+           A PhaseEngine object may be used by any number of threads at the same time. Each thread calling
+           computePhase method is given a workspace of its own, which holds copies of the ephemerides, the spacecraft
+           file handle, and buffers for a block of events. Workspaces are created when more threads call at the same
+           time than ever before, and are reused afterwards, so that a call allocates no memory once the number of
+           concurrent callers and the range of event times have been seen. The pulsarDb and timeSystem libraries
+           are not assumed to be reentrant, so all calls into them are made by one thread at a time under a mutex
+           shared by all PhaseEngine objects. This includes arrival time corrections, creation of AbsoluteTime objects,
+           building of the table of polynomials for pulse phases, and phases computed by the EphComputer. Only the
+           evaluation of the polynomials, which are used for pulse phases if m_bary_tol is positive, runs in parallel.
+*/
+class PhaseEngine {
+  public:
+    /// \brief Type of phase to be computed.
+    enum PhaseType_e { PULSE_PHASE, ORBITAL_PHASE };
+
+    /// \brief Settings of phase computation.
+    struct Setting {
+      /// \brief Construct a Setting object with default values for Fermi event times and pulse phases.
+      Setting();
+
+      PhaseType_e m_phase_type;
+      double m_phase_offset;
+      std::string m_time_system_name;
+      long m_mjd_ref_int;
+      double m_mjd_ref_frac;
+      bool m_bary;
+      bool m_bin;
+      std::string m_sc_file;
+      std::string m_sc_table;
+      std::string m_solar_eph;
+      double m_ang_tol;
+      double m_bary_tol;
+      long m_sc_window_size;
+      bool m_vary_ra_dec;
+      double m_ra;
+      double m_dec;
+      std::size_t m_block_size;
+    };
+
+    /** \brief Construct a PhaseEngine object. The ephemerides loaded in the given EphComputer object are copied,
+               so that the EphComputer object and the ephemeris chooser need not outlive this object.
+        \param computer EphComputer loaded with spin and orbital ephemerides.
+        \param chooser Ephemeris chooser to choose an ephemeris for an event time.
+        \param setting Settings of phase computation. Event times are mission elapsed times in seconds, measured in the
+               time system m_time_system_name from the reference MJD m_mjd_ref_int + m_mjd_ref_frac. Barycentric
+               corrections are applied if m_bary is true, with the spacecraft file m_sc_file[m_sc_table] and the solar
+               system ephemeris m_solar_eph, to the source position (m_ra, m_dec) in degrees or to the source position
+               of the spin ephemeris of each event if m_vary_ra_dec is true. Binary demodulation is applied if m_bin is
+               true. Barycentric delays are interpolated to an accuracy of m_bary_tol seconds, and source positions
+               within m_ang_tol degrees share interpolated delays. If m_bary_tol is zero, delays and pulse phases are
+               computed exactly for every event. The spacecraft file is read m_sc_window_size rows at
+               a time if m_sc_window_size is positive. Events are processed m_block_size at a time.
+    */
+    PhaseEngine(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser, const Setting & setting);
+
+    /// \brief Destruct this PhaseEngine object.
+    ~PhaseEngine();
+
+    /** \brief Compute a phase for each of the given event times.
+        \param time_begin Pointer to the first event time, in mission elapsed time in seconds.
+        \param time_end Pointer to one past the last event time.
+        \param phase_begin Pointer to the first element of the array to store the phases in, which must have as many
+               elements as the event times.
+    */
+    void computePhase(const double * time_begin, const double * time_end, double * phase_begin) const;
+
+    /** \brief Load spin and orbital ephemerides of a pulsar from pulsar ephemerides database file(s) into the given
+               EphComputer object. Ephemerides given by values, such as pulsarDb::FrequencyEph objects, may be loaded
+               by EphComputer::loadPulsarEph method instead.
+        \param psrdb_file Name of the database file, or the name of a list file preceded by "@".
+        \param psr_name Name of the pulsar.
+        \param computer EphComputer to load the ephemerides into.
+    */
+    static void loadEph(const std::string & psrdb_file, const std::string & psr_name, pulsarDb::EphComputer & computer);
+
+  private:
+    class Workspace;
+    typedef std::vector<std::unique_ptr<Workspace> > WorkspaceCont;
+
+    std::unique_ptr<pulsarDb::EphChooser> m_chooser;
+    std::unique_ptr<pulsarDb::EphComputer> m_computer;
+    Setting m_setting;
+    mutable std::mutex m_mutex;
+    mutable WorkspaceCont m_workspace_cont;
+    mutable std::vector<Workspace *> m_free_workspace_cont;
+
+    /// \brief Take a workspace which is not used by other threads, creating one if none is available.
+    Workspace & acquireWorkspace() const;
+
+    /** \brief Give back a workspace taken by acquireWorkspace method.
+        \param workspace Workspace to give back.
+    */
+    void releaseWorkspace(Workspace & workspace) const;
+
+    // Prohibit copying.
+    PhaseEngine(const PhaseEngine &);
+    PhaseEngine & operator =(const PhaseEngine &);
+};
+
+#endif
@@ -0,0 +1,116 @@
+/** \file PhaseProfile.cxx
+    \brief Implementation of PhaseProfile class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "PhaseProfile.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fitsio.h"
+
+namespace {
+
+  /** \brief Throw an exception describing a CFITSIO error if the given status is not zero.
+      \param status CFITSIO status code.
+      \param file_name Name of the file being written.
+  */
+  void checkStatus(int status, const std::string & file_name) {
+    if (0 == status) return;
+    char message[FLEN_ERRMSG];
+    fits_get_errstatus(status, message);
+    fits_clear_errmsg();
+    throw std::runtime_error("Cannot write phase profile into file \"" + file_name + "\": " + message);
+  }
+
+}
+
+PhaseProfile::PhaseProfile(long num_bin): m_num_bin(num_bin), m_count_cont(), m_square_sum_cont() {
+  if (m_num_bin <= 0) throw std::runtime_error("Number of phase bins must be positive");
+  m_count_cont.resize(m_num_bin, 0.);
+  m_square_sum_cont.resize(m_num_bin, 0.);
+}
+
+long PhaseProfile::getNumBin() const {
+  return m_num_bin;
+}
+
+void PhaseProfile::fill(const double * phase_begin, const double * phase_end, const double * weight_begin) {
+  for (const double * phase_itor = phase_begin; phase_itor != phase_end; ++phase_itor) {
+    double phase = *phase_itor;
+    double weight = (weight_begin ? weight_begin[phase_itor - phase_begin] : 1.);
+    if (!std::isfinite(phase) || !std::isfinite(weight)) continue;
+
+    // Compute the bin index, guarding against phases at or beyond the edges by rounding errors.
+    long bin_index = long(std::floor(phase * m_num_bin));
+    if (bin_index < 0) bin_index = 0;
+    else if (bin_index >= m_num_bin) bin_index = m_num_bin - 1;
+    m_count_cont[bin_index] += weight;
+    m_square_sum_cont[bin_index] += weight * weight;
+  }
+}
+
+void PhaseProfile::merge(const PhaseProfile & other) {
+  if (other.m_num_bin != m_num_bin) throw std::logic_error("Cannot merge phase profiles with different numbers of bins");
+  for (long bin_index = 0; bin_index < m_num_bin; ++bin_index) {
+    m_count_cont[bin_index] += other.m_count_cont[bin_index];
+    m_square_sum_cont[bin_index] += other.m_square_sum_cont[bin_index];
+  }
+}
+
+const std::vector<double> & PhaseProfile::getCount() const {
+  return m_count_cont;
+}
+
+const std::vector<double> & PhaseProfile::getSquareSum() const {
+  return m_square_sum_cont;
+}
+
+void PhaseProfile::write(const std::string & file_name, const std::string & phase_field, const std::string & weight_field,
+  bool clobber) const {
+  // Compute columns of the output table.
+  std::vector<double> phase_min_cont(m_num_bin);
+  std::vector<double> phase_max_cont(m_num_bin);
+  std::vector<double> error_cont(m_num_bin);
+  for (long bin_index = 0; bin_index < m_num_bin; ++bin_index) {
+    phase_min_cont[bin_index] = double(bin_index) / m_num_bin;
+    phase_max_cont[bin_index] = double(bin_index + 1) / m_num_bin;
+    error_cont[bin_index] = std::sqrt(m_square_sum_cont[bin_index]);
+  }
+
+  // Create the output file, with "!" prepended to the name to overwrite an existing file.
+  int status = 0;
+  fitsfile * fits_file = 0;
+  std::string url((clobber ? "!" : "") + file_name);
+  fits_create_file(&fits_file, url.c_str(), &status);
+  checkStatus(status, file_name);
+
+  // Create the table, write header keywords and columns, and close the file even if an error occurs.
+  char ttype[][FLEN_VALUE] = { "PHASE_MIN", "PHASE_MAX", "COUNTS", "ERROR" };
+  char tform[][FLEN_VALUE] = { "1D", "1D", "1D", "1D" };
+  char tunit[][FLEN_VALUE] = { "", "", "", "" };
+  char * ttype_ptr[] = { ttype[0], ttype[1], ttype[2], ttype[3] };
+  char * tform_ptr[] = { tform[0], tform[1], tform[2], tform[3] };
+  char * tunit_ptr[] = { tunit[0], tunit[1], tunit[2], tunit[3] };
+  fits_create_tbl(fits_file, BINARY_TBL, m_num_bin, 4, ttype_ptr, tform_ptr, tunit_ptr, "PROFILE", &status);
+  long num_bin = m_num_bin;
+  fits_update_key(fits_file, TLONG, "NBINS", &num_bin, "Number of phase bins", &status);
+  std::string phase_field_value(phase_field);
+  fits_update_key(fits_file, TSTRING, "PHASECOL", &phase_field_value[0], "Name of the phase column", &status);
+  std::string weight_field_value(weight_field);
+  fits_update_key(fits_file, TSTRING, "WEIGHCOL", &weight_field_value[0], "Name of the weight column", &status);
+  fits_write_col_dbl(fits_file, 1, 1, 1, m_num_bin, &phase_min_cont[0], &status);
+  fits_write_col_dbl(fits_file, 2, 1, 1, m_num_bin, &phase_max_cont[0], &status);
+  fits_write_col_dbl(fits_file, 3, 1, 1, m_num_bin, const_cast<double *>(&m_count_cont[0]), &status);
+  fits_write_col_dbl(fits_file, 4, 1, 1, m_num_bin, &error_cont[0], &status);
+  int close_status = 0;
+  if (0 != status) {
+    fits_delete_file(fits_file, &close_status);
+  } else {
+    fits_close_file(fits_file, &status);
+  }
+  checkStatus(status, file_name);
+}
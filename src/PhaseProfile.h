@@ -0,0 +1,63 @@
+/** \file PhaseProfile.h
+    \brief Declaration of PhaseProfile class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PhaseProfile_h
+#define pulsePhase_PhaseProfile_h
+
+#include <string>
+#include <vector>
+
+/** \class PhaseProfile
+    \brief Histogram of phases in equal-width bins from 0 to 1, accumulated while phases are assigned, so that a pulse
+           profile or an orbital light curve is obtained without reading the event file(s) again. Each event adds its
+           weight, or 1 if unweighted, to the bin containing its phase, and the sum of squared weights is kept for the
+           statistical error of each bin. Phases which are not finite are ignored. A PhaseProfile object is not
+           thread-safe; threads should fill their own objects and merge them at the end.
+*/
+class PhaseProfile {
+  public:
+    /** \brief Construct an empty PhaseProfile object.
+        \param num_bin Number of phase bins.
+    */
+    explicit PhaseProfile(long num_bin);
+
+    /// \brief Return the number of phase bins.
+    long getNumBin() const;
+
+    /** \brief Add events to the histogram.
+        \param phase_begin Pointer to the phase of the first event.
+        \param phase_end Pointer to one past the phase of the last event.
+        \param weight_begin Pointer to the weight of the first event, or a null pointer if events are not weighted.
+    */
+    void fill(const double * phase_begin, const double * phase_end, const double * weight_begin = 0);
+
+    /** \brief Add the contents of another histogram with the same number of bins to this histogram.
+        \param other Histogram to add.
+    */
+    void merge(const PhaseProfile & other);
+
+    /// \brief Return the sum of weights in each bin.
+    const std::vector<double> & getCount() const;
+
+    /// \brief Return the sum of squared weights in each bin.
+    const std::vector<double> & getSquareSum() const;
+
+    /** \brief Write the histogram into a FITS binary table named PROFILE, with columns PHASE_MIN, PHASE_MAX, COUNTS, and
+               ERROR, one row per bin.
+        \param file_name Name of the output file.
+        \param phase_field Name of the phase column that was histogrammed, recorded in the header.
+        \param weight_field Name of the weight column, or NONE if events are not weighted, recorded in the header.
+        \param clobber Flag to overwrite an existing file.
+    */
+    void write(const std::string & file_name, const std::string & phase_field, const std::string & weight_field,
+      bool clobber) const;
+
+  private:
+    long m_num_bin;
+    std::vector<double> m_count_cont;
+    std::vector<double> m_square_sum_cont;
+};
+
+#endif
@@ -0,0 +1,316 @@
+/** \file PhaseServer.cxx
+    \brief Implementation of PhaseServer class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "PhaseServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "PulsePhaseApp.h"
+
+#include "st_app/AppParGroup.h"
+
+#include "st_stream/st_stream.h"
+
+#include "timeSystem/BaryTimeComputer.h"
+#include "timeSystem/TimeSystem.h"
+
+namespace {
+
+  /// \brief Pipe to notify the server of termination of child processes.
+  int s_child_pipe[2] = { -1, -1 };
+
+  /** \brief Signal handler for SIGCHLD, which wakes up the server waiting for connections.
+      \param signal_number Signal number.
+  */
+  extern "C" void notifyChild(int /* signal_number */) {
+    int saved_errno = errno;
+    char byte = 0;
+    ssize_t num_written = write(s_child_pipe[1], &byte, 1);
+    (void)num_written;
+    errno = saved_errno;
+  }
+
+  /** \brief Fill the address of a Unix domain socket with the given name.
+      \param socket_name Name of the socket.
+      \param address Address to fill.
+  */
+  void setAddress(const std::string & socket_name, struct sockaddr_un & address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_name.size() >= sizeof(address.sun_path)) {
+      throw std::runtime_error("Name of socket \"" + socket_name + "\" is too long");
+    }
+    std::strcpy(address.sun_path, socket_name.c_str());
+  }
+
+  /** \brief Write all the given bytes to a file descriptor, returning false on error.
+      \param fd File descriptor to write to.
+      \param data Bytes to write.
+  */
+  bool writeAll(int fd, const std::string & data) {
+    for (std::string::size_type offset = 0; offset < data.size(); ) {
+      ssize_t num_written = write(fd, data.data() + offset, data.size() - offset);
+      if (num_written < 0) {
+        if (EINTR == errno) continue;
+        return false;
+      }
+      offset += num_written;
+    }
+    return true;
+  }
+
+  /// \brief Marker which precedes the exit status of a job at the end of the messages sent to the client.
+  const std::string s_exit_marker("\004EXIT ");
+
+}
+
+PhaseServer::PhaseServer(const std::string & socket_name, long max_job): m_socket_name(socket_name),
+  m_max_job(max_job), m_listen_fd(-1), m_default_par_cont(), m_job_dict() {
+  if (m_max_job <= 0) throw std::runtime_error("Maximum number of jobs must be positive");
+
+  // Create the socket, replacing a socket left by a server which is no longer running. The socket is created with
+  // mode 0600, so that only the owner of the server can connect and run jobs with the privileges of the server.
+  struct sockaddr_un address;
+  setAddress(m_socket_name, address);
+  m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (-1 == m_listen_fd) throw std::runtime_error("Cannot create a socket");
+  unlink(m_socket_name.c_str());
+  mode_t saved_mask = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+  int bind_status = bind(m_listen_fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address));
+  umask(saved_mask);
+  if (0 != bind_status || 0 != chmod(m_socket_name.c_str(), S_IRUSR | S_IWUSR) || 0 != listen(m_listen_fd, SOMAXCONN)) {
+    close(m_listen_fd);
+    throw std::runtime_error("Cannot listen to socket \"" + m_socket_name + "\"");
+  }
+}
+
+PhaseServer::~PhaseServer() {
+  close(m_listen_fd);
+  unlink(m_socket_name.c_str());
+}
+
+void PhaseServer::loadResource(const std::string & leap_sec_file, const std::string & solar_eph,
+  const std::string & psrdb_cache) {
+  // Load the leap second table and the solar system ephemeris, so that child processes inherit them.
+  timeSystem::TimeSystem::setDefaultLeapSecFileName(leap_sec_file);
+  timeSystem::TimeSystem::loadLeapSeconds(leap_sec_file == "DEFAULT" ? "" : leap_sec_file, true);
+  timeSystem::BaryTimeComputer::getComputer(solar_eph);
+
+  // Use the same resources in all jobs unless overridden.
+  m_default_par_cont.clear();
+  m_default_par_cont.push_back(std::make_pair("leapsecfile", leap_sec_file));
+  m_default_par_cont.push_back(std::make_pair("solareph", solar_eph));
+  m_default_par_cont.push_back(std::make_pair("psrdbcache", psrdb_cache));
+}
+
+void PhaseServer::run() {
+  // Initialize the standard streams for messages of jobs, as done for the application.
+  st_stream::InitStdStreams("gtpphase", 2, false);
+
+  // Wake up on termination of child processes, as well as on connections.
+  if (0 != pipe(s_child_pipe)) throw std::runtime_error("Cannot create a pipe");
+  for (int index = 0; index < 2; ++index) fcntl(s_child_pipe[index], F_SETFL, O_NONBLOCK);
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = notifyChild;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  if (0 != sigaction(SIGCHLD, &action, 0)) throw std::runtime_error("Cannot handle termination of jobs");
+
+  // Keep running when a client disconnects before its job finishes.
+  signal(SIGPIPE, SIG_IGN);
+
+  while (true) {
+    // Wait for connections only while another job can be started.
+    struct pollfd poll_cont[2];
+    poll_cont[0].fd = s_child_pipe[0];
+    poll_cont[0].events = POLLIN;
+    poll_cont[1].fd = m_listen_fd;
+    poll_cont[1].events = POLLIN;
+    nfds_t num_poll = (long(m_job_dict.size()) < m_max_job ? 2 : 1);
+    if (-1 == poll(poll_cont, num_poll, -1)) {
+      if (EINTR == errno) continue;
+      throw std::runtime_error("Cannot wait for connections");
+    }
+
+    if (poll_cont[0].revents & POLLIN) {
+      char buffer[64];
+      while (read(s_child_pipe[0], buffer, sizeof(buffer)) > 0) {}
+      finishJob();
+    }
+    if (2 == num_poll && (poll_cont[1].revents & POLLIN)) {
+      int connection_fd = accept(m_listen_fd, 0, 0);
+      if (-1 != connection_fd) startJob(connection_fd);
+    }
+  }
+}
+
+int PhaseServer::submitJob(const std::string & socket_name, const ParCont & par_cont, std::ostream & os) {
+  // Connect to the server.
+  struct sockaddr_un address;
+  setAddress(socket_name, address);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (-1 == fd) throw std::runtime_error("Cannot create a socket");
+  if (0 != connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address))) {
+    close(fd);
+    throw std::runtime_error("Cannot connect to socket \"" + socket_name + "\"");
+  }
+
+  // Send parameters, one per line, followed by an empty line.
+  std::ostringstream oss;
+  for (ParCont::const_iterator itor = par_cont.begin(); itor != par_cont.end(); ++itor) {
+    if (std::string::npos != itor->first.find_first_of("=\n") || std::string::npos != itor->second.find('\n')) {
+      close(fd);
+      throw std::runtime_error("Invalid parameter \"" + itor->first + "\"");
+    }
+    oss << itor->first << "=" << itor->second << "\n";
+  }
+  oss << "\n";
+  if (!writeAll(fd, oss.str())) {
+    close(fd);
+    throw std::runtime_error("Cannot send a job to socket \"" + socket_name + "\"");
+  }
+
+  // Pass messages through as they arrive, holding back the end which may contain the exit status.
+  std::string pending;
+  char buffer[4096];
+  for (ssize_t num_read = read(fd, buffer, sizeof(buffer)); num_read != 0; num_read = read(fd, buffer, sizeof(buffer))) {
+    if (num_read < 0) {
+      if (EINTR == errno) continue;
+      close(fd);
+      throw std::runtime_error("Cannot receive messages from socket \"" + socket_name + "\"");
+    }
+    pending.append(buffer, num_read);
+    std::string::size_type num_hold = 32;
+    if (pending.size() > num_hold) {
+      os.write(pending.data(), pending.size() - num_hold);
+      pending.erase(0, pending.size() - num_hold);
+    }
+  }
+  close(fd);
+
+  // Extract the exit status.
+  std::string::size_type marker_pos = pending.rfind(s_exit_marker);
+  if (std::string::npos == marker_pos) {
+    os << pending;
+    throw std::runtime_error("Connection to socket \"" + socket_name + "\" was closed before the job finished");
+  }
+  os.write(pending.data(), marker_pos);
+  os.flush();
+  return std::atoi(pending.c_str() + marker_pos + s_exit_marker.size());
+}
+
+void PhaseServer::startJob(int connection_fd) {
+  std::cout.flush();
+  std::cerr.flush();
+  pid_t pid = fork();
+  if (-1 == pid) {
+    writeAll(connection_fd, "Error: cannot start a job\n" + s_exit_marker + "1\n");
+    close(connection_fd);
+  } else if (0 == pid) {
+    runJob(connection_fd);
+  } else {
+    m_job_dict[pid] = connection_fd;
+  }
+}
+
+void PhaseServer::runJob(int connection_fd) {
+  // Release the resources of the server which are not used by the job.
+  close(m_listen_fd);
+  close(s_child_pipe[0]);
+  close(s_child_pipe[1]);
+  signal(SIGCHLD, SIG_DFL);
+  signal(SIGPIPE, SIG_DFL);
+
+  // Read parameters up to an empty line.
+  std::string request;
+  char buffer[4096];
+  while (std::string::npos == request.find("\n\n")) {
+    ssize_t num_read = read(connection_fd, buffer, sizeof(buffer));
+    if (num_read < 0 && EINTR == errno) continue;
+    if (num_read <= 0) break;
+    request.append(buffer, num_read);
+  }
+  ParCont par_cont(m_default_par_cont);
+  std::istringstream iss(request);
+  for (std::string line; std::getline(iss, line) && !line.empty(); ) {
+    std::string::size_type equal_pos = line.find('=');
+    if (std::string::npos != equal_pos) par_cont.push_back(std::make_pair(line.substr(0, equal_pos), line.substr(equal_pos + 1)));
+  }
+
+  // Write the parameter file into a private directory, reading it from the directories of the user and the system.
+  const char * tmp_dir = std::getenv("TMPDIR");
+  std::string dir_template = std::string(tmp_dir ? tmp_dir : "/tmp") + "/pulsePhase_job_XXXXXX";
+  std::vector<char> job_dir(dir_template.begin(), dir_template.end());
+  job_dir.push_back('\0');
+  bool has_job_dir = (0 != mkdtemp(&job_dir[0]));
+  if (has_job_dir) {
+    const char * pfiles = std::getenv("PFILES");
+    std::string read_only_path(pfiles ? pfiles : "");
+    std::replace(read_only_path.begin(), read_only_path.end(), ';', ':');
+    setenv("PFILES", (std::string(&job_dir[0]) + ";" + read_only_path).c_str(), 1);
+  }
+
+  // Send messages of the job to the client.
+  dup2(connection_fd, STDOUT_FILENO);
+  dup2(connection_fd, STDERR_FILENO);
+  close(connection_fd);
+
+  // Run the job.
+  int exit_status = 0;
+  try {
+    PulsePhaseApp app;
+    st_app::AppParGroup & pars(app.getParGroup());
+    pars.suppressPrompts();
+    for (ParCont::const_iterator itor = par_cont.begin(); itor != par_cont.end(); ++itor) pars[itor->first] = itor->second;
+    app.run();
+  } catch (const std::exception & x) {
+    std::cerr << "gtpphase: " << x.what() << std::endl;
+    exit_status = 1;
+  } catch (...) {
+    std::cerr << "gtpphase: unknown error" << std::endl;
+    exit_status = 1;
+  }
+  std::cout.flush();
+  std::cerr.flush();
+
+  // Clean up the private directory.
+  if (has_job_dir) {
+    std::remove((std::string(&job_dir[0]) + "/gtpphase.par").c_str());
+    rmdir(&job_dir[0]);
+  }
+  _exit(exit_status);
+}
+
+void PhaseServer::finishJob() {
+  int status = 0;
+  for (pid_t pid = waitpid(-1, &status, WNOHANG); pid > 0; pid = waitpid(-1, &status, WNOHANG)) {
+    JobDict::iterator itor = m_job_dict.find(pid);
+    if (m_job_dict.end() == itor) continue;
+    int exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    std::ostringstream os;
+    os << s_exit_marker << exit_status << "\n";
+    writeAll(itor->second, os.str());
+    close(itor->second);
+    m_job_dict.erase(itor);
+  }
+}
@@ -0,0 +1,89 @@
+/** \file PhaseServer.h
+    \brief Declaration of PhaseServer class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PhaseServer_h
+#define pulsePhase_PhaseServer_h
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+/** \class PhaseServer
+    \brief Server of pulse phase assignment jobs over a Unix domain socket, which keeps the leap second table and the
+           solar system ephemeris loaded in memory, and runs each job by PulsePhaseApp in a child process forked from
+           the server. Child processes share the resources loaded by the server, so that a job starts without loading
+           them again, and as many jobs as allowed run at the same time without sharing any state with each other.
+
+           A job is requested by writing parameters of gtpphase to the socket, one "name=value" pair per line, followed
+           by an empty line. All messages written by gtpphase to the standard output and the standard error are sent
+           back through the socket, followed by a line of the exit status of the job, which is the character EOT
+           (0x04) followed by "EXIT" and the exit status separated by a space. Each job writes its parameter file into
+           a private directory, so that jobs do not overwrite parameter files of each other or of the user. The socket
+           is accessible only by the owner of the server.
+*/
+class PhaseServer {
+  public:
+    typedef std::vector<std::pair<std::string, std::string> > ParCont;
+
+    /** \brief Construct a PhaseServer object.
+        \param socket_name Name of the Unix domain socket to listen to.
+        \param max_job Maximum number of jobs to run at the same time.
+    */
+    PhaseServer(const std::string & socket_name, long max_job);
+
+    /// \brief Destruct this PhaseServer object, removing the socket.
+    ~PhaseServer();
+
+    /** \brief Load the leap second table and the solar system ephemeris, which are kept in memory while this server
+               runs. Parameter values given to this method are also used as default values for all jobs.
+        \param leap_sec_file Name of the leap second file, or DEFAULT for the default leap second file.
+        \param solar_eph Name of the solar system ephemeris.
+        \param psrdb_cache Name of the directory to keep snapshots of pulsar ephemerides databases in, or NONE.
+    */
+    void loadResource(const std::string & leap_sec_file, const std::string & solar_eph, const std::string & psrdb_cache);
+
+    /// \brief Accept and run jobs until this process is terminated.
+    void run();
+
+    /** \brief Request a job to a server, and write the messages from the job to the given stream.
+        \param socket_name Name of the Unix domain socket that the server listens to.
+        \param par_cont Parameter names and values of the job.
+        \param os Output stream to write the messages from the job to.
+        \return Exit status of the job.
+    */
+    static int submitJob(const std::string & socket_name, const ParCont & par_cont, std::ostream & os);
+
+  private:
+    typedef std::map<pid_t, int> JobDict;
+
+    std::string m_socket_name;
+    long m_max_job;
+    int m_listen_fd;
+    ParCont m_default_par_cont;
+    JobDict m_job_dict;
+
+    /** \brief Start a job for a connection in a child process.
+        \param connection_fd File descriptor of the connection.
+    */
+    void startJob(int connection_fd);
+
+    /** \brief Run a job in this process, which is a child process of the server. This method does not return.
+        \param connection_fd File descriptor of the connection.
+    */
+    void runJob(int connection_fd);
+
+    /// \brief Collect jobs that have finished, and send their exit status to the clients.
+    void finishJob();
+
+    // Prohibit copying.
+    PhaseServer(const PhaseServer &);
+    PhaseServer & operator =(const PhaseServer &);
+};
+
+#endif
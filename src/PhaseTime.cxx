@@ -0,0 +1,19 @@
+/** \file PhaseTime.cxx
+    \brief Implementation of PhaseTime class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "PhaseTime.h"
+
+#include "timeSystem/AbsoluteTime.h"
+#include "timeSystem/MjdFormat.h"
+
+PhaseTime PhaseTime::create(const timeSystem::AbsoluteTime & abs_time) {
+  timeSystem::Mjd mjd(0, 0.);
+  abs_time.get("TDB", mjd);
+  return PhaseTime(mjd.m_int, mjd.m_frac * s_sec_per_day);
+}
+
+timeSystem::AbsoluteTime PhaseTime::getAbsoluteTime() const {
+  return timeSystem::AbsoluteTime("TDB", m_day, m_sec);
+}
@@ -0,0 +1,64 @@
+/** \file PhaseTime.h
+    \brief Declaration of PhaseTime class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PhaseTime_h
+#define pulsePhase_PhaseTime_h
+
+#include <cmath>
+
+namespace timeSystem {
+  class AbsoluteTime;
+}
+
+/** \class PhaseTime
+    \brief Plain representation of a time in TDB, as an integer MJD and seconds of the day, which is used in place of
+           AbsoluteTime in per-event computations. It involves no time system lookup and no memory allocation, and is
+           converted to and from AbsoluteTime only where a time is passed to or taken from the time system library.
+*/
+struct PhaseTime {
+  /// \brief Number of seconds in a day.
+  static const long s_sec_per_day = 86400;
+
+  /// \brief Construct a PhaseTime object at MJD 0.
+  PhaseTime(): m_day(0), m_sec(0.) {}
+
+  /** \brief Construct a PhaseTime object.
+      \param day Integer part of MJD in TDB.
+      \param sec Seconds since the start of the day, which may be out of the range of a day.
+  */
+  PhaseTime(long day, double sec): m_day(day), m_sec(sec) { normalize(); }
+
+  /** \brief Create a PhaseTime object from an AbsoluteTime object.
+      \param abs_time Time to represent.
+  */
+  static PhaseTime create(const timeSystem::AbsoluteTime & abs_time);
+
+  /// \brief Return an AbsoluteTime object which represents this time.
+  timeSystem::AbsoluteTime getAbsoluteTime() const;
+
+  /** \brief Add seconds to this time.
+      \param sec Number of seconds to add.
+  */
+  PhaseTime & operator +=(double sec) { m_sec += sec; normalize(); return *this; }
+
+  /** \brief Compute the number of seconds elapsed since the given time.
+      \param since Time to compute the elapsed seconds from.
+  */
+  double operator -(const PhaseTime & since) const { return (m_day - since.m_day) * double(s_sec_per_day) + (m_sec - since.m_sec); }
+
+  /// \brief Bring seconds of the day into the range of a day, carrying the excess over to the integer MJD.
+  void normalize() {
+    if (m_sec < 0. || m_sec >= s_sec_per_day) {
+      double carry = std::floor(m_sec / s_sec_per_day);
+      m_day += static_cast<long>(carry);
+      m_sec -= carry * s_sec_per_day;
+    }
+  }
+
+  long m_day;
+  double m_sec;
+};
+
+#endif
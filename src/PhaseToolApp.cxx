@@ -0,0 +1,1905 @@
+/** \file PhaseToolApp.cxx
+    \brief Implementation of PhaseToolApp class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "PhaseToolApp.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "BaryDelayCache.h"
+#include "BinaryDemodulator.h"
+#include "CachedEphChooser.h"
+#include "DelayTable.h"
+#include "EphemerisSearch.h"
+#include "EventColumnIo.h"
+#include "PerformanceMonitor.h"
+#include "PeriodicityTest.h"
+#include "PhaseProfile.h"
+#include "PhaseTime.h"
+#include "PhaseUtil.h"
+#include "PulsarDbCache.h"
+#include "ScDataWindow.h"
+#include "SpinPhaseTable.h"
+#include "WorkerPool.h"
+
+#include "pulsarDb/EphChooser.h"
+#include "pulsarDb/EphComputer.h"
+#include "pulsarDb/OrbitalEph.h"
+#include "pulsarDb/PulsarDb.h"
+#include "pulsarDb/PulsarEph.h"
+
+#include "st_app/AppParGroup.h"
+
+#include "st_facilities/Env.h"
+#include "st_facilities/FileSys.h"
+
+#include "st_stream/Stream.h"
+
+#include "timeSystem/AbsoluteTime.h"
+#include "timeSystem/Duration.h"
+#include "timeSystem/ElapsedTime.h"
+#include "timeSystem/MjdFormat.h"
+
+#include "tip/Header.h"
+#include "tip/IFileSvc.h"
+#include "tip/TipException.h"
+
+namespace {
+
+  typedef std::vector<PhaseTime> TimeCont;
+
+  /// \brief Names of the columns of the sky position of events, for selection of a region of interest.
+  const std::string s_ra_field("RA");
+  const std::string s_dec_field("DEC");
+
+  /// \brief Number of rows in a window of the spacecraft file read for fingerprints of spacecraft data.
+  const long s_sc_data_window_size = 4096;
+
+  /** \brief Compute phases for a range of event times by the given EphComputer object.
+      \param computer EphComputer to compute phases with.
+      \param phase_type Type of phase to compute.
+      \param phase_offset Global phase offset to add to all phases.
+      \param time_begin Iterator pointing to the first event time.
+      \param time_end Iterator pointing to one past the last event time.
+      \param phase_begin Pointer to the first element of the array to store the phases in.
+  */
+  void computePhase(const pulsarDb::EphComputer & computer, PhaseToolApp::PhaseType_e phase_type, double phase_offset,
+    TimeCont::const_iterator time_begin, TimeCont::const_iterator time_end, double * phase_begin) {
+    if (PhaseToolApp::PULSE_PHASE == phase_type) {
+      for (; time_begin != time_end; ++time_begin, ++phase_begin) {
+        *phase_begin = computer.calcPulsePhase(time_begin->getAbsoluteTime(), phase_offset);
+      }
+    } else {
+      for (; time_begin != time_end; ++time_begin, ++phase_begin) {
+        *phase_begin = computer.calcOrbitalPhase(time_begin->getAbsoluteTime(), phase_offset);
+      }
+    }
+  }
+
+  /** \brief Create a copy of the given EphComputer object, loaded with the same spin and orbital ephemerides.
+      \param computer EphComputer to copy.
+      \param chooser Ephemeris chooser to be used by the copy.
+  */
+  std::unique_ptr<pulsarDb::EphComputer> copyEphComputer(const pulsarDb::EphComputer & computer,
+    const pulsarDb::EphChooser & chooser) {
+    std::unique_ptr<pulsarDb::EphComputer> computer_copy(new pulsarDb::EphComputer(chooser));
+    const pulsarDb::PulsarEphCont & pulsar_eph_cont(computer.getPulsarEphCont());
+    for (pulsarDb::PulsarEphCont::const_iterator itor = pulsar_eph_cont.begin(); itor != pulsar_eph_cont.end();
+      ++itor) {
+      computer_copy->loadPulsarEph(**itor);
+    }
+    const pulsarDb::OrbitalEphCont & orbital_eph_cont(computer.getOrbitalEphCont());
+    for (pulsarDb::OrbitalEphCont::const_iterator itor = orbital_eph_cont.begin(); itor != orbital_eph_cont.end();
+      ++itor) {
+      computer_copy->loadOrbitalEph(**itor);
+    }
+    return computer_copy;
+  }
+
+  /** \class LibraryUnlock
+      \brief Helper class to release a lock on the library mutex for the lifetime of an object, and acquire it again
+             even if an exception is thrown in the meantime.
+  */
+  class LibraryUnlock {
+    public:
+      explicit LibraryUnlock(std::unique_lock<std::mutex> & lock): m_lock(lock) { m_lock.unlock(); }
+      ~LibraryUnlock() { m_lock.lock(); }
+
+    private:
+      std::unique_lock<std::mutex> & m_lock;
+
+      // Prohibit copying.
+      LibraryUnlock(const LibraryUnlock &);
+      LibraryUnlock & operator =(const LibraryUnlock &);
+  };
+
+  /** \class BlockPhaseComputer
+      \brief Helper class to compute phases for a block of event times. Pulse phases are evaluated from a SpinPhaseTable
+             object wherever it has a polynomial for an event time, unless phases are requested to be computed exactly.
+             Polynomials are evaluated in parallel by a given number of threads: the block is divided into ranges of
+             events, one per thread, and the ranges but the first are sent to a pool of worker threads started once for
+             the run. The other phases are computed by the EphComputer object in the calling thread, one event at a
+             time, because computations in the pulsarDb and timeSystem libraries are not reentrant.
+  */
+  class BlockPhaseComputer {
+    public:
+      /** \brief Construct a BlockPhaseComputer object.
+          \param computer EphComputer to compute phases with.
+          \param chooser Ephemeris chooser used by the EphComputer object.
+          \param num_thread Number of threads to evaluate polynomials with, including the calling thread.
+          \param worker_pool Pool of worker threads to evaluate polynomials in, besides the calling thread.
+          \param phase_type Type of phase to compute.
+          \param phase_offset Global phase offset to add to all phases.
+          \param exact Whether to compute all phases by the EphComputer object, without a table of polynomials.
+          \param monitor Performance monitor to count events in.
+      */
+      BlockPhaseComputer(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser, long num_thread,
+        WorkerPool & worker_pool, PhaseToolApp::PhaseType_e phase_type, double phase_offset, bool exact,
+        PerformanceMonitor & monitor);
+
+      /** \brief Compute phases for a block of event times.
+          \param time_block Event times to compute phases for.
+          \param phase_begin Pointer to the first element of the array to store the phases in.
+          \param lock Lock on the library mutex held by the calling thread, which is released while polynomials are
+                 evaluated, or null if there is no such lock.
+      */
+      void compute(const TimeCont & time_block, double * phase_begin, std::unique_lock<std::mutex> * lock);
+
+    private:
+      const pulsarDb::EphComputer & m_computer;
+      long m_num_thread;
+      WorkerPool & m_worker_pool;
+      PhaseToolApp::PhaseType_e m_phase_type;
+      double m_phase_offset;
+      PerformanceMonitor & m_monitor;
+      std::unique_ptr<SpinPhaseTable> m_phase_table;
+      std::vector<long> m_poly_block;
+      std::vector<double> m_elapsed_block;
+      WorkerPool::TaskCont m_task_cont;
+  };
+
+  BlockPhaseComputer::BlockPhaseComputer(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser,
+    long num_thread, WorkerPool & worker_pool, PhaseToolApp::PhaseType_e phase_type, double phase_offset, bool exact,
+    PerformanceMonitor & monitor): m_computer(computer), m_num_thread(num_thread), m_worker_pool(worker_pool),
+    m_phase_type(phase_type), m_phase_offset(phase_offset), m_monitor(monitor), m_phase_table(nullptr), m_poly_block(),
+    m_elapsed_block(), m_task_cont() {
+    // Create a table of polynomials for pulse phases, unless they are to be computed exactly.
+    if (PhaseToolApp::PULSE_PHASE == m_phase_type && !exact) {
+      m_phase_table.reset(new SpinPhaseTable(m_computer, chooser, m_phase_offset));
+    }
+  }
+
+  void BlockPhaseComputer::compute(const TimeCont & time_block, double * phase_begin,
+    std::unique_lock<std::mutex> * lock) {
+    if (time_block.empty()) return;
+
+    // Compute all phases by the EphComputer if there is no table of polynomials.
+    if (!m_phase_table.get()) {
+      computePhase(m_computer, m_phase_type, m_phase_offset, time_block.begin(), time_block.end(), phase_begin);
+      return;
+    }
+
+    // Find polynomials for event times, building the table of polynomials as needed.
+    m_poly_block.resize(time_block.size());
+    m_elapsed_block.resize(time_block.size());
+    for (TimeCont::size_type event_index = 0; event_index < time_block.size(); ++event_index) {
+      m_poly_block[event_index] = m_phase_table->findPolynomial(time_block[event_index], m_elapsed_block[event_index]);
+    }
+
+    // Count events by the segment of ephemeris validity, and by the way their pulse phases are computed.
+    if (m_monitor.isEnabled()) {
+      std::map<long, long> segment_count;
+      long num_exact = 0;
+      for (TimeCont::size_type event_index = 0; event_index < time_block.size(); ++event_index) {
+        ++segment_count[m_phase_table->findSegment(time_block[event_index])];
+        if (m_poly_block[event_index] < 0) ++num_exact;
+      }
+      for (std::map<long, long>::const_iterator itor = segment_count.begin(); itor != segment_count.end(); ++itor) {
+        std::ostringstream os;
+        os << "events in ephemeris segment " << itor->first;
+        m_monitor.addCount(os.str(), itor->second);
+      }
+      m_monitor.addCount("events with polynomial pulse phases", time_block.size() - num_exact);
+      m_monitor.addCount("events with exact pulse phases", num_exact);
+    }
+
+    // Evaluate polynomials, dividing the block into contiguous ranges of events, one range per thread. The first range
+    // is evaluated in the calling thread, and the others by the worker pool. No calls are made to the libraries in
+    // this step, so that the library mutex is released meanwhile.
+    {
+      std::unique_ptr<LibraryUnlock> unlock(lock ? new LibraryUnlock(*lock) : 0);
+      TimeCont::size_type num_event = time_block.size();
+      TimeCont::size_type range_size = (num_event + m_num_thread - 1) / m_num_thread;
+      const double * coeff_cont = m_phase_table->getCoefficient();
+      const long * poly_begin = &m_poly_block[0];
+      const double * elapsed_begin = &m_elapsed_block[0];
+      m_task_cont.clear();
+      for (TimeCont::size_type range_index = 0; range_index < static_cast<TimeCont::size_type>(m_num_thread);
+        ++range_index) {
+        TimeCont::size_type range_begin = std::min(range_size * range_index, num_event);
+        TimeCont::size_type range_end = std::min(range_begin + range_size, num_event);
+        if (0 < range_index && range_begin == range_end) break;
+        m_task_cont.push_back([=]() {
+          SpinPhaseTable::evaluate(coeff_cont, poly_begin + range_begin, poly_begin + range_end,
+            elapsed_begin + range_begin, phase_begin + range_begin);
+        });
+      }
+      m_worker_pool.run(m_task_cont);
+    }
+
+    // Compute pulse phases of events without a polynomial by the EphComputer.
+    for (TimeCont::size_type event_index = 0; event_index < time_block.size(); ++event_index) {
+      if (m_poly_block[event_index] < 0) {
+        phase_begin[event_index] = m_computer.calcPulsePhase(time_block[event_index].getAbsoluteTime(),
+          m_phase_offset);
+      }
+    }
+  }
+
+  /** \brief Find the source position shared by all the given spin ephemerides throughout their validity windows.
+             Return true if such a position is found, or false otherwise.
+      \param eph_cont Spin ephemerides to examine.
+      \param ang_tol Angular tolerance in degrees, within which two source positions are considered the same.
+      \param position Source position found, as a pair of right ascension and declination in degrees.
+  */
+  bool findFixedPosition(const pulsarDb::PulsarEphCont & eph_cont, double ang_tol,
+    std::pair<double, double> & position) {
+    if (eph_cont.empty()) return false;
+    std::pair<double, double> first_position(eph_cont.front()->calcSkyPosition(eph_cont.front()->getValidSince()));
+    for (pulsarDb::PulsarEphCont::const_iterator itor = eph_cont.begin(); itor != eph_cont.end(); ++itor) {
+      std::pair<double, double> since_position((*itor)->calcSkyPosition((*itor)->getValidSince()));
+      std::pair<double, double> until_position((*itor)->calcSkyPosition((*itor)->getValidUntil()));
+      if (BaryDelayCache::computeSeparation(first_position.first, first_position.second, since_position.first,
+        since_position.second) > ang_tol) return false;
+      if (BaryDelayCache::computeSeparation(first_position.first, first_position.second, until_position.first,
+        until_position.second) > ang_tol) return false;
+    }
+    position = first_position;
+    return true;
+  }
+
+  /** \brief Return the center of the region of interest around a pulsar, which is the given source position if it
+             does not vary, or the position given by the first spin ephemeris at its epoch otherwise.
+      \param computer EphComputer whose spin ephemerides give the source position.
+      \param vary_ra_dec Flag to take the position from spin ephemerides.
+      \param src_position Source position, as a pair of right ascension and declination in degrees.
+  */
+  std::pair<double, double> computeRegionCenter(const pulsarDb::EphComputer & computer, bool vary_ra_dec,
+    const std::pair<double, double> & src_position) {
+    if (!vary_ra_dec) return src_position;
+    const pulsarDb::PulsarEphCont & eph_cont(computer.getPulsarEphCont());
+    if (eph_cont.empty()) {
+      throw std::runtime_error("No spin ephemeris to take the center of the region of interest from");
+    }
+    return eph_cont.front()->calcSkyPosition(eph_cont.front()->getEpoch());
+  }
+
+  /** \brief Select events whose sky positions are within the given angular radius of the given position. The haversine
+             of the angular distance of each event is computed in a loop with no branches, which the compiler can
+             vectorize, and indices of events within the radius are collected afterwards. Events whose positions are
+             not finite are not selected.
+      \param ra_begin Pointer to the right ascension of the first event in degrees.
+      \param dec_begin Pointer to the declination of the first event in degrees.
+      \param num_event Number of events.
+      \param center Center of the region, as a pair of right ascension and declination in degrees.
+      \param radius Radius of the region in degrees.
+      \param hav_block Buffer of at least num_event elements to store the haversines in.
+      \param select_block Indices of the selected events, set by this function.
+  */
+  void selectRegion(const double * ra_begin, const double * dec_begin, long num_event,
+    const std::pair<double, double> & center, double radius, std::vector<double> & hav_block,
+    std::vector<long> & select_block) {
+    const double deg_to_rad = pulsePhaseUtil::s_deg_to_rad;
+    double center_ra = center.first * deg_to_rad;
+    double center_dec = center.second * deg_to_rad;
+    double cos_center_dec = std::cos(center_dec);
+    double sin_half_radius = std::sin(.5 * radius * deg_to_rad);
+    double max_hav = (radius < 180. ? sin_half_radius * sin_half_radius : 2.);
+    double * hav = &hav_block[0];
+    for (long event_index = 0; event_index < num_event; ++event_index) {
+      double dec = dec_begin[event_index] * deg_to_rad;
+      double sin_half_ddec = std::sin(.5 * (dec - center_dec));
+      double sin_half_dra = std::sin(.5 * (ra_begin[event_index] * deg_to_rad - center_ra));
+      hav[event_index] = sin_half_ddec * sin_half_ddec + cos_center_dec * std::cos(dec) * sin_half_dra * sin_half_dra;
+    }
+    select_block.clear();
+    for (long event_index = 0; event_index < num_event; ++event_index) {
+      if (hav[event_index] <= max_hav) select_block.push_back(event_index);
+    }
+  }
+
+  /** \brief Return an upper-case copy of the given string.
+      \param str String to convert.
+  */
+  std::string toUpper(const std::string & str) {
+    std::string str_uc(str);
+    for (std::string::iterator itor = str_uc.begin(); itor != str_uc.end(); ++itor) *itor = std::toupper(*itor);
+    return str_uc;
+  }
+
+  /** \brief Read the time system and the reference MJD of event times from the given header.
+      \param header Header of the event table.
+      \param time_system_name Name of the time system of event times.
+      \param mjd_ref Reference MJD of event times.
+  */
+  void readTimeOrigin(const tip::Header & header, std::string & time_system_name, timeSystem::Mjd & mjd_ref) {
+    header["TIMESYS"].get(time_system_name);
+    time_system_name = toUpper(time_system_name);
+
+    // Read MJDREFI and MJDREFF keywords, or MJDREF keyword if they are not present.
+    try {
+      long mjd_ref_int = 0;
+      double mjd_ref_frac = 0.;
+      header["MJDREFI"].get(mjd_ref_int);
+      header["MJDREFF"].get(mjd_ref_frac);
+      mjd_ref = timeSystem::Mjd(mjd_ref_int, mjd_ref_frac);
+    } catch (const tip::TipException &) {
+      double mjd_ref_dbl = 0.;
+      header["MJDREF"].get(mjd_ref_dbl);
+      double mjd_ref_int = std::floor(mjd_ref_dbl);
+      mjd_ref = timeSystem::Mjd(static_cast<long>(mjd_ref_int), mjd_ref_dbl - mjd_ref_int);
+    }
+  }
+
+  /** \brief Return the prefix of the names of the keywords that record the fingerprint of phase computation, which
+             is "P" for pulse phases and "O" for orbital phases, so that gtpphase and gtophase keep separate records.
+      \param phase_spec_cont Types of phases to compute, the first of which determines the prefix.
+  */
+  std::string getFingerprintPrefix(const PhaseToolApp::PhaseSpecCont & phase_spec_cont) {
+    return PhaseToolApp::ORBITAL_PHASE == phase_spec_cont.front().m_phase_type ? "O" : "P";
+  }
+
+  /// \brief Function which returns the spacecraft data to fingerprint, opening the spacecraft file on the first call.
+  typedef std::function<ScDataWindow & ()> ScDataFunction;
+
+  /** \brief Range of mission elapsed times of events whose arrival times are corrected with spacecraft positions,
+             which is empty if there are no such events.
+  */
+  struct ScDataRange {
+    ScDataRange(): m_start(std::numeric_limits<double>::infinity()), m_stop(-std::numeric_limits<double>::infinity()) {}
+
+    bool isEmpty() const {
+      return !(m_start <= m_stop);
+    }
+
+    void include(double elapsed_time) {
+      m_start = std::min(m_start, elapsed_time);
+      m_stop = std::max(m_stop, elapsed_time);
+    }
+
+    void include(const ScDataRange & range) {
+      if (!range.isEmpty()) {
+        include(range.m_start);
+        include(range.m_stop);
+      }
+    }
+
+    double m_start;
+    double m_stop;
+  };
+
+  /** \brief Return true if the spacecraft data used for the range of times recorded by writeScDataRange function are
+             the same as those in the current spacecraft file, setting the recorded range to the given range, or
+             return false otherwise. The given range is set empty if no spacecraft data were used.
+      \param header Header of the event table.
+      \param prefix Prefix of the keyword names.
+      \param sc_data Function which returns the current spacecraft data.
+      \param range Range of times, set by this function.
+  */
+  bool readScDataRange(const tip::Header & header, const std::string & prefix, const ScDataFunction & sc_data,
+    ScDataRange & range) {
+    range = ScDataRange();
+    std::string recorded_fingerprint;
+    double start_time = 0.;
+    double stop_time = 0.;
+    try {
+      header[prefix + "SCFP"].get(recorded_fingerprint);
+      header[prefix + "SCTMIN"].get(start_time);
+      header[prefix + "SCTMAX"].get(stop_time);
+    } catch (const tip::TipException &) {
+      // The spacecraft data are assumed to be changed if the keywords are not present.
+      return false;
+    }
+    if ("NONE" == recorded_fingerprint) return true;
+    try {
+      if (recorded_fingerprint != sc_data().computeFingerprint(start_time, stop_time)) return false;
+    } catch (const std::exception &) {
+      // The spacecraft data are assumed to be changed if they cannot be read.
+      return false;
+    }
+    range.include(start_time);
+    range.include(stop_time);
+    return true;
+  }
+
+  /** \brief Record the given range of times of events whose arrival times are corrected with spacecraft positions, and
+             a fingerprint of the spacecraft data used for them, in keywords. The fingerprint covers only the rows
+             of the spacecraft file around the times, so that it does not change when the spacecraft file grows.
+      \param header Header of the event table.
+      \param prefix Prefix of the keyword names.
+      \param sc_data Function which returns the current spacecraft data.
+      \param range Range of times.
+  */
+  void writeScDataRange(tip::Header & header, const std::string & prefix, const ScDataFunction & sc_data,
+    const ScDataRange & range) {
+    std::string fingerprint("NONE");
+    double start_time = 0.;
+    double stop_time = 0.;
+    if (!range.isEmpty()) {
+      fingerprint = sc_data().computeFingerprint(range.m_start, range.m_stop);
+      start_time = range.m_start;
+      stop_time = range.m_stop;
+    }
+    header[prefix + "SCFP"].set(fingerprint);
+    header[prefix + "SCTMIN"].set(start_time);
+    header[prefix + "SCTMAX"].set(stop_time);
+  }
+
+  /** \brief Return the number of leading records of the given event table whose phases were computed with the given
+             fingerprint and with the current spacecraft data, as recorded by writeFingerprint function, or 0 if the
+             fingerprint is empty, or if it or the spacecraft data differ from the recorded ones.
+      \param column_io Event table(s).
+      \param table_index Index of the event table.
+      \param prefix Prefix of the keyword names.
+      \param fingerprint Fingerprint of the current phase computation.
+      \param sc_data Function which returns the current spacecraft data.
+      \param range Range of times of the records whose arrival times were corrected with spacecraft positions, set by
+             this function. It is set empty if 0 is returned.
+  */
+  tip::Index_t readNumPhasedRecord(const EventColumnIo & column_io, EventColumnIo::TableCont::size_type table_index,
+    const std::string & prefix, const std::string & fingerprint, const ScDataFunction & sc_data, ScDataRange & range) {
+    range = ScDataRange();
+    if (fingerprint.empty()) return 0;
+    const tip::Header & header(column_io.getHeader(table_index));
+    std::string recorded_fingerprint;
+    long num_phased = 0;
+    try {
+      header[prefix + "PHASEFP"].get(recorded_fingerprint);
+      header[prefix + "PHASENR"].get(num_phased);
+    } catch (const tip::TipException &) {
+      // Phases of all records are computed if the keywords are not present.
+      return 0;
+    }
+    if (recorded_fingerprint != fingerprint || num_phased < 0) return 0;
+    if (!readScDataRange(header, prefix, sc_data, range)) {
+      range = ScDataRange();
+      return 0;
+    }
+    return std::min<tip::Index_t>(num_phased, column_io.getNumRecords(table_index));
+  }
+
+  /** \brief Record the fingerprint of phase computation and the number of records of the given event table in keywords,
+             after phases of all the records are computed, along with the spacecraft data used for them. Nothing is
+             recorded if the fingerprint is empty.
+      \param column_io Event table(s).
+      \param table_index Index of the event table.
+      \param prefix Prefix of the keyword names.
+      \param fingerprint Fingerprint of the current phase computation.
+      \param sc_data Function which returns the current spacecraft data.
+      \param range Range of times of the records whose arrival times are corrected with spacecraft positions.
+  */
+  void writeFingerprint(EventColumnIo & column_io, EventColumnIo::TableCont::size_type table_index,
+    const std::string & prefix, const std::string & fingerprint, const ScDataFunction & sc_data,
+    const ScDataRange & range) {
+    if (fingerprint.empty()) return;
+    tip::Header & header(column_io.getHeader(table_index));
+    header[prefix + "PHASEFP"].set(fingerprint);
+    header[prefix + "PHASENR"].set(long(column_io.getNumRecords(table_index)));
+    writeScDataRange(header, prefix, sc_data, range);
+  }
+
+  /** \brief Return true if the cache column of the given event table holds arrival times of all events computed with
+             the given fingerprint of arrival time corrections and with the current spacecraft data, as recorded by
+             writeCacheStatus function, or false otherwise, or if the fingerprint is empty.
+      \param column_io Event table(s).
+      \param table_index Index of the event table.
+      \param fingerprint Fingerprint of the current arrival time corrections.
+      \param sc_data Function which returns the current spacecraft data.
+      \param range Range of times of the events whose arrival times were corrected with spacecraft positions, set by
+             this function. It is set empty if false is returned.
+  */
+  bool readCacheStatus(const EventColumnIo & column_io, EventColumnIo::TableCont::size_type table_index,
+    const std::string & fingerprint, const ScDataFunction & sc_data, ScDataRange & range) {
+    range = ScDataRange();
+    if (fingerprint.empty()) return false;
+    const tip::Header & header(column_io.getHeader(table_index));
+    std::string recorded_fingerprint;
+    long num_cached = 0;
+    try {
+      header["BARYCFP"].get(recorded_fingerprint);
+      header["BARYCNR"].get(num_cached);
+    } catch (const tip::TipException &) {
+      // Arrival times are computed if the keywords are not present.
+      return false;
+    }
+    if (recorded_fingerprint != fingerprint || num_cached != column_io.getNumRecords(table_index)) return false;
+    if (!readScDataRange(header, "C", sc_data, range)) {
+      range = ScDataRange();
+      return false;
+    }
+    return true;
+  }
+
+  /** \brief Record the fingerprint of arrival time corrections and the number of records of the given event table in
+             keywords, after arrival times of all the records are written into the cache column, along with the
+             spacecraft data used for them.
+      \param column_io Event table(s).
+      \param table_index Index of the event table.
+      \param fingerprint Fingerprint of the current arrival time corrections.
+      \param sc_data Function which returns the current spacecraft data.
+      \param range Range of times of the events whose arrival times are corrected with spacecraft positions.
+  */
+  void writeCacheStatus(EventColumnIo & column_io, EventColumnIo::TableCont::size_type table_index,
+    const std::string & fingerprint, const ScDataFunction & sc_data, const ScDataRange & range) {
+    tip::Header & header(column_io.getHeader(table_index));
+    header["BARYCFP"].set(fingerprint);
+    header["BARYCNR"].set(long(column_io.getNumRecords(table_index)));
+    writeScDataRange(header, "C", sc_data, range);
+  }
+
+  /** \brief Write the name, the size and the modification time of each of the given file(s) to the given stream, so
+             that an update of a file is detected without reading its contents.
+      \param file_name Name of the file, or the name of a list file preceded by "@".
+      \param file_kind Kind of the file, to be shown in an error message.
+      \param os Stream to write to.
+  */
+  void writeFileIdentity(const std::string & file_name, const std::string & file_kind, std::ostream & os) {
+    EventColumnIo::FileNameCont file_name_cont(st_facilities::FileSys::expandFileList(file_name));
+    for (EventColumnIo::FileNameCont::const_iterator itor = file_name_cont.begin(); itor != file_name_cont.end();
+      ++itor) {
+      struct stat file_status;
+      if (0 != stat(itor->c_str(), &file_status)) {
+        throw std::runtime_error("Cannot find " + file_kind + " \"" + *itor + "\"");
+      }
+      os << *itor << ' ' << file_status.st_size << ' ' << file_status.st_mtime << '\n';
+    }
+  }
+
+  /** \brief Compute the permutation of event indices that sorts the given event times in ascending order, by a
+             least-significant-digit radix sort on the bit patterns of the times, 16 bits at a time. The sort is
+             stable, so that events at the same time are kept in the order of records. Passes over digits shared by
+             all the event times are skipped, which is the case for the most significant digits of a table of times.
+      \param time_cont Event times to sort.
+      \param order_cont Indices of the event times in ascending order of the times.
+  */
+  void sortTime(const std::vector<double> & time_cont, std::vector<long> & order_cont) {
+    // Convert event times into unsigned integers in the same order as the times.
+    const std::uint64_t sign_bit = std::uint64_t(1) << 63;
+    std::vector<std::uint64_t> key_cont(time_cont.size());
+    for (std::vector<double>::size_type event_index = 0; event_index < time_cont.size(); ++event_index) {
+      std::uint64_t bits = 0;
+      std::memcpy(&bits, &time_cont[event_index], sizeof(bits));
+      key_cont[event_index] = (bits & sign_bit) ? ~bits : (bits | sign_bit);
+    }
+    order_cont.resize(time_cont.size());
+    for (std::vector<long>::size_type event_index = 0; event_index < order_cont.size(); ++event_index) {
+      order_cont[event_index] = event_index;
+    }
+
+    // Sort keys and indices together, 16 bits at a time from the least significant digit.
+    const int num_bit = 16;
+    const std::uint64_t digit_mask = (std::uint64_t(1) << num_bit) - 1;
+    std::vector<std::uint64_t> work_key_cont(key_cont.size());
+    std::vector<long> work_order_cont(order_cont.size());
+    std::vector<std::vector<double>::size_type> count_cont(digit_mask + 1);
+    for (int shift = 0; shift < 64; shift += num_bit) {
+      std::fill(count_cont.begin(), count_cont.end(), 0);
+      for (std::vector<std::uint64_t>::const_iterator itor = key_cont.begin(); itor != key_cont.end(); ++itor) {
+        ++count_cont[(*itor >> shift) & digit_mask];
+      }
+      if (count_cont[(key_cont.front() >> shift) & digit_mask] == key_cont.size()) continue;
+      std::vector<double>::size_type offset = 0;
+      for (std::vector<std::vector<double>::size_type>::iterator itor = count_cont.begin(); itor != count_cont.end();
+        ++itor) {
+        std::vector<double>::size_type count = *itor;
+        *itor = offset;
+        offset += count;
+      }
+      for (std::vector<std::uint64_t>::size_type event_index = 0; event_index < key_cont.size(); ++event_index) {
+        std::vector<double>::size_type & position(count_cont[(key_cont[event_index] >> shift) & digit_mask]);
+        work_key_cont[position] = key_cont[event_index];
+        work_order_cont[position] = order_cont[event_index];
+        ++position;
+      }
+      key_cont.swap(work_key_cont);
+      order_cont.swap(work_order_cont);
+    }
+  }
+
+  typedef std::vector<std::unique_ptr<BlockPhaseComputer> > BlockPhaseComputerCont;
+
+  /** \brief Compute phases of all types for a block of event times, storing phases of each type in a contiguous range
+             of the output array.
+      \param block_computer_cont BlockPhaseComputer objects, one for each type of phase.
+      \param time_block Event times to compute phases for.
+      \param range_size Length of the range of the output array for each type of phase.
+      \param phase_begin Pointer to the first element of the array to store the phases in.
+      \param lock Lock on the library mutex held by the calling thread, or null if there is no such lock.
+  */
+  void computePhaseBlock(const BlockPhaseComputerCont & block_computer_cont, const TimeCont & time_block,
+    std::vector<double>::size_type range_size, double * phase_begin, std::unique_lock<std::mutex> * lock) {
+    for (BlockPhaseComputerCont::size_type index = 0; index < block_computer_cont.size(); ++index) {
+      block_computer_cont[index]->compute(time_block, phase_begin + index * range_size, lock);
+    }
+  }
+
+  /** \class PhaseSummary
+      \brief Summaries of phases of the first type, accumulated while phases are assigned: a phase histogram, sums
+             for periodicity tests, and arrival times and phases for an ephemeris search, any of which may be absent.
+             Arrival times are needed only for an ephemeris search, which requires phases of all events computed.
+  */
+  struct PhaseSummary {
+    PhaseSummary(long num_bin, long max_harmonic, const PhaseTime * search_epoch):
+      m_profile(0 < num_bin ? new PhaseProfile(num_bin) : 0),
+      m_test(0 < max_harmonic ? new PeriodicityTest(max_harmonic) : 0),
+      m_search(search_epoch ? new EphemerisSearch(*search_epoch) : 0) {}
+
+    bool isEmpty() const { return !m_profile.get() && !m_test.get() && !m_search.get(); }
+
+    void fill(const double * phase_begin, const double * phase_end, const PhaseTime * time_begin,
+      const double * weight_begin) {
+      if (m_profile.get()) m_profile->fill(phase_begin, phase_end, weight_begin);
+      if (m_test.get()) m_test->fill(phase_begin, phase_end, weight_begin);
+      if (m_search.get()) {
+        if (!time_begin) throw std::logic_error("Arrival times of events are not available for ephemeris search");
+        m_search->add(time_begin, phase_begin, phase_end, weight_begin);
+      }
+    }
+
+    void merge(const PhaseSummary & other) {
+      if (m_profile.get()) m_profile->merge(*other.m_profile);
+      if (m_test.get()) m_test->merge(*other.m_test);
+      if (m_search.get()) m_search->merge(*other.m_search);
+    }
+
+    std::unique_ptr<PhaseProfile> m_profile;
+    std::unique_ptr<PeriodicityTest> m_test;
+    std::unique_ptr<EphemerisSearch> m_search;
+  };
+
+  /** \brief Add a block of phases to phase summaries, reading the weights of the events from the event table(s).
+      \param column_io Event table(s) to read weights from.
+      \param weight_field Name of the weight field, or NONE if events are not weighted.
+      \param record_index Index of the record of the first event, counted across all event tables.
+      \param phase_begin Pointer to the phase of the first event.
+      \param phase_end Pointer to one past the phase of the last event.
+      \param time_begin Pointer to the arrival time of the first event, or a null pointer if not available.
+      \param weight_block Buffer to read weights into, resized as needed.
+      \param summary Phase summaries to add the phases to.
+  */
+  void fillSummary(const EventColumnIo & column_io, const std::string & weight_field, tip::Index_t record_index,
+    const double * phase_begin, const double * phase_end, const PhaseTime * time_begin,
+    std::vector<double> & weight_block, PhaseSummary & summary) {
+    if ("NONE" == toUpper(weight_field)) {
+      summary.fill(phase_begin, phase_end, time_begin, 0);
+    } else {
+      weight_block.resize(phase_end - phase_begin);
+      column_io.readColumn(weight_field, record_index, &weight_block[0], &weight_block[0] + weight_block.size());
+      summary.fill(phase_begin, phase_end, time_begin, &weight_block[0]);
+    }
+  }
+
+  /** \brief Add phases already written in the event table(s) to phase summaries, a block at a time.
+      \param column_io Event table(s) to read phases and weights from.
+      \param phase_field Name of the phase field.
+      \param weight_field Name of the weight field, or NONE if events are not weighted.
+      \param record_begin Index of the first record to add, counted across all event tables.
+      \param record_end Index of one past the last record to add.
+      \param block_size Number of events to read at a time.
+      \param summary Phase summaries to add the phases to.
+  */
+  void fillSummary(const EventColumnIo & column_io, const std::string & phase_field, const std::string & weight_field,
+    tip::Index_t record_begin, tip::Index_t record_end, long block_size, PhaseSummary & summary) {
+    std::vector<double> phase_block(block_size);
+    std::vector<double> weight_block;
+    for (tip::Index_t record_index = record_begin; record_index < record_end; record_index += block_size) {
+      tip::Index_t num_event = std::min<tip::Index_t>(block_size, record_end - record_index);
+      column_io.readColumn(phase_field, record_index, &phase_block[0], &phase_block[0] + num_event);
+      fillSummary(column_io, weight_field, record_index, &phase_block[0], &phase_block[0] + num_event, 0, weight_block,
+        summary);
+    }
+  }
+
+  /// \brief Additional pulsar whose pulse phases are assigned along with phases of the first pulsar.
+  struct PulsarTarget {
+    const pulsarDb::EphComputer * m_computer;
+    std::string m_phase_field;
+    double m_phase_offset;
+    bool m_bin;
+    bool m_vary_ra_dec;
+    std::pair<double, double> m_src_position;
+    std::pair<double, double> m_roi_center;
+  };
+
+  /** \class FilePulsar
+      \brief Objects to compute pulse phases of an additional pulsar in one event file, owned by the thread processing
+             the event file.
+  */
+  struct FilePulsar {
+    FilePulsar(const PulsarTarget & target, const pulsarDb::EphChooser & chooser, long num_thread,
+      WorkerPool & worker_pool, bool exact, PerformanceMonitor & monitor): m_target(target), m_chooser(chooser.clone()),
+      m_computer(copyEphComputer(*target.m_computer, *m_chooser)), m_block_computer_cont(),
+      m_demodulator(*m_computer, *m_chooser), m_src_position(target.m_src_position) {
+      m_block_computer_cont.push_back(std::unique_ptr<BlockPhaseComputer>(new BlockPhaseComputer(*m_computer,
+        *m_chooser, num_thread, worker_pool, PhaseToolApp::PULSE_PHASE, target.m_phase_offset, exact, monitor)));
+    }
+
+    const PulsarTarget & m_target;
+    std::unique_ptr<pulsarDb::EphChooser> m_chooser;
+    std::unique_ptr<pulsarDb::EphComputer> m_computer;
+    BlockPhaseComputerCont m_block_computer_cont;
+    BinaryDemodulator m_demodulator;
+    std::pair<double, double> m_src_position;
+  };
+
+  /// \brief Settings of phase assignment with arrival time corrections applied by PhaseToolApp, shared by event files.
+  struct FileAssignmentSetting {
+    std::string m_ev_table;
+    std::string m_time_field;
+    std::string m_sc_file;
+    std::string m_sc_table;
+    std::string m_solar_eph;
+    double m_ang_tol;
+    double m_bary_tol;
+    long m_sc_window_size;
+    std::string m_sc_index_file;
+    long m_block_size;
+    long m_num_thread;
+    WorkerPool * m_worker_pool;
+    PhaseToolApp::PhaseSpecCont m_phase_spec_cont;
+    bool m_bary;
+    bool m_bin;
+    bool m_vary_ra_dec;
+    std::pair<double, double> m_src_position;
+    PerformanceMonitor * m_monitor;
+    std::string m_fingerprint;
+    bool m_time_order;
+    std::string m_weight_field;
+    std::string m_cache_field;
+    std::string m_cache_fingerprint;
+    std::vector<PulsarTarget> m_pulsar_cont;
+    double m_roi_radius;
+    std::pair<double, double> m_roi_center;
+  };
+
+  /** \brief Return a fingerprint of the inputs of arrival time corrections, with which arrival times in the cache
+             column are computed, or an empty string if no cache column is requested. Spin ephemerides are not
+             included except for the source positions they give, so that the cache stays valid after an update of
+             spin ephemerides.
+      \param setting Settings of phase assignment.
+      \param computer EphComputer giving the source positions and the orbital ephemerides.
+      \param leap_sec_file Name of the leap seconds file.
+  */
+  std::string computeCacheFingerprint(const FileAssignmentSetting & setting, const pulsarDb::EphComputer & computer,
+    const std::string & leap_sec_file) {
+    if (setting.m_cache_field.empty()) return std::string();
+
+    // Hash the settings of the corrections. The spacecraft data used for the corrections are recorded separately by
+    // writeCacheStatus function, so that the cache stays valid after spacecraft data are added to the spacecraft file.
+    std::ostringstream os;
+    os.precision(17);
+    os << "BARYTIME" << '\n' << setting.m_cache_field << '\n' << setting.m_time_field << '\n' << setting.m_bary <<
+      ' ' << setting.m_bin << '\n' << setting.m_sc_table << '\n' << setting.m_solar_eph << '\n' << setting.m_ang_tol <<
+      ' ' << setting.m_bary_tol << ' ' << (0 < setting.m_sc_window_size) << '\n' << leap_sec_file << '\n';
+
+    // Hash the source position, or the positions given by spin ephemerides over their intervals of validity.
+    if (setting.m_vary_ra_dec) {
+      const pulsarDb::PulsarEphCont & eph_cont(computer.getPulsarEphCont());
+      for (pulsarDb::PulsarEphCont::const_iterator itor = eph_cont.begin(); itor != eph_cont.end(); ++itor) {
+        std::pair<double, double> since_position((*itor)->calcSkyPosition((*itor)->getValidSince()));
+        std::pair<double, double> until_position((*itor)->calcSkyPosition((*itor)->getValidUntil()));
+        os << (*itor)->getValidSince().represent("TDB") << ' ' << (*itor)->getValidUntil().represent("TDB") << ' ' <<
+          since_position.first << ' ' << since_position.second << ' ' << until_position.first << ' ' <<
+          until_position.second << '\n';
+      }
+    } else {
+      os << setting.m_src_position.first << ' ' << setting.m_src_position.second << '\n';
+    }
+
+    // Hash the region of interest, outside which arrival times are not computed.
+    os << setting.m_roi_radius << ' ' << setting.m_roi_center.first << ' ' << setting.m_roi_center.second << '\n';
+
+    // Hash orbital ephemerides if binary demodulation is applied.
+    if (setting.m_bin) {
+      st_stream::OStream eph_os;
+      eph_os.connect(os);
+      const pulsarDb::OrbitalEphCont & eph_cont(computer.getOrbitalEphCont());
+      for (pulsarDb::OrbitalEphCont::const_iterator itor = eph_cont.begin(); itor != eph_cont.end(); ++itor) {
+        (*itor)->write(eph_os);
+        eph_os << std::endl;
+      }
+      eph_os.disconnect(os);
+    }
+
+    std::uint64_t hash = pulsePhaseUtil::s_fnv_offset_basis;
+    pulsePhaseUtil::updateHash(os.str(), hash);
+    return pulsePhaseUtil::toHex(hash);
+  }
+
+  /** \brief Create an EphComputer loaded with the ephemerides of the given pulsar, selected from the given pulsar
+             ephemerides database file(s), or from their snapshot in the given cache directory unless it is NONE.
+      \param psrdb_file Name of the database file, or the name of a list file preceded by "@".
+      \param psrdb_cache Name of the directory to keep snapshots in, or NONE.
+      \param psr_name Name of the pulsar.
+      \param chooser Ephemeris chooser to be used by the EphComputer.
+  */
+  std::unique_ptr<pulsarDb::EphComputer> loadPulsarEph(const std::string & psrdb_file, const std::string & psrdb_cache,
+    const std::string & psr_name, const pulsarDb::EphChooser & chooser) {
+    if ("NONE" == toUpper(psrdb_file)) {
+      throw std::runtime_error("Pulsar ephemerides database file must be given for pulsar \"" + psr_name + "\"");
+    }
+    std::string db_file(psrdb_file);
+    if ("NONE" != toUpper(psrdb_cache)) db_file = PulsarDbCache(psrdb_cache).getSnapshot(psrdb_file, psr_name);
+
+    std::string tpl_file = st_facilities::Env::appendFileName(st_facilities::Env::getDataDir("pulsarDb"),
+      "PulsarDb.tpl");
+    pulsarDb::PulsarDb data_base(tpl_file);
+    EventColumnIo::FileNameCont file_name_cont(st_facilities::FileSys::expandFileList(db_file));
+    for (EventColumnIo::FileNameCont::const_iterator itor = file_name_cont.begin(); itor != file_name_cont.end();
+      ++itor) {
+      data_base.load(*itor);
+    }
+    data_base.filterName(psr_name);
+    std::unique_ptr<pulsarDb::EphComputer> computer(new pulsarDb::EphComputer(chooser));
+    computer->load(data_base);
+    if (computer->getPulsarEphCont().empty()) {
+      throw std::runtime_error("No spin ephemeris found for pulsar \"" + psr_name + "\"");
+    }
+    return computer;
+  }
+
+  /** \brief Compute a phase for each event in one event file and write it into the output field, applying arrival time
+             corrections to event times read from the file. The event file, the spacecraft file, and the ephemerides
+             are accessed through objects owned by this function, so that event files can be processed in different
+             threads at the same time. Calls to FITS I/O, arrival time corrections and phase computation by the
+             ephemerides are serialized by the given mutex, because the libraries are not reentrant, and only
+             evaluation of polynomials of pulse phases runs without the mutex locked.
+      \param file_name Name of the event file.
+      \param computer EphComputer whose ephemerides are used.
+      \param chooser Ephemeris chooser whose copy is used in computation.
+      \param setting Settings of phase assignment.
+      \param library_mutex Mutex to serialize calls to the libraries.
+      \param summary Phase summaries of this event file, to add the phases of the first type to.
+  */
+  void assignFilePhase(const std::string & file_name, const pulsarDb::EphComputer & computer,
+    const pulsarDb::EphChooser & chooser, const FileAssignmentSetting & setting, std::mutex & library_mutex,
+    PhaseSummary & summary) {
+    // Lock the library mutex first, so that it is held while the objects below are destroyed.
+    std::unique_lock<std::mutex> lock(library_mutex);
+
+    // Set up ephemeris computations for this event file.
+    std::unique_ptr<pulsarDb::EphChooser> file_chooser(chooser.clone());
+    std::unique_ptr<pulsarDb::EphComputer> file_computer(copyEphComputer(computer, *file_chooser));
+    const PhaseToolApp::PhaseSpecCont & phase_spec_cont(setting.m_phase_spec_cont);
+    BlockPhaseComputerCont block_computer_cont;
+    for (PhaseToolApp::PhaseSpecCont::const_iterator itor = phase_spec_cont.begin(); itor != phase_spec_cont.end();
+      ++itor) {
+      block_computer_cont.push_back(std::unique_ptr<BlockPhaseComputer>(new BlockPhaseComputer(*file_computer,
+        *file_chooser, setting.m_num_thread, *setting.m_worker_pool, itor->m_phase_type, itor->m_phase_offset,
+        0. == setting.m_bary_tol, *setting.m_monitor)));
+    }
+    BinaryDemodulator demodulator(*file_computer, *file_chooser);
+    std::pair<double, double> src_position(setting.m_src_position);
+    PerformanceMonitor & monitor(*setting.m_monitor);
+
+    // Set up ephemeris computations for additional pulsars, whose pulse phases follow the phases of all types.
+    std::vector<std::unique_ptr<FilePulsar> > file_pulsar_cont;
+    PhaseToolApp::PhaseSpecCont output_spec_cont(phase_spec_cont);
+    for (std::vector<PulsarTarget>::const_iterator itor = setting.m_pulsar_cont.begin();
+      itor != setting.m_pulsar_cont.end(); ++itor) {
+      file_pulsar_cont.push_back(std::unique_ptr<FilePulsar>(new FilePulsar(*itor, chooser, setting.m_num_thread,
+        *setting.m_worker_pool, 0. == setting.m_bary_tol, monitor)));
+      PhaseToolApp::PhaseSpec phase_spec = { PhaseToolApp::PULSE_PHASE, itor->m_phase_field, itor->m_phase_offset };
+      output_spec_cont.push_back(phase_spec);
+    }
+
+    // Open the event table(s) for bulk input and output, and create the output column if not existing.
+    EventColumnIo column_io(EventColumnIo::FileNameCont(1, file_name), setting.m_ev_table);
+    for (PhaseToolApp::PhaseSpecCont::const_iterator itor = output_spec_cont.begin(); itor != output_spec_cont.end();
+      ++itor) {
+      column_io.createField(itor->m_phase_field, "1D");
+    }
+    if (!setting.m_cache_field.empty()) column_io.createField(setting.m_cache_field, "1D");
+
+    // Prepare buffers for a block of events.
+    TimeCont time_block;
+    time_block.reserve(setting.m_block_size);
+    TimeCont pulsar_time_block;
+    pulsar_time_block.reserve(file_pulsar_cont.empty() ? 0 : setting.m_block_size);
+    std::vector<double> elapsed_block(setting.m_block_size);
+    std::vector<double> cached_elapsed_block(setting.m_cache_field.empty() ? 0 : setting.m_block_size);
+    std::vector<double> phase_block(setting.m_block_size * output_spec_cont.size());
+    std::vector<double> weight_block;
+
+    // Prepare buffers for events selected in the region of interest.
+    long roi_block_size = (0. < setting.m_roi_radius ? setting.m_block_size : 0);
+    std::vector<double> ra_block(roi_block_size);
+    std::vector<double> dec_block(roi_block_size);
+    std::vector<double> roi_hav_block(roi_block_size);
+    std::vector<long> select_block;
+    select_block.reserve(roi_block_size);
+    std::vector<double> roi_elapsed_block(roi_block_size);
+    TimeCont roi_time_block;
+    roi_time_block.reserve(roi_block_size);
+    std::vector<double> roi_phase_block(roi_block_size * phase_spec_cont.size());
+
+    // Open the spacecraft file for fingerprints of spacecraft data when they are first needed, with the same rows in a
+    // window as spacecraft positions so that the time index file is shared.
+    std::unique_ptr<ScDataWindow> sc_data_window(nullptr);
+    ScDataFunction sc_data = [&]() -> ScDataWindow & {
+      if (0 == sc_data_window.get()) {
+        long window_size = (0 < setting.m_sc_window_size ? setting.m_sc_window_size : s_sc_data_window_size);
+        std::string index_file(0 < setting.m_sc_window_size ? setting.m_sc_index_file : std::string());
+        sc_data_window.reset(new ScDataWindow(setting.m_sc_file, setting.m_sc_table, window_size, index_file));
+      }
+      return *sc_data_window;
+    };
+
+    // Iterate over event tables, so that a block of events shares the time system and the reference MJD.
+    std::unique_ptr<BaryDelayCache> delay_cache(nullptr);
+    for (EventColumnIo::TableCont::size_type table_index = 0; table_index < column_io.getNumTables(); ++table_index) {
+      // Read the origin of event times, and check whether they need barycentric corrections.
+      const tip::Header & header(column_io.getHeader(table_index));
+      std::string time_system_name;
+      timeSystem::Mjd mjd_ref(0, 0.);
+      readTimeOrigin(header, time_system_name, mjd_ref);
+      std::string time_ref("LOCAL");
+      try {
+        header["TIMEREF"].get(time_ref);
+      } catch (const tip::TipException &) {
+        // Event times are assumed to be local if TIMEREF keyword is not present.
+      }
+      time_ref = toUpper(time_ref);
+      if ("LOCAL" != time_ref && "GEOCENTRIC" != time_ref && "SOLARSYSTEM" != time_ref) {
+        throw std::runtime_error("Unsupported TIMEREF " + time_ref + " in event file " + file_name);
+      }
+      bool apply_bary = (setting.m_bary && "SOLARSYSTEM" != time_ref);
+      bool use_sc_data = (apply_bary && "GEOCENTRIC" != time_ref);
+      timeSystem::AbsoluteTime abs_time_origin(time_system_name, mjd_ref);
+      PhaseTime time_origin(mjd_ref.m_int, mjd_ref.m_frac * PhaseTime::s_sec_per_day);
+
+      // Find events in this event table whose phases are to be computed, skipping those whose phases are up to date
+      // unless arrival times of all events are needed for an ephemeris search.
+      // Times of events whose arrival times are corrected with spacecraft positions are collected in sc_range, starting
+      // from those of events whose phases are up to date.
+      std::string prefix(getFingerprintPrefix(phase_spec_cont));
+      ScDataRange sc_range;
+      tip::Index_t num_phased = summary.m_search.get() ? 0 :
+        readNumPhasedRecord(column_io, table_index, prefix, setting.m_fingerprint, sc_data, sc_range);
+      monitor.addCount("events with phases up to date", num_phased);
+      tip::Index_t record_begin = column_io.getFirstRecord(table_index) + num_phased;
+      tip::Index_t record_end = column_io.getFirstRecord(table_index) + column_io.getNumRecords(table_index);
+      if (!summary.isEmpty()) {
+        PerformanceMonitor::Stage stage(monitor, "phaseSummary");
+        fillSummary(column_io, phase_spec_cont.front().m_phase_field, setting.m_weight_field, record_begin - num_phased,
+          record_begin, setting.m_block_size, summary);
+      }
+
+      // Use arrival times in the cache column if they were computed for all events in this event table with the same
+      // inputs of arrival time corrections. Otherwise, write arrival times into the cache column, if requested, unless
+      // some events are skipped, so that the cache column is complete when the keywords are written. The cache holds
+      // arrival times for the pulsar given by the parameters only, so that event times are still read for additional
+      // pulsars.
+      ScDataRange cache_sc_range;
+      bool use_cache = readCacheStatus(column_io, table_index, setting.m_cache_fingerprint, sc_data, cache_sc_range);
+      if (use_cache) sc_range.include(cache_sc_range);
+      bool write_cache = !use_cache && !setting.m_cache_field.empty() && 0 == num_phased;
+      bool read_time = !use_cache || !file_pulsar_cont.empty() || setting.m_time_order;
+      if (use_cache) monitor.addCount("events with cached arrival times", record_end - record_begin);
+      std::vector<double> cache_block(write_cache ? setting.m_block_size : 0);
+
+      // Set up the computation of the offset of event times in TDB from the sum of the reference MJD and the
+      // mission elapsed time. The offset includes barycentric corrections if they are needed, and it is tabulated
+      // in the same way as barycentric corrections unless event times are already in TDB. Barycentric delays are
+      // tabulated for each source position, sharing the spacecraft file among pulsars.
+      // The offset is computed exactly for each event if the tolerance is zero.
+      DelayTable::FunctionType offset_function;
+      std::unique_ptr<DelayTable> offset_table(nullptr);
+      if (use_cache && file_pulsar_cont.empty()) {
+        // Corrected arrival times are read from the cache column.
+      } else if (apply_bary) {
+        // Open the spacecraft file when barycentric corrections are first needed.
+        if (0 == delay_cache.get()) {
+          delay_cache.reset(new BaryDelayCache(setting.m_sc_file, setting.m_sc_table, setting.m_solar_eph,
+            setting.m_ang_tol, setting.m_bary_tol, setting.m_sc_window_size, setting.m_sc_index_file));
+        }
+        delay_cache->setTimeOrigin(time_system_name, mjd_ref, "GEOCENTRIC" == time_ref);
+      } else if ("TDB" != time_system_name) {
+        offset_function = [abs_time_origin, time_system_name, time_origin](double elapsed_time) {
+          timeSystem::AbsoluteTime abs_time(abs_time_origin + timeSystem::ElapsedTime(time_system_name,
+            timeSystem::Duration(0, elapsed_time)));
+          return (PhaseTime::create(abs_time) - time_origin) - elapsed_time;
+        };
+        if (0. < setting.m_bary_tol) {
+          offset_table.reset(new DelayTable(offset_function, setting.m_bary_tol,
+            BaryDelayCache::s_max_geocentric_derivative));
+        }
+      }
+
+      // Apply arrival time corrections to the given event times for a pulsar, storing them in time_cont.
+      auto correct_block = [&](const pulsarDb::EphComputer & eph_computer, bool vary_ra_dec,
+        std::pair<double, double> & position, bool bin, BinaryDemodulator & eph_demodulator,
+        const double * elapsed_begin, tip::Index_t num_event, TimeCont & time_cont) {
+        time_cont.clear();
+        {
+          PerformanceMonitor::Stage stage(monitor, "barycentricCorrection");
+          for (tip::Index_t event_index = 0; event_index < num_event; ++event_index) {
+            double elapsed_time = elapsed_begin[event_index];
+            double offset = 0.;
+            if (apply_bary) {
+              if (vary_ra_dec) {
+                position = eph_computer.calcSkyPosition(abs_time_origin + timeSystem::ElapsedTime(time_system_name,
+                  timeSystem::Duration(0, elapsed_time)));
+              }
+              offset = delay_cache->computeDelay(elapsed_time, position.first, position.second);
+              if (use_sc_data) sc_range.include(elapsed_time);
+            } else if (offset_table.get()) {
+              offset = offset_table->compute(elapsed_time);
+            } else if (offset_function) {
+              offset = offset_function(elapsed_time);
+            }
+            PhaseTime event_time(time_origin);
+            event_time += elapsed_time + offset;
+            time_cont.push_back(event_time);
+          }
+        }
+        if (bin) {
+          PerformanceMonitor::Stage stage(monitor, "binaryDemodulation");
+          for (TimeCont::iterator itor = time_cont.begin(); itor != time_cont.end(); ++itor) {
+            eph_demodulator.demodulate(*itor);
+          }
+        }
+      };
+
+      // Compute phases for the given event times, leaving the library mutex to other event files while polynomials
+      // are evaluated.
+      auto evaluate_block = [&](const BlockPhaseComputerCont & computer_cont, const TimeCont & time_cont,
+        double * phase_begin) {
+        PerformanceMonitor::Stage stage(monitor, "phaseEvaluation");
+        computePhaseBlock(computer_cont, time_cont, setting.m_block_size, phase_begin, &lock);
+      };
+
+      // Select events in ra_block and dec_block within the region of interest around the given position, gathering
+      // their times from the given block into roi_elapsed_block, and return the number of the selected events.
+      auto select_region = [&](const std::pair<double, double> & center, const double * elapsed_begin,
+        tip::Index_t num_event) {
+        PerformanceMonitor::Stage stage(monitor, "regionSelection");
+        selectRegion(&ra_block[0], &dec_block[0], num_event, center, setting.m_roi_radius, roi_hav_block, select_block);
+        tip::Index_t num_selected = select_block.size();
+        for (tip::Index_t event_index = 0; event_index < num_selected; ++event_index) {
+          roi_elapsed_block[event_index] = elapsed_begin[select_block[event_index]];
+        }
+        return num_selected;
+      };
+
+      // Scatter phases of the selected events in roi_phase_block into phase_block, starting from the range of the given
+      // type of phase, with NaN for the other events.
+      auto scatter_phase = [&](PhaseToolApp::PhaseSpecCont::size_type spec_begin,
+        PhaseToolApp::PhaseSpecCont::size_type num_spec, tip::Index_t num_event) {
+        for (PhaseToolApp::PhaseSpecCont::size_type spec_index = 0; spec_index < num_spec; ++spec_index) {
+          const double * roi_begin = &roi_phase_block[0] + spec_index * setting.m_block_size;
+          double * block_begin = &phase_block[0] + (spec_begin + spec_index) * setting.m_block_size;
+          std::fill(block_begin, block_begin + num_event, std::numeric_limits<double>::quiet_NaN());
+          for (std::vector<long>::size_type event_index = 0; event_index < select_block.size(); ++event_index) {
+            block_begin[select_block[event_index]] = roi_begin[event_index];
+          }
+        }
+      };
+
+      // Compute phases of all types for the event times in elapsed_block, or for the arrival times in
+      // cached_elapsed_block if the cache is used, storing them in phase_block, followed by pulse phases of additional
+      // pulsars for the event times in elapsed_block. If a region of interest is given, arrival time corrections and
+      // phases are computed only for events in the region around each pulsar, and phases of the other events are NaN.
+      bool select_roi = (0. < setting.m_roi_radius);
+      auto process_block = [&](tip::Index_t num_event) {
+        // Select events in the region of interest.
+        const double * elapsed_begin = use_cache ? &cached_elapsed_block[0] : &elapsed_block[0];
+        tip::Index_t num_selected = num_event;
+        if (select_roi) {
+          num_selected = select_region(setting.m_roi_center, elapsed_begin, num_event);
+          elapsed_begin = &roi_elapsed_block[0];
+          monitor.addCount("events outside region of interest", num_event - num_selected);
+        }
+
+        // Apply arrival time corrections to event times, unless they are corrected already.
+        TimeCont & selected_time_block(select_roi ? roi_time_block : time_block);
+        if (use_cache) {
+          selected_time_block.clear();
+          for (tip::Index_t event_index = 0; event_index < num_selected; ++event_index) {
+            PhaseTime event_time(time_origin);
+            event_time += elapsed_begin[event_index];
+            selected_time_block.push_back(event_time);
+          }
+        } else {
+          correct_block(*file_computer, setting.m_vary_ra_dec, src_position, setting.m_bin, demodulator, elapsed_begin,
+            num_selected, selected_time_block);
+        }
+
+        // Compute phases of all types, and scatter them and arrival times to all events if some are not selected.
+        // Arrival times of events not selected are left at the time origin, and are not used because their phases
+        // are NaN.
+        if (select_roi) {
+          evaluate_block(block_computer_cont, roi_time_block, &roi_phase_block[0]);
+          scatter_phase(0, phase_spec_cont.size(), num_event);
+          time_block.assign(num_event, time_origin);
+          for (tip::Index_t event_index = 0; event_index < num_selected; ++event_index) {
+            time_block[select_block[event_index]] = roi_time_block[event_index];
+          }
+        } else {
+          evaluate_block(block_computer_cont, time_block, &phase_block[0]);
+        }
+        if (write_cache) {
+          for (tip::Index_t event_index = 0; event_index < num_event; ++event_index) {
+            cache_block[event_index] = select_roi ? std::numeric_limits<double>::quiet_NaN() :
+              time_block[event_index] - time_origin;
+          }
+          if (select_roi) {
+            for (tip::Index_t event_index = 0; event_index < num_selected; ++event_index) {
+              cache_block[select_block[event_index]] = roi_time_block[event_index] - time_origin;
+            }
+          }
+        }
+
+        // Compute pulse phases of additional pulsars, one pulsar at a time.
+        for (std::vector<std::unique_ptr<FilePulsar> >::size_type pulsar_index = 0;
+          pulsar_index < file_pulsar_cont.size(); ++pulsar_index) {
+          FilePulsar & file_pulsar(*file_pulsar_cont[pulsar_index]);
+          PhaseToolApp::PhaseSpecCont::size_type spec_index = phase_spec_cont.size() + pulsar_index;
+          if (select_roi) {
+            tip::Index_t num_pulsar_selected = select_region(file_pulsar.m_target.m_roi_center, &elapsed_block[0],
+              num_event);
+            correct_block(*file_pulsar.m_computer, file_pulsar.m_target.m_vary_ra_dec, file_pulsar.m_src_position,
+              file_pulsar.m_target.m_bin, file_pulsar.m_demodulator, &roi_elapsed_block[0], num_pulsar_selected,
+              pulsar_time_block);
+            evaluate_block(file_pulsar.m_block_computer_cont, pulsar_time_block, &roi_phase_block[0]);
+            scatter_phase(spec_index, 1, num_event);
+          } else {
+            correct_block(*file_pulsar.m_computer, file_pulsar.m_target.m_vary_ra_dec, file_pulsar.m_src_position,
+              file_pulsar.m_target.m_bin, file_pulsar.m_demodulator, &elapsed_block[0], num_event, pulsar_time_block);
+            evaluate_block(file_pulsar.m_block_computer_cont, pulsar_time_block,
+              &phase_block[0] + spec_index * setting.m_block_size);
+          }
+        }
+        monitor.addCount("events", num_event);
+      };
+
+      // Iterate over blocks of events in the order of records. If timeorder is yes, check that event times are sorted
+      // while reading them, and stop at the first block out of order, to process the rest of the event table in time
+      // order, so that event times are held in memory only for event tables which are not sorted.
+      tip::Index_t unsorted_begin = record_end;
+      double last_time = -std::numeric_limits<double>::infinity();
+      for (tip::Index_t record_index = record_begin; record_index < record_end; record_index += time_block.size()) {
+        // Read event times.
+        tip::Index_t num_event = std::min<tip::Index_t>(setting.m_block_size, record_end - record_index);
+        {
+          PerformanceMonitor::Stage stage(monitor, "readTime");
+          if (read_time) {
+            column_io.readColumn(setting.m_time_field, record_index, &elapsed_block[0], &elapsed_block[0] + num_event);
+          }
+          if (use_cache) {
+            column_io.readColumn(setting.m_cache_field, record_index, &cached_elapsed_block[0],
+              &cached_elapsed_block[0] + num_event);
+          }
+        }
+        if (setting.m_time_order) {
+          bool sorted = !(elapsed_block[0] < last_time);
+          if (!sorted || !std::is_sorted(elapsed_block.begin(), elapsed_block.begin() + num_event)) {
+            unsorted_begin = record_index;
+            break;
+          }
+          last_time = elapsed_block[num_event - 1];
+        }
+        if (select_roi) {
+          PerformanceMonitor::Stage stage(monitor, "readPosition");
+          column_io.readColumn(s_ra_field, record_index, &ra_block[0], &ra_block[0] + num_event);
+          column_io.readColumn(s_dec_field, record_index, &dec_block[0], &dec_block[0] + num_event);
+        }
+        process_block(num_event);
+        if (!summary.isEmpty()) {
+          PerformanceMonitor::Stage stage(monitor, "phaseSummary");
+          fillSummary(column_io, setting.m_weight_field, record_index, &phase_block[0], &phase_block[0] + num_event,
+            &time_block[0], weight_block, summary);
+        }
+
+        // Write phases into output columns.
+        PerformanceMonitor::Stage stage(monitor, "cellWrite");
+        for (PhaseToolApp::PhaseSpecCont::size_type spec_index = 0; spec_index < output_spec_cont.size();
+          ++spec_index) {
+          const double * block_begin = &phase_block[0] + spec_index * setting.m_block_size;
+          column_io.writeColumn(output_spec_cont[spec_index].m_phase_field, record_index, block_begin,
+            block_begin + time_block.size());
+        }
+        if (write_cache) {
+          column_io.writeColumn(setting.m_cache_field, record_index, &cache_block[0], &cache_block[0] + num_event);
+        }
+      }
+
+      if (unsorted_begin < record_end) {
+        // Process the rest of events in time order, so that ephemerides, spacecraft positions and the solar system
+        // ephemeris are looked up in a monotonic sequence of times, and then write phases in the order of records.
+        std::vector<double>::size_type num_record = record_end - unsorted_begin;
+        std::vector<double> table_time_cont(num_record);
+        std::vector<double> table_cached_cont(use_cache ? num_record : 0);
+        {
+          PerformanceMonitor::Stage stage(monitor, "readTime");
+          for (tip::Index_t record_index = unsorted_begin; record_index < record_end;
+            record_index += setting.m_block_size) {
+            tip::Index_t num_event = std::min<tip::Index_t>(setting.m_block_size, record_end - record_index);
+            double * time_begin = &table_time_cont[0] + (record_index - unsorted_begin);
+            column_io.readColumn(setting.m_time_field, record_index, time_begin, time_begin + num_event);
+            if (use_cache) {
+              double * cached_begin = &table_cached_cont[0] + (record_index - unsorted_begin);
+              column_io.readColumn(setting.m_cache_field, record_index, cached_begin, cached_begin + num_event);
+            }
+          }
+        }
+        std::vector<long> order_cont;
+        {
+          PerformanceMonitor::Stage stage(monitor, "sortTime");
+          sortTime(table_time_cont, order_cont);
+        }
+        monitor.addCount("events processed in time order", num_record);
+        std::vector<double> table_ra_cont(select_roi ? num_record : 0);
+        std::vector<double> table_dec_cont(select_roi ? num_record : 0);
+        if (select_roi) {
+          PerformanceMonitor::Stage stage(monitor, "readPosition");
+          for (tip::Index_t record_index = unsorted_begin; record_index < record_end;
+            record_index += setting.m_block_size) {
+            tip::Index_t num_event = std::min<tip::Index_t>(setting.m_block_size, record_end - record_index);
+            double * ra_begin = &table_ra_cont[0] + (record_index - unsorted_begin);
+            double * dec_begin = &table_dec_cont[0] + (record_index - unsorted_begin);
+            column_io.readColumn(s_ra_field, record_index, ra_begin, ra_begin + num_event);
+            column_io.readColumn(s_dec_field, record_index, dec_begin, dec_begin + num_event);
+          }
+        }
+        std::vector<double> table_phase_cont(num_record * output_spec_cont.size());
+        std::vector<PhaseTime> table_event_time_cont(summary.m_search.get() ? num_record : 0);
+        std::vector<double> table_cache_cont(write_cache ? num_record : 0);
+        for (std::vector<double>::size_type sorted_index = 0; sorted_index < num_record;
+          sorted_index += time_block.size()) {
+          tip::Index_t num_event = std::min<tip::Index_t>(setting.m_block_size, num_record - sorted_index);
+          for (tip::Index_t event_index = 0; event_index < num_event; ++event_index) {
+            elapsed_block[event_index] = table_time_cont[order_cont[sorted_index + event_index]];
+          }
+          if (use_cache) {
+            for (tip::Index_t event_index = 0; event_index < num_event; ++event_index) {
+              cached_elapsed_block[event_index] = table_cached_cont[order_cont[sorted_index + event_index]];
+            }
+          }
+          if (select_roi) {
+            for (tip::Index_t event_index = 0; event_index < num_event; ++event_index) {
+              ra_block[event_index] = table_ra_cont[order_cont[sorted_index + event_index]];
+              dec_block[event_index] = table_dec_cont[order_cont[sorted_index + event_index]];
+            }
+          }
+          process_block(num_event);
+          for (PhaseToolApp::PhaseSpecCont::size_type spec_index = 0; spec_index < output_spec_cont.size();
+            ++spec_index) {
+            const double * block_begin = &phase_block[0] + spec_index * setting.m_block_size;
+            double * table_begin = &table_phase_cont[0] + spec_index * num_record;
+            for (tip::Index_t event_index = 0; event_index < num_event; ++event_index) {
+              table_begin[order_cont[sorted_index + event_index]] = block_begin[event_index];
+            }
+          }
+          if (!table_event_time_cont.empty()) {
+            for (tip::Index_t event_index = 0; event_index < num_event; ++event_index) {
+              table_event_time_cont[order_cont[sorted_index + event_index]] = time_block[event_index];
+            }
+          }
+          if (write_cache) {
+            for (tip::Index_t event_index = 0; event_index < num_event; ++event_index) {
+              table_cache_cont[order_cont[sorted_index + event_index]] = cache_block[event_index];
+            }
+          }
+        }
+
+        // Write phases into output columns.
+        PerformanceMonitor::Stage stage(monitor, "cellWrite");
+        for (PhaseToolApp::PhaseSpecCont::size_type spec_index = 0; spec_index < output_spec_cont.size();
+          ++spec_index) {
+          for (tip::Index_t record_index = unsorted_begin; record_index < record_end;
+            record_index += setting.m_block_size) {
+            tip::Index_t num_event = std::min<tip::Index_t>(setting.m_block_size, record_end - record_index);
+            const double * table_begin = &table_phase_cont[0] + spec_index * num_record +
+              (record_index - unsorted_begin);
+            column_io.writeColumn(output_spec_cont[spec_index].m_phase_field, record_index, table_begin,
+              table_begin + num_event);
+          }
+        }
+        if (write_cache) {
+          for (tip::Index_t record_index = unsorted_begin; record_index < record_end;
+            record_index += setting.m_block_size) {
+            tip::Index_t num_event = std::min<tip::Index_t>(setting.m_block_size, record_end - record_index);
+            const double * table_begin = &table_cache_cont[0] + (record_index - unsorted_begin);
+            column_io.writeColumn(setting.m_cache_field, record_index, table_begin, table_begin + num_event);
+          }
+        }
+        if (!summary.isEmpty()) {
+          PerformanceMonitor::Stage stage(monitor, "phaseSummary");
+          for (tip::Index_t record_index = unsorted_begin; record_index < record_end;
+            record_index += setting.m_block_size) {
+            tip::Index_t num_event = std::min<tip::Index_t>(setting.m_block_size, record_end - record_index);
+            const double * table_begin = &table_phase_cont[0] + (record_index - unsorted_begin);
+            const PhaseTime * time_begin = table_event_time_cont.empty() ? 0 :
+              &table_event_time_cont[0] + (record_index - unsorted_begin);
+            fillSummary(column_io, setting.m_weight_field, record_index, table_begin, table_begin + num_event,
+              time_begin, weight_block, summary);
+          }
+        }
+      }
+
+      // Record that phases of all events in this event table are up to date, and that the cache column holds arrival
+      // times of all events, along with the spacecraft data used for them.
+      writeFingerprint(column_io, table_index, prefix, setting.m_fingerprint, sc_data, sc_range);
+      if (write_cache) writeCacheStatus(column_io, table_index, setting.m_cache_fingerprint, sc_data, sc_range);
+    }
+  }
+
+}
+
+PhaseToolApp::PhaseToolApp(): StdioPipe(), pulsarDb::PulsarToolApp(), m_event_file_name(), m_psrdb_file_name(),
+  m_phased_file_cont(), m_phased_table_name(), m_monitor(), m_fingerprint(), m_max_harmonic(0), m_periodicity_test(),
+  m_search_requested(false), m_ephemeris_search() {}
+
+PhaseToolApp::~PhaseToolApp() throw() {}
+
+void PhaseToolApp::prepareEventFile(st_app::AppParGroup & pars) {
+  std::string ev_file = pars["evfile"];
+  std::string out_file = pars["outfile"];
+  m_event_file_name = ev_file;
+
+  // Process the input event file in place, unless an output file is given.
+  if ("NONE" == toUpper(out_file)) {
+    if ("-" == ev_file) {
+      throw std::runtime_error("An output file must be given to read an event file from the standard input");
+    }
+    return;
+  }
+
+  // Read the input event file from the standard input, if requested.
+  if ("-" == ev_file) {
+    ev_file = openInputPipe();
+  } else if (st_facilities::FileSys::expandFileList(ev_file).size() != 1) {
+    throw std::runtime_error("An output file can be given only for a single input event file");
+  }
+
+  // Write the output event file to the standard output, if requested.
+  tip::IFileSvc & file_svc(tip::IFileSvc::instance());
+  if ("-" == out_file) {
+    out_file = openOutputPipe();
+  } else {
+    bool clobber = pars["clobber"];
+    if (!clobber && file_svc.fileExists(out_file)) {
+      throw std::runtime_error("Output file \"" + out_file + "\" already exists; set clobber=yes to overwrite it");
+    }
+  }
+
+  // Copy the whole input event file into the output file, and process the copy in place, so that every phase path
+  // reads and writes the output file through the base class and EventColumnIo as it does an input event file.
+  file_svc.openFile(ev_file).copyFile(out_file, true);
+  pars["evfile"] = out_file;
+}
+
+void PhaseToolApp::preparePulsarDb(st_app::AppParGroup & pars) {
+  std::string psrdb_cache = pars["psrdbcache"];
+  std::string psrdb_file = pars["psrdbfile"];
+  std::string psr_name = pars["psrname"];
+  if ("NONE" == toUpper(psrdb_cache) || "NONE" == toUpper(psrdb_file) || "ANY" == toUpper(psr_name)) return;
+
+  // Load ephemerides from the snapshot, instead of the database file(s).
+  PulsarDbCache cache(psrdb_cache);
+  pars["psrdbfile"] = cache.getSnapshot(psrdb_file, psr_name);
+  m_psrdb_file_name = psrdb_file;
+}
+
+void PhaseToolApp::restoreParameter(st_app::AppParGroup & pars) const {
+  if (!m_event_file_name.empty()) pars["evfile"] = m_event_file_name;
+  if (!m_psrdb_file_name.empty()) pars["psrdbfile"] = m_psrdb_file_name;
+}
+
+void PhaseToolApp::updateChecksum() const {
+  for (std::vector<std::string>::const_iterator itor = m_phased_file_cont.begin(); itor != m_phased_file_cont.end();
+    ++itor) {
+    EventColumnIo::updateChecksum(*itor, m_phased_table_name);
+  }
+}
+
+void PhaseToolApp::initPerformanceMonitor(const st_app::AppParGroup & pars) {
+  bool perf_report = pars["perfreport"];
+  std::string perf_file = pars["perffile"];
+  int chatter = pars["chatter"];
+  m_monitor.enable(perf_report || "NONE" != toUpper(perf_file) || chatter >= 4);
+}
+
+void PhaseToolApp::initIncrementalMode(const st_app::AppParGroup & pars,
+  const std::vector<std::string> & par_name_cont) {
+  m_fingerprint.clear();
+  bool incremental = pars["incremental"];
+  if (!incremental) return;
+
+  // Hash the name of this application, and the names and the values of the given parameters.
+  std::uint64_t hash = pulsePhaseUtil::s_fnv_offset_basis;
+  pulsePhaseUtil::updateHash(getName(), hash);
+  for (std::vector<std::string>::const_iterator itor = par_name_cont.begin(); itor != par_name_cont.end(); ++itor) {
+    std::string par_value = pars[*itor];
+    pulsePhaseUtil::updateHash(*itor, hash);
+    pulsePhaseUtil::updateHash(par_value, hash);
+  }
+
+  // Hash the name, the size and the modification time of the pulsar ephemerides database file(s), so that an update
+  // of the database is detected without reading it. The spacecraft file is not included, because it grows as
+  // spacecraft data are added to it. Instead, the spacecraft data used for phases are recorded for each event table
+  // by assignPhase method.
+  std::ostringstream identity_os;
+  std::string psrdb_file = pars["psrdbfile"];
+  if ("NONE" != toUpper(psrdb_file)) writeFileIdentity(psrdb_file, "pulsar ephemerides database file", identity_os);
+  pulsePhaseUtil::updateHash(identity_os.str(), hash);
+  m_fingerprint = pulsePhaseUtil::toHex(hash);
+}
+
+PerformanceMonitor & PhaseToolApp::getPerformanceMonitor() {
+  return m_monitor;
+}
+
+void PhaseToolApp::reportPerformance(const st_app::AppParGroup & pars, const CachedEphChooser & chooser,
+  st_stream::OStream & os) {
+  if (!m_monitor.isEnabled()) return;
+
+  // Add counters of the ephemeris chooser.
+  m_monitor.addCount("ephemeris choices", chooser.getNumCall());
+  m_monitor.addCount("ephemeris searches", chooser.getNumSearch());
+
+  // Report to the given stream, and to a file if requested.
+  m_monitor.report(os);
+  std::string perf_file = pars["perffile"];
+  if ("NONE" != toUpper(perf_file)) m_monitor.writeJson(perf_file, getName());
+}
+
+void PhaseToolApp::assignPhase(const st_app::AppParGroup & pars, const pulsarDb::EphChooser & chooser,
+  PhaseType_e phase_type, const std::string & phase_field, double phase_offset) {
+  PhaseSpec phase_spec = { phase_type, phase_field, phase_offset };
+  assignPhase(pars, chooser, PhaseSpecCont(1, phase_spec));
+}
+
+void PhaseToolApp::assignPhase(const st_app::AppParGroup & pars, const pulsarDb::EphChooser & chooser,
+  const PhaseSpecCont & phase_spec_cont) {
+  assignPhase(pars, chooser, phase_spec_cont, PulsarSpecCont());
+}
+
+void PhaseToolApp::assignPhase(const st_app::AppParGroup & pars, const pulsarDb::EphChooser & chooser,
+  const PhaseSpecCont & phase_spec_cont, const PulsarSpecCont & pulsar_spec_cont) {
+  if (phase_spec_cont.empty()) return;
+
+  // Read the number of events in a block, and the number of threads to compute phases with.
+  long block_size = pars["blocksize"];
+  if (block_size <= 0) throw std::runtime_error("Block size must be positive");
+  long num_thread = pars["nthreads"];
+  if (num_thread < 0) {
+    throw std::runtime_error("Number of threads must be zero or positive");
+  } else if (num_thread == 0) {
+    num_thread = std::thread::hardware_concurrency();
+    if (num_thread == 0) num_thread = 1;
+  }
+
+  // Read the setting of arrival time corrections selected by the parameters.
+  TimeCorrectionSetting tcmode(readTimeCorrectionSetting(pars));
+
+  // Read the tolerance of barycentric delays.
+  double bary_tol = pars["barytol"];
+  if (bary_tol < 0.) throw std::runtime_error("Tolerance of barycentric delays must be zero or positive");
+  if (!pulsar_spec_cont.empty() && SUPPRESSED != tcmode.m_pdot) {
+    throw std::runtime_error("Phase assignment for a list of pulsars cannot be combined with pdot cancellation");
+  }
+
+  // Read the radius of the region of interest.
+  double roi_radius = pars["roiradius"];
+  if (roi_radius < 0.) throw std::runtime_error("Radius of the region of interest must be zero or positive");
+  if (0. < roi_radius && SUPPRESSED != tcmode.m_pdot) {
+    throw std::runtime_error("Selection of a region of interest cannot be combined with pdot cancellation");
+  }
+
+  // Read the number of rows of the spacecraft file to keep in memory, and the name of its time index file.
+  long sc_window_size = pars["scwindow"];
+  if (sc_window_size < 0) {
+    throw std::runtime_error("Number of rows of spacecraft data in memory must be zero or positive");
+  }
+  std::string sc_index_file = pars["scindex"];
+
+  // Read the number of event files to process concurrently.
+  long num_file_thread = pars["filethreads"];
+  if (num_file_thread < 0) {
+    throw std::runtime_error("Number of event files to process concurrently must be zero or positive");
+  } else if (num_file_thread == 0) {
+    num_file_thread = std::thread::hardware_concurrency();
+    if (num_file_thread == 0) num_file_thread = 1;
+  }
+
+  // Read the settings of the phase histogram.
+  long num_bin = pars["nbins"];
+  if (num_bin < 0) throw std::runtime_error("Number of phase bins must be zero or positive");
+  std::string profile_file = pars["profile"];
+  std::string weight_field = pars["weightfield"];
+  if (0 < num_bin && "NONE" == toUpper(profile_file)) {
+    throw std::runtime_error("Name of the phase profile file must be given if the number of phase bins is positive");
+  }
+
+  // Read the name of the column to cache arrival times in.
+  std::string cache_field = pars["barycol"];
+  std::string time_field = pars["timefield"];
+  if ("NONE" == toUpper(cache_field)) {
+    cache_field.clear();
+  } else if (toUpper(cache_field) == toUpper(time_field)) {
+    throw std::runtime_error("Column to cache arrival times in must differ from the time column");
+  }
+
+  // Get EphComputer for phase computation.
+  std::string ev_file = pars["evfile"];
+  std::string ev_table = pars["evtable"];
+  pulsarDb::EphComputer & computer(getEphComputer());
+
+  // Remember the event tables to update data checksums of, after history records are written into them.
+  m_phased_file_cont = st_facilities::FileSys::expandFileList(ev_file);
+  m_phased_table_name = ev_table;
+
+  // Prepare summaries of phases of the first type, with trial offsets of an ephemeris search applied at the epoch of
+  // the spin ephemeris.
+  std::unique_ptr<PhaseTime> search_epoch(nullptr);
+  if (m_search_requested) {
+    const pulsarDb::PulsarEphCont & eph_cont(computer.getPulsarEphCont());
+    if (1 != eph_cont.size()) throw std::runtime_error("Ephemeris search requires exactly one spin ephemeris");
+    search_epoch.reset(new PhaseTime(PhaseTime::create(eph_cont.front()->getEpoch())));
+  }
+  PhaseSummary summary(num_bin, m_max_harmonic, search_epoch.get());
+
+  // Load ephemerides of additional pulsars, each into its own EphComputer.
+  std::string psrdb_file = pars["psrdbfile"];
+  if (!m_psrdb_file_name.empty()) psrdb_file = m_psrdb_file_name;
+  std::string psrdb_cache = pars["psrdbcache"];
+  std::vector<std::unique_ptr<pulsarDb::EphComputer> > pulsar_computer_cont;
+  std::string fingerprint(m_fingerprint);
+  if (!pulsar_spec_cont.empty()) {
+    PerformanceMonitor::Stage stage(m_monitor, "initPulsarList");
+    std::set<std::string> field_name_set;
+    field_name_set.insert(toUpper(time_field));
+    if (!cache_field.empty()) field_name_set.insert(toUpper(cache_field));
+    for (PhaseSpecCont::const_iterator itor = phase_spec_cont.begin(); itor != phase_spec_cont.end(); ++itor) {
+      field_name_set.insert(toUpper(itor->m_phase_field));
+    }
+    for (PulsarSpecCont::const_iterator itor = pulsar_spec_cont.begin(); itor != pulsar_spec_cont.end(); ++itor) {
+      if (!field_name_set.insert(toUpper(itor->m_phase_field)).second) {
+        throw std::runtime_error("Column \"" + itor->m_phase_field + "\" for pulsar \"" + itor->m_psr_name +
+          "\" is used for another output");
+      }
+      pulsar_computer_cont.push_back(loadPulsarEph(psrdb_file, psrdb_cache, itor->m_psr_name, chooser));
+    }
+    m_monitor.addCount("pulsars in list", pulsar_spec_cont.size());
+
+    // Include the pulsars and their output fields in the fingerprint of the incremental mode.
+    if (!fingerprint.empty()) {
+      std::uint64_t hash = pulsePhaseUtil::s_fnv_offset_basis;
+      pulsePhaseUtil::updateHash(fingerprint, hash);
+      for (PulsarSpecCont::const_iterator itor = pulsar_spec_cont.begin(); itor != pulsar_spec_cont.end(); ++itor) {
+        pulsePhaseUtil::updateHash(itor->m_psr_name, hash);
+        pulsePhaseUtil::updateHash(itor->m_phase_field, hash);
+      }
+      fingerprint = pulsePhaseUtil::toHex(hash);
+    }
+  }
+
+  if (SUPPRESSED != tcmode.m_pdot) {
+    // Read event times one at a time through the base class, which is the only one to apply pdot cancellation. Open
+    // the event table(s) for bulk output, and create the output column if not existing in the event file(s).
+    EventColumnIo column_io(st_facilities::FileSys::expandFileList(ev_file), ev_table);
+    for (PhaseSpecCont::const_iterator itor = phase_spec_cont.begin(); itor != phase_spec_cont.end(); ++itor) {
+      column_io.createField(itor->m_phase_field, "1D");
+    }
+
+    // Start worker threads for the run, and set up the computation of each type of phase.
+    WorkerPool worker_pool(num_thread - 1);
+    BlockPhaseComputerCont block_computer_cont;
+    for (PhaseSpecCont::const_iterator itor = phase_spec_cont.begin(); itor != phase_spec_cont.end(); ++itor) {
+      block_computer_cont.push_back(std::unique_ptr<BlockPhaseComputer>(new BlockPhaseComputer(computer, chooser,
+        num_thread, worker_pool, itor->m_phase_type, itor->m_phase_offset, 0. == bary_tol, m_monitor)));
+    }
+
+    // Prepare buffers for a block of events.
+    TimeCont time_block;
+    time_block.reserve(block_size);
+    std::vector<double> phase_block(block_size * phase_spec_cont.size());
+    std::vector<double> weight_block;
+
+    // Open the spacecraft file for fingerprints of spacecraft data when they are first needed.
+    std::string sc_file = pars["scfile"];
+    std::string sc_table = pars["sctable"];
+    std::unique_ptr<ScDataWindow> sc_data_window(nullptr);
+    ScDataFunction sc_data = [&]() -> ScDataWindow & {
+      if (0 == sc_data_window.get()) {
+        long window_size = (0 < sc_window_size ? sc_window_size : s_sc_data_window_size);
+        std::string index_file(0 < sc_window_size && "NONE" != toUpper(sc_index_file) ? sc_index_file : std::string());
+        sc_data_window.reset(new ScDataWindow(sc_file, sc_table, window_size, index_file));
+      }
+      return *sc_data_window;
+    };
+    std::vector<double> elapsed_block;
+
+    // Iterate over event tables, with arrival time corrections applied by the base class.
+    std::string prefix(getFingerprintPrefix(phase_spec_cont));
+    setFirstEvent();
+    for (EventColumnIo::TableCont::size_type table_index = 0; table_index < column_io.getNumTables(); ++table_index) {
+      // Check whether the base class corrects event times in this event table with spacecraft positions.
+      std::string time_ref("LOCAL");
+      try {
+        column_io.getHeader(table_index)["TIMEREF"].get(time_ref);
+      } catch (const tip::TipException &) {
+        // Event times are assumed to be local if TIMEREF keyword is not present.
+      }
+      bool use_sc_data = (SUPPRESSED != tcmode.m_bary && "NONE" != toUpper(sc_file) && "LOCAL" == toUpper(time_ref));
+
+      // Skip events whose phases are up to date, without computing their arrival time corrections, unless arrival
+      // times of all events are needed for an ephemeris search. Times of events whose arrival times are corrected
+      // with spacecraft positions are collected in sc_range, starting from those of events whose phases are up to
+      // date.
+      ScDataRange sc_range;
+      tip::Index_t num_phased = summary.m_search.get() ? 0 : readNumPhasedRecord(column_io, table_index, prefix,
+        m_fingerprint, sc_data, sc_range);
+      m_monitor.addCount("events with phases up to date", num_phased);
+      for (tip::Index_t event_index = 0; event_index < num_phased && !isEndOfEventList(); ++event_index) setNextEvent();
+      if (!summary.isEmpty()) {
+        PerformanceMonitor::Stage stage(m_monitor, "phaseSummary");
+        tip::Index_t record_begin = column_io.getFirstRecord(table_index);
+        fillSummary(column_io, phase_spec_cont.front().m_phase_field, weight_field, record_begin,
+          record_begin + num_phased, block_size, summary);
+      }
+
+      // Iterate over blocks of the other events in this event table.
+      tip::Index_t record_end = column_io.getFirstRecord(table_index) + column_io.getNumRecords(table_index);
+      for (tip::Index_t record_index = column_io.getFirstRecord(table_index) + num_phased; record_index < record_end;
+        record_index += time_block.size()) {
+        // Read event times, converting them from AbsoluteTime. Times spent in arrival time corrections are included.
+        tip::Index_t num_event = std::min<tip::Index_t>(block_size, record_end - record_index);
+        time_block.clear();
+        {
+          PerformanceMonitor::Stage stage(m_monitor, "readTime");
+          for (; !isEndOfEventList() && time_block.size() < TimeCont::size_type(num_event); setNextEvent()) {
+            time_block.push_back(PhaseTime::create(getEventTime()));
+          }
+        }
+        if (time_block.empty()) throw std::runtime_error("Event file(s) ended before all the events were read");
+        m_monitor.addCount("events", time_block.size());
+        if (use_sc_data && !m_fingerprint.empty()) {
+          elapsed_block.resize(time_block.size());
+          column_io.readColumn(time_field, record_index, &elapsed_block[0], &elapsed_block[0] + elapsed_block.size());
+          for (std::vector<double>::const_iterator itor = elapsed_block.begin(); itor != elapsed_block.end(); ++itor) {
+            sc_range.include(*itor);
+          }
+        }
+
+        // Compute phases of all types, and write them into output columns.
+        {
+          PerformanceMonitor::Stage stage(m_monitor, "phaseEvaluation");
+          computePhaseBlock(block_computer_cont, time_block, block_size, &phase_block[0], 0);
+        }
+        if (!summary.isEmpty()) {
+          PerformanceMonitor::Stage stage(m_monitor, "phaseSummary");
+          fillSummary(column_io, weight_field, record_index, &phase_block[0], &phase_block[0] + time_block.size(),
+            &time_block[0], weight_block, summary);
+        }
+        PerformanceMonitor::Stage stage(m_monitor, "cellWrite");
+        for (PhaseSpecCont::size_type spec_index = 0; spec_index < phase_spec_cont.size(); ++spec_index) {
+          const double * block_begin = &phase_block[0] + spec_index * block_size;
+          column_io.writeColumn(phase_spec_cont[spec_index].m_phase_field, record_index, block_begin,
+            block_begin + time_block.size());
+        }
+      }
+
+      // Record that phases of all events in this event table are up to date, along with the spacecraft data used for
+      // them.
+      writeFingerprint(column_io, table_index, prefix, m_fingerprint, sc_data, sc_range);
+    }
+
+  } else {
+    // Collect settings for arrival time corrections.
+    std::string sc_file = pars["scfile"];
+    std::string sc_table = pars["sctable"];
+    std::string solar_eph = pars["solareph"];
+    FileAssignmentSetting setting;
+    setting.m_ev_table = ev_table;
+    setting.m_time_field = time_field;
+    setting.m_sc_file = sc_file;
+    setting.m_sc_table = sc_table;
+    setting.m_solar_eph = solar_eph;
+    setting.m_ang_tol = pars["angtol"];
+    setting.m_bary_tol = bary_tol;
+    setting.m_sc_window_size = sc_window_size;
+    setting.m_sc_index_file = ("NONE" == toUpper(sc_index_file) ? std::string() : sc_index_file);
+    setting.m_block_size = block_size;
+    setting.m_num_thread = num_thread;
+    setting.m_worker_pool = 0;
+    setting.m_phase_spec_cont = phase_spec_cont;
+    setting.m_monitor = &m_monitor;
+    setting.m_fingerprint = fingerprint;
+    setting.m_time_order = pars["timeorder"];
+    setting.m_weight_field = weight_field;
+    setting.m_cache_field = cache_field;
+    setting.m_src_position = std::make_pair(0., 0.);
+    if (!tcmode.m_vary_ra_dec) {
+      setting.m_src_position.first = pars["ra"];
+      setting.m_src_position.second = pars["dec"];
+    }
+
+    // Apply barycentric corrections unless suppressed, and apply binary demodulation if required, or if allowed and
+    // orbital ephemerides are available.
+    setting.m_bary = (SUPPRESSED != tcmode.m_bary);
+    setting.m_bin = (REQUIRED == tcmode.m_bin || (ALLOWED == tcmode.m_bin && !computer.getOrbitalEphCont().empty()));
+
+    // Compute orbital phases only from arrival times corrected in the same way as gtophase, i.e., with both barycentric
+    // corrections and binary demodulation applied.
+    for (PhaseSpecCont::const_iterator itor = phase_spec_cont.begin(); itor != phase_spec_cont.end(); ++itor) {
+      if (ORBITAL_PHASE == itor->m_phase_type && !(setting.m_bary && setting.m_bin)) {
+        throw std::runtime_error("Orbital phases require both barycentric corrections and binary demodulation to be "
+          "applied to arrival times, as in gtophase");
+      }
+    }
+
+    // Look up the source position only once if it does not vary among spin ephemerides.
+    setting.m_vary_ra_dec = tcmode.m_vary_ra_dec && !findFixedPosition(computer.getPulsarEphCont(), setting.m_ang_tol,
+      setting.m_src_position);
+
+    // Select events in the region of interest around the source position, if requested.
+    setting.m_roi_radius = roi_radius;
+    setting.m_roi_center = std::make_pair(0., 0.);
+    if (0. < roi_radius) {
+      setting.m_roi_center = computeRegionCenter(computer, setting.m_vary_ra_dec, setting.m_src_position);
+    }
+
+    // Fingerprint the inputs of arrival time corrections, to reuse arrival times in the cache column, if requested.
+    std::string leap_sec_file = pars["leapsecfile"];
+    setting.m_cache_fingerprint = computeCacheFingerprint(setting, computer, leap_sec_file);
+
+    // Set up arrival time corrections for additional pulsars in the same way, with source positions always taken from
+    // their spin ephemerides, and pulse phases offset in the same way as those of the first pulsar.
+    double pulsar_phase_offset = 0.;
+    for (PhaseSpecCont::const_iterator itor = phase_spec_cont.begin(); itor != phase_spec_cont.end(); ++itor) {
+      if (PULSE_PHASE == itor->m_phase_type) {
+        pulsar_phase_offset = itor->m_phase_offset;
+        break;
+      }
+    }
+    for (PulsarSpecCont::size_type pulsar_index = 0; pulsar_index < pulsar_spec_cont.size(); ++pulsar_index) {
+      const pulsarDb::EphComputer & pulsar_computer(*pulsar_computer_cont[pulsar_index]);
+      PulsarTarget target;
+      target.m_computer = &pulsar_computer;
+      target.m_phase_field = pulsar_spec_cont[pulsar_index].m_phase_field;
+      target.m_phase_offset = pulsar_phase_offset;
+      target.m_bin = (REQUIRED == tcmode.m_bin ||
+        (ALLOWED == tcmode.m_bin && !pulsar_computer.getOrbitalEphCont().empty()));
+      target.m_src_position = std::make_pair(0., 0.);
+      target.m_vary_ra_dec = !findFixedPosition(pulsar_computer.getPulsarEphCont(), setting.m_ang_tol,
+        target.m_src_position);
+      target.m_roi_center = std::make_pair(0., 0.);
+      if (0. < roi_radius) {
+        target.m_roi_center = computeRegionCenter(pulsar_computer, target.m_vary_ra_dec, target.m_src_position);
+      }
+      setting.m_pulsar_cont.push_back(target);
+    }
+
+    // Process event files by a pool of threads, each taking the next event file not taken yet. The calling thread
+    // is one of the pool. After an error, no more event files are taken. Phase summaries are accumulated for each
+    // event file, and added up in the order of event files afterwards, so that they do not depend on the order in
+    // which the threads finish.
+    EventColumnIo::FileNameCont file_name_cont(st_facilities::FileSys::expandFileList(ev_file));
+    std::vector<std::exception_ptr> error_cont(file_name_cont.size());
+    std::vector<std::unique_ptr<PhaseSummary> > file_summary_cont(file_name_cont.size());
+    for (std::vector<std::unique_ptr<PhaseSummary> >::iterator itor = file_summary_cont.begin();
+      itor != file_summary_cont.end(); ++itor) {
+      itor->reset(new PhaseSummary(num_bin, m_max_harmonic, search_epoch.get()));
+    }
+    std::atomic<EventColumnIo::FileNameCont::size_type> next_file(0);
+    std::atomic<bool> failed(false);
+    std::mutex library_mutex;
+    auto process_file = [&]() {
+      for (EventColumnIo::FileNameCont::size_type file_index = next_file++;
+        file_index < file_name_cont.size() && !failed; file_index = next_file++) {
+        try {
+          assignFilePhase(file_name_cont[file_index], computer, chooser, setting, library_mutex,
+            *file_summary_cont[file_index]);
+        } catch (...) {
+          error_cont[file_index] = std::current_exception();
+          failed = true;
+        }
+      }
+    };
+    long num_pool_thread = std::min<long>(num_file_thread, file_name_cont.size());
+
+    // Start worker threads for phase computation once for the run, enough for every event file processed at a time
+    // to use the requested number of threads. They are shared by all event files.
+    WorkerPool worker_pool((num_thread - 1) * std::max<long>(num_pool_thread, 1));
+    setting.m_worker_pool = &worker_pool;
+    std::vector<std::thread> thread_cont;
+    for (long thread_index = 1; thread_index < num_pool_thread; ++thread_index) {
+      thread_cont.push_back(std::thread(process_file));
+    }
+    process_file();
+    for (std::vector<std::thread>::iterator itor = thread_cont.begin(); itor != thread_cont.end(); ++itor) itor->join();
+
+    // Report the error for the first event file that failed.
+    for (std::vector<std::exception_ptr>::iterator itor = error_cont.begin(); itor != error_cont.end(); ++itor) {
+      if (*itor) std::rethrow_exception(*itor);
+    }
+    for (std::vector<std::unique_ptr<PhaseSummary> >::iterator itor = file_summary_cont.begin();
+      itor != file_summary_cont.end(); ++itor) {
+      summary.merge(**itor);
+    }
+  }
+
+  // Write the phase histogram, and keep the sums for periodicity tests.
+  if (summary.m_profile.get()) {
+    bool clobber = pars["clobber"];
+    summary.m_profile->write(profile_file, phase_spec_cont.front().m_phase_field, weight_field, clobber);
+  }
+  m_periodicity_test.reset(summary.m_test.release());
+  m_ephemeris_search.reset(summary.m_search.release());
+}
+
+void PhaseToolApp::initPeriodicityTest(long max_harmonic) {
+  if (max_harmonic < 0) throw std::runtime_error("Maximum number of harmonics must be zero or positive");
+  m_max_harmonic = max_harmonic;
+  m_periodicity_test.reset(0);
+}
+
+const PeriodicityTest * PhaseToolApp::getPeriodicityTest() const {
+  return m_periodicity_test.get();
+}
+
+void PhaseToolApp::initEphemerisSearch(bool search_requested) {
+  m_search_requested = search_requested;
+  m_ephemeris_search.reset(0);
+}
+
+const EphemerisSearch * PhaseToolApp::getEphemerisSearch() const {
+  return m_ephemeris_search.get();
+}
+
+void PhaseToolApp::readPulsarList(const std::string & list_file, PulsarSpecCont & pulsar_spec_cont) const {
+  std::ifstream ifs(list_file.c_str());
+  if (!ifs) throw std::runtime_error("Cannot open pulsar list file \"" + list_file + "\"");
+  for (std::string line; std::getline(ifs, line); ) {
+    // Skip blank lines and comments.
+    std::string::size_type field_begin = line.find_first_not_of(" \t\r");
+    if (std::string::npos == field_begin || '#' == line[field_begin]) continue;
+
+    // Split the line into the name of the output field and the name of the pulsar.
+    std::string::size_type field_end = line.find_first_of(" \t", field_begin);
+    std::string::size_type name_begin = line.find_first_not_of(" \t\r", field_end);
+    if (std::string::npos == field_end || std::string::npos == name_begin) {
+      throw std::runtime_error("Pulsar name is missing in line \"" + line + "\" of pulsar list file \"" + list_file +
+        "\"");
+    }
+    std::string::size_type name_end = line.find_last_not_of(" \t\r") + 1;
+    PulsarSpec pulsar_spec = { line.substr(name_begin, name_end - name_begin),
+      line.substr(field_begin, field_end - field_begin) };
+    pulsar_spec_cont.push_back(pulsar_spec);
+  }
+}
@@ -0,0 +1,259 @@
+/** \file PhaseToolApp.h
+    \brief Declaration of PhaseToolApp class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PhaseToolApp_h
+#define pulsePhase_PhaseToolApp_h
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EphemerisSearch.h"
+#include "PerformanceMonitor.h"
+#include "PeriodicityTest.h"
+#include "StdioPipe.h"
+
+#include "pulsarDb/PulsarToolApp.h"
+
+class CachedEphChooser;
+
+namespace pulsarDb {
+  class EphChooser;
+}
+
+namespace st_app {
+  class AppParGroup;
+}
+
+namespace st_stream {
+  class OStream;
+}
+
+/** \class PhaseToolApp
+    \brief Base class of the phase assignment applications, which implements the event loop shared by them.
+           StdioPipe is a base class of this class, ahead of PulsarToolApp, so that the output file is sent to the
+           standard output only after the event files are closed by PulsarToolApp.
+*/
+class PhaseToolApp : private StdioPipe, public pulsarDb::PulsarToolApp {
+  public:
+    /// \brief Type of phase to be assigned to events.
+    enum PhaseType_e { PULSE_PHASE, ORBITAL_PHASE };
+
+    /// \brief Phase to be assigned to events, and the output field to write it into.
+    struct PhaseSpec {
+      PhaseType_e m_phase_type;
+      std::string m_phase_field;
+      double m_phase_offset;
+    };
+
+    typedef std::vector<PhaseSpec> PhaseSpecCont;
+
+    /// \brief Pulsar whose pulse phases are assigned along with phases of the pulsar given by psrname parameter.
+    struct PulsarSpec {
+      std::string m_psr_name;
+      std::string m_phase_field;
+    };
+
+    typedef std::vector<PulsarSpec> PulsarSpecCont;
+
+    /// \brief Construct a PhaseToolApp object.
+    PhaseToolApp();
+
+    /// \brief Destruct this PhaseToolApp object.
+    virtual ~PhaseToolApp() throw();
+
+  protected:
+    /// \brief Setting of arrival time corrections, as given to the base class by an application.
+    struct TimeCorrectionSetting {
+      TimeCorrectionMode_e m_bary;
+      TimeCorrectionMode_e m_bin;
+      TimeCorrectionMode_e m_pdot;
+      bool m_vary_ra_dec;
+    };
+
+    /** \brief Return the setting of arrival time corrections which the given parameters select, the same one as given
+               to selectTimeCorrectionMode and initTimeCorrection methods of the base class by the application, so that
+               arrival time corrections can also be applied by this class.
+        \param pars Parameter group.
+    */
+    virtual TimeCorrectionSetting readTimeCorrectionSetting(const st_app::AppParGroup & pars) const = 0;
+
+    /** \brief Prepare the event file to be processed. If outfile parameter is not NONE (case-insensitive), the input
+               event file is copied into the output file, and evfile parameter is replaced with the name of the output
+               file, so that phases are written into the copy and the input event file is left intact. Either file name
+               may be "-" for the standard input or the standard output, respectively. This method must be called
+               before openEventFile method is called. The output file is not streamed from the input event file: the
+               whole input event file is copied first, and assignPhase method then adds the phase column(s) to the copy
+               if not present, and writes phases into the copy in blocks of events, in the same way as an event file
+               modified in place. The output file therefore saves no input or output over copying the event file and
+               processing the copy in place.
+        \param pars Parameter group, from which names of the input and the output event files (evfile, outfile)
+               and the clobber flag (clobber) are taken.
+    */
+    void prepareEventFile(st_app::AppParGroup & pars);
+
+    /** \brief Replace psrdbfile parameter with the name of a snapshot of the pulsar ephemerides database filtered by
+               psrname parameter, if psrdbcache parameter is not NONE (case-insensitive). The snapshot is kept in the
+               directory given by psrdbcache parameter, and is rebuilt if the database file(s) are modified. Nothing
+               is done if psrdbfile parameter is NONE, or if psrname parameter is ANY (case-insensitive). This method
+               must be called before initEphComputer method is called.
+        \param pars Parameter group.
+    */
+    void preparePulsarDb(st_app::AppParGroup & pars);
+
+    /** \brief Restore evfile and psrdbfile parameters to their original values if they were replaced by
+               prepareEventFile and preparePulsarDb methods, respectively. This method must be called before
+               writeParameter method is called.
+        \param pars Parameter group.
+    */
+    void restoreParameter(st_app::AppParGroup & pars) const;
+
+    /** \brief Update data checksums of the event table(s) into which phases were written by the last call to
+               assignPhase method, if the tables have them. This method must be called after writeParameter method,
+               so that the checksums cover the history records written by it.
+    */
+    void updateChecksum() const;
+
+    /** \brief Enable the performance monitor if a performance report is requested by perfreport or perffile
+               parameter, or if chatter parameter is 4 or greater. Times and counts are recorded only if enabled.
+        \param pars Parameter group.
+    */
+    void initPerformanceMonitor(const st_app::AppParGroup & pars);
+
+    /** \brief Set up the incremental mode if incremental parameter is yes. In the incremental mode, a fingerprint of
+               phase computation is computed from the name of this application, the values of the given parameters,
+               and the names, the sizes and the modification times of the pulsar ephemerides database file(s) given by
+               psrdbfile parameter. After phases are computed, assignPhase method records the fingerprint and the
+               number of events in each event table in PPHASEFP and PPHASENR keywords (or OPHASEFP and OPHASENR
+               keywords for orbital phases), and the range of times of events corrected with spacecraft positions and
+               a fingerprint of the rows of the spacecraft file around them in PSCTMIN, PSCTMAX and PSCFP keywords (or
+               OSCTMIN, OSCTMAX and OSCFP keywords). On a later run with the same fingerprint and the same rows of the
+               spacecraft file, phases are computed only for events appended to the table after the recorded number
+               of events.
+        \param pars Parameter group.
+        \param par_name_cont Names of the parameters which affect phase values.
+    */
+    void initIncrementalMode(const st_app::AppParGroup & pars, const std::vector<std::string> & par_name_cont);
+
+    /** \brief Request sums of trigonometric moments of phases of the first type to be accumulated by the following
+               call(s) to assignPhase method, for the Z^2_m and the H-test statistics. Events are weighted by the column
+               given by weightfield parameter unless it is NONE.
+        \param max_harmonic Maximum number of harmonics to accumulate moments for, or 0 for no accumulation.
+    */
+    void initPeriodicityTest(long max_harmonic);
+
+    /** \brief Return the sums of trigonometric moments accumulated by the last call to assignPhase method, or a null
+               pointer if they were not requested by initPeriodicityTest method.
+    */
+    const PeriodicityTest * getPeriodicityTest() const;
+
+    /** \brief Request arrival times and phases of the first type of all events to be kept in memory by the following
+               call(s) to assignPhase method, for a search around the spin ephemeris. The search requires exactly one
+               spin ephemeris, and phases of all events are computed even in incremental mode. Events are weighted by
+               the column given by weightfield parameter unless it is NONE.
+        \param search_requested Flag to request the arrival times and the phases to be kept.
+    */
+    void initEphemerisSearch(bool search_requested);
+
+    /** \brief Return the arrival times and the phases kept by the last call to assignPhase method, or a null pointer
+               if they were not requested by initEphemerisSearch method.
+    */
+    const EphemerisSearch * getEphemerisSearch() const;
+
+    /// \brief Return the performance monitor, in which times spent in stages of processing are recorded.
+    PerformanceMonitor & getPerformanceMonitor();
+
+    /** \brief Report times spent in stages of processing and counts of events and ephemeris searches, if the
+               performance monitor is enabled. The report is also written to a file in JSON format, if perffile
+               parameter is not NONE (case-insensitive).
+        \param pars Parameter group.
+        \param chooser Ephemeris chooser, whose counts of ephemeris choices and searches are to be reported.
+        \param os Output stream to report to.
+    */
+    void reportPerformance(const st_app::AppParGroup & pars, const CachedEphChooser & chooser, st_stream::OStream & os);
+
+    /** \brief Compute a phase for each event and write it into the given output field, one block of events at a time.
+               Event times of a block of events are read into a contiguous array first, then phases are computed for
+               all the events in the block, and finally the phase values are written into the event file(s) at once.
+               Polynomials of pulse phases in a block are evaluated in parallel by as many threads as requested by
+               nthreads parameter, with no effect on the computed phase values. The other phases are computed by the
+               EphComputer object in one thread, because the pulsarDb and timeSystem libraries are not reentrant.
+               Unless pdot cancellation is applied, arrival time corrections are applied by this class to event times
+               read a block at a time, with barycentric delays interpolated over the spacecraft orbit to an accuracy of
+               barytol seconds if barytol parameter is positive, or computed exactly for each event otherwise. In that
+               case, event times are held in PhaseTime objects from the event file to the phase computation, and are
+               converted to AbsoluteTime only where they are passed to the EphComputer object. Also in that case,
+               multiple event files are processed concurrently by as many threads as requested by filethreads
+               parameter, each with its own copies of the EphComputer object and the ephemeris chooser, and its own
+               file handles, while calls to the libraries are made by one event file at a time. If pdot cancellation
+               is applied, event times are read one at a time with all corrections applied by the base class.
+               If nbins parameter is positive, a histogram of the phases of the first type is accumulated while phases
+               are assigned, weighted by the column given by weightfield parameter unless it is NONE, and written into
+               the file given by profile parameter. Events whose phases are up to date in incremental mode are added to
+               the histogram with the phases already in the event file(s). Sums for periodicity tests are accumulated
+               in the same way if requested by initPeriodicityTest method.
+        \param pars Parameter group, from which names of the event file(s) and the event table, the number of events
+               in a block (blocksize), the number of threads (nthreads), the tolerance of barycentric delays
+               (barytol), the number of event files to process concurrently (filethreads), and the settings of the
+               phase histogram (nbins, profile, weightfield) are taken.
+        \param chooser Ephemeris chooser to be used by the copies of the EphComputer object for event files.
+        \param phase_type Type of phase to compute.
+        \param phase_field Name of the output field.
+        \param phase_offset Global phase offset to add to all phases.
+    */
+    void assignPhase(const st_app::AppParGroup & pars, const pulsarDb::EphChooser & chooser, PhaseType_e phase_type,
+      const std::string & phase_field, double phase_offset);
+
+    /** \brief Compute phases of one or more types for each event and write them into their output fields, in one
+               pass over the events. Event times are read and corrected only once, and all types of phases are
+               computed from the same corrected event times. See the other assignPhase method for details.
+        \param pars Parameter group.
+        \param chooser Ephemeris chooser to be used by the copies of the EphComputer object for event files.
+        \param phase_spec_cont Types of phases to compute, with their output fields and global phase offsets.
+    */
+    void assignPhase(const st_app::AppParGroup & pars, const pulsarDb::EphChooser & chooser,
+      const PhaseSpecCont & phase_spec_cont);
+
+    /** \brief Compute phases of one or more types for each event, and pulse phases of each of the given pulsars, and
+               write them into their output fields, in one pass over the events. Event times are read only once, and
+               the spacecraft file is opened only once per event file, with barycentric delays tabulated separately for
+               the position of each pulsar. Ephemerides of each pulsar are selected by its name from the pulsar
+               ephemerides database file(s) given by psrdbfile parameter, or from their snapshot in the directory given
+               by psrdbcache parameter unless it is NONE, and binary demodulation is applied to its event times if its
+               orbital ephemerides are available, as allowed by the time correction mode. Phase summaries, the cache
+               column of arrival times, and the incremental mode apply to phases given by phase_spec_cont, which are
+               computed as by the other assignPhase methods. The given pulsars cannot be combined with pdot
+               cancellation.
+        \param pars Parameter group.
+        \param chooser Ephemeris chooser to be used by the EphComputer objects.
+        \param phase_spec_cont Types of phases to compute, with their output fields and global phase offsets.
+        \param pulsar_spec_cont Additional pulsars, with their output fields of pulse phases.
+    */
+    void assignPhase(const st_app::AppParGroup & pars, const pulsarDb::EphChooser & chooser,
+      const PhaseSpecCont & phase_spec_cont, const PulsarSpecCont & pulsar_spec_cont);
+
+    /** \brief Read a list of pulsars from the given text file. Each line of the file consists of the name of the output
+               field of pulse phases, followed by the name of the pulsar, which may contain spaces. Blank lines and
+               lines starting with "#" are ignored.
+        \param list_file Name of the list file.
+        \param pulsar_spec_cont Pulsars read from the file, appended by this method.
+    */
+    void readPulsarList(const std::string & list_file, PulsarSpecCont & pulsar_spec_cont) const;
+
+  private:
+    std::string m_event_file_name;
+    std::string m_psrdb_file_name;
+    std::vector<std::string> m_phased_file_cont;
+    std::string m_phased_table_name;
+    PerformanceMonitor m_monitor;
+    std::string m_fingerprint;
+    long m_max_harmonic;
+    std::unique_ptr<PeriodicityTest> m_periodicity_test;
+    bool m_search_requested;
+    std::unique_ptr<EphemerisSearch> m_ephemeris_search;
+};
+
+#endif
@@ -0,0 +1,54 @@
+/** \file PhaseUtil.h
+    \brief Declaration of helper functions and constants shared by classes of this package, not a part of its interface.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PhaseUtil_h
+#define pulsePhase_PhaseUtil_h
+
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace pulsePhaseUtil {
+
+  /// \brief Initial value of a 64-bit FNV-1a hash.
+  const std::uint64_t s_fnv_offset_basis = 14695981039346656037ULL;
+
+  /// \brief Factor to convert an angle in degrees into radians.
+  const double s_deg_to_rad = std::atan(1.) / 45.;
+
+  /** \brief Update a 64-bit FNV-1a hash with the given bytes.
+      \param begin Pointer to the first byte.
+      \param end Pointer to one past the last byte.
+      \param hash Hash value to update.
+  */
+  inline void updateHash(const char * begin, const char * end, std::uint64_t & hash) {
+    for (const char * itor = begin; itor != end; ++itor) {
+      hash ^= static_cast<unsigned char>(*itor);
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  /** \brief Update a 64-bit FNV-1a hash with the given string, followed by a null character as a separator.
+      \param str String to hash.
+      \param hash Hash value to update.
+  */
+  inline void updateHash(const std::string & str, std::uint64_t & hash) {
+    updateHash(str.c_str(), str.c_str() + str.size() + 1, hash);
+  }
+
+  /** \brief Return a hexadecimal representation of the given hash value, 16 digits long.
+      \param hash Hash value.
+  */
+  inline std::string toHex(std::uint64_t hash) {
+    std::ostringstream os;
+    os << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return os.str();
+  }
+
+}
+
+#endif
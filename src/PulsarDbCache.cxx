@@ -0,0 +1,116 @@
+/** \file PulsarDbCache.cxx
+    \brief Implementation of PulsarDbCache class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "PulsarDbCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PhaseUtil.h"
+
+#include "pulsarDb/PulsarDb.h"
+
+#include "st_facilities/Env.h"
+#include "st_facilities/FileSys.h"
+
+PulsarDbCache::PulsarDbCache(const std::string & cache_dir): m_cache_dir(cache_dir) {}
+
+std::string PulsarDbCache::getSnapshot(const std::string & psrdb_file, const std::string & psr_name) const {
+  // Identify the snapshot by the pulsar name and the names of the database files, and its version by their contents.
+  FileNameCont file_name_cont(st_facilities::FileSys::expandFileList(psrdb_file));
+  std::uint64_t name_hash = pulsePhaseUtil::s_fnv_offset_basis;
+  std::uint64_t content_hash = pulsePhaseUtil::s_fnv_offset_basis;
+  pulsePhaseUtil::updateHash(psr_name, name_hash);
+  for (FileNameCont::const_iterator itor = file_name_cont.begin(); itor != file_name_cont.end(); ++itor) {
+    pulsePhaseUtil::updateHash(*itor, name_hash);
+    std::string file_hash(pulsePhaseUtil::toHex(hashFile(*itor)));
+    pulsePhaseUtil::updateHash(file_hash, content_hash);
+  }
+  std::string prefix("psrdb_" + pulsePhaseUtil::toHex(name_hash) + "_");
+  std::string snapshot_file(m_cache_dir + "/" + prefix + pulsePhaseUtil::toHex(content_hash) + ".fits");
+
+  // Create the snapshot unless it exists already, replacing old snapshots of the same pulsar.
+  if (0 != access(snapshot_file.c_str(), R_OK)) {
+    createSnapshot(file_name_cont, psr_name, snapshot_file);
+    removeStaleSnapshot(prefix, snapshot_file);
+  }
+  return snapshot_file;
+}
+
+std::uint64_t PulsarDbCache::hashFile(const std::string & file_name) const {
+  struct stat file_status;
+  if (0 != stat(file_name.c_str(), &file_status)) {
+    throw std::runtime_error("Cannot find pulsar ephemerides database file \"" + file_name + "\"");
+  }
+
+  // Hash the size and the modification time, followed by the contents.
+  std::uint64_t hash = pulsePhaseUtil::s_fnv_offset_basis;
+  std::ostringstream os;
+  os << file_status.st_size << " " << file_status.st_mtime;
+  pulsePhaseUtil::updateHash(os.str(), hash);
+  std::ifstream ifs(file_name.c_str(), std::ios::binary);
+  if (!ifs) throw std::runtime_error("Cannot open pulsar ephemerides database file \"" + file_name + "\"");
+  std::vector<char> buffer(65536);
+  while (ifs.read(&buffer[0], buffer.size()) || ifs.gcount() > 0) {
+    pulsePhaseUtil::updateHash(&buffer[0], &buffer[0] + ifs.gcount(), hash);
+  }
+  return hash;
+}
+
+void PulsarDbCache::createSnapshot(const FileNameCont & file_name_cont, const std::string & psr_name,
+  const std::string & snapshot_file) const {
+  // Create a temporary file in the cache directory, so that it can be renamed to the snapshot file.
+  std::string file_template(snapshot_file + ".XXXXXX");
+  std::vector<char> temp_file_name(file_template.begin(), file_template.end());
+  temp_file_name.push_back('\0');
+  int file_descriptor = mkstemp(&temp_file_name[0]);
+  if (-1 == file_descriptor) {
+    throw std::runtime_error("Cannot create a file in pulsar ephemerides cache directory \"" + m_cache_dir + "\"");
+  }
+  close(file_descriptor);
+  std::string temp_file(&temp_file_name[0]);
+
+  // Load the database file(s), select ephemerides of the pulsar, and save them in the temporary file.
+  try {
+    std::string tpl_file = st_facilities::Env::appendFileName(st_facilities::Env::getDataDir("pulsarDb"), "PulsarDb.tpl");
+    pulsarDb::PulsarDb data_base(tpl_file);
+    for (FileNameCont::const_iterator itor = file_name_cont.begin(); itor != file_name_cont.end(); ++itor) {
+      data_base.load(*itor);
+    }
+    data_base.filterName(psr_name);
+    data_base.save(temp_file, "pulsePhase", "", true);
+  } catch (...) {
+    std::remove(temp_file.c_str());
+    throw;
+  }
+
+  // Replace the snapshot file, making it readable by others sharing the cache directory.
+  chmod(temp_file.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (0 != std::rename(temp_file.c_str(), snapshot_file.c_str())) {
+    std::remove(temp_file.c_str());
+    throw std::runtime_error("Cannot create pulsar ephemerides snapshot file \"" + snapshot_file + "\"");
+  }
+}
+
+void PulsarDbCache::removeStaleSnapshot(const std::string & prefix, const std::string & snapshot_file) const {
+  DIR * dir = opendir(m_cache_dir.c_str());
+  if (0 == dir) return;
+  for (struct dirent * entry = readdir(dir); 0 != entry; entry = readdir(dir)) {
+    std::string file_name(entry->d_name);
+    std::string path_name(m_cache_dir + "/" + file_name);
+    if (0 == file_name.compare(0, prefix.size(), prefix) && path_name != snapshot_file &&
+      file_name.size() > 5 && 0 == file_name.compare(file_name.size() - 5, 5, ".fits")) {
+      std::remove(path_name.c_str());
+    }
+  }
+  closedir(dir);
+}
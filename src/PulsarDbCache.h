@@ -0,0 +1,61 @@
+/** \file PulsarDbCache.h
+    \brief Declaration of PulsarDbCache class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_PulsarDbCache_h
+#define pulsePhase_PulsarDbCache_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** \class PulsarDbCache
+    \brief Cache of snapshots of pulsar ephemerides databases, each filtered by a pulsar name. A snapshot is a FITS
+           database file that contains only the ephemerides of one pulsar, so that it loads much faster than the whole
+           database. Snapshots are kept in a cache directory under names derived from the pulsar name, the names of the
+           database files, and the sizes, the modification times and the contents of the database files, so that a
+           snapshot is rebuilt automatically if any of the database files is modified.
+*/
+class PulsarDbCache {
+  public:
+    typedef std::vector<std::string> FileNameCont;
+
+    /** \brief Construct a PulsarDbCache object.
+        \param cache_dir Name of the directory to keep snapshots in.
+    */
+    explicit PulsarDbCache(const std::string & cache_dir);
+
+    /** \brief Return the name of the snapshot of the given database file(s) filtered by the given pulsar name,
+               creating the snapshot if it does not exist or is out of date.
+        \param psrdb_file Name of the database file, or the name of a list file preceded by "@".
+        \param psr_name Name of the pulsar to select ephemerides for.
+    */
+    std::string getSnapshot(const std::string & psrdb_file, const std::string & psr_name) const;
+
+  private:
+    std::string m_cache_dir;
+
+    /** \brief Return the hash value of the given file, computed from its size, its modification time, and its contents.
+        \param file_name Name of the file.
+    */
+    std::uint64_t hashFile(const std::string & file_name) const;
+
+    /** \brief Create a snapshot of the given database file(s) filtered by the given pulsar name, replacing any
+               existing snapshot atomically so that other processes never read an incomplete snapshot.
+        \param file_name_cont Names of the database files.
+        \param psr_name Name of the pulsar to select ephemerides for.
+        \param snapshot_file Name of the snapshot file to create.
+    */
+    void createSnapshot(const FileNameCont & file_name_cont, const std::string & psr_name,
+      const std::string & snapshot_file) const;
+
+    /** \brief Remove snapshots whose names start with the given prefix, except for the given snapshot. They are
+               snapshots of the same pulsar and the same database files that are out of date.
+        \param prefix Prefix of the names of the snapshot files to remove.
+        \param snapshot_file Name of the snapshot file to keep.
+    */
+    void removeStaleSnapshot(const std::string & prefix, const std::string & snapshot_file) const;
+};
+
+#endif
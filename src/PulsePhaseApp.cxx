@@ -8,10 +8,14 @@
 #include <cctype>
 #include <cmath>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <vector>
+
+#include "CachedEphChooser.h"
 
 #include "pulsarDb/EphChooser.h"
 #include "pulsarDb/EphComputer.h"
@@ -27,7 +31,18 @@
 
 const std::string s_cvs_id("$Name: v8r5 $");
 
-PulsePhaseApp::PulsePhaseApp(): pulsarDb::PulsarToolApp(), m_os("PulsePhaseApp", "", 2) {
+/// \brief Number of harmonics over which the H-test statistic is maximized.
+const long s_max_harmonic = 20;
+
+const PulsePhaseApp::TimeCorrectionMode PulsePhaseApp::s_tcmode_cont[] = {
+  { "NONE", SUPPRESSED, SUPPRESSED, SUPPRESSED },
+  { "AUTO", ALLOWED,    ALLOWED,    SUPPRESSED },
+  { "BARY", REQUIRED,   SUPPRESSED, SUPPRESSED },
+  { "BIN",  REQUIRED,   REQUIRED,   SUPPRESSED },
+  { "ALL",  REQUIRED,   REQUIRED,   SUPPRESSED }
+};
+
+PulsePhaseApp::PulsePhaseApp(): PhaseToolApp(), m_os("PulsePhaseApp", "", 2) {
   setName("gtpphase");
   setVersion(s_cvs_id);
 
@@ -64,6 +79,7 @@ void PulsePhaseApp::runApp() {
   par_group.Prompt("evfile");
   par_group.Prompt("evtable");
   par_group.Prompt("timefield");
+  par_group.Prompt("outfile");
   par_group.Prompt("scfile");
   par_group.Prompt("sctable");
   par_group.Prompt("psrdbfile");
@@ -104,6 +120,32 @@ void PulsePhaseApp::runApp() {
   par_group.Prompt("angtol");
   par_group.Prompt("pphasefield");
   par_group.Prompt("pphaseoffset");
+  par_group.Prompt("ophasefield");
+  par_group.Prompt("ophaseoffset");
+  par_group.Prompt("blocksize");
+  par_group.Prompt("nthreads");
+  par_group.Prompt("barytol");
+  par_group.Prompt("filethreads");
+  par_group.Prompt("perfreport");
+  par_group.Prompt("perffile");
+  par_group.Prompt("incremental");
+  par_group.Prompt("psrdbcache");
+  par_group.Prompt("timeorder");
+  par_group.Prompt("barycol");
+  par_group.Prompt("psrlist");
+  par_group.Prompt("roiradius");
+  par_group.Prompt("scwindow");
+  par_group.Prompt("scindex");
+  par_group.Prompt("nbins");
+  par_group.Prompt("profile");
+  par_group.Prompt("weightfield");
+  par_group.Prompt("htest");
+  par_group.Prompt("zharmonics");
+  par_group.Prompt("searchfile");
+  par_group.Prompt("nf0");
+  par_group.Prompt("df0");
+  par_group.Prompt("nf1");
+  par_group.Prompt("df1");
   par_group.Prompt("leapsecfile");
   par_group.Prompt("reportephstatus");
   par_group.Prompt("chatter");
@@ -115,29 +157,50 @@ void PulsePhaseApp::runApp() {
   // Save the values of the parameters.
   par_group.Save();
 
-  // Open the event file(s).
-  openEventFile(par_group, false);
+  // Record times spent in stages of processing, if requested.
+  initPerformanceMonitor(par_group);
+  PerformanceMonitor & monitor(getPerformanceMonitor());
+
+  // Fingerprint the parameters which affect phase values, to skip events whose phases are up to date, if requested.
+  std::vector<std::string> par_name_cont = { "evtable", "timefield", "sctable", "psrname", "ephstyle", "ephepoch",
+    "timeformat", "timesys", "ra", "dec", "phi0", "f0", "f1", "f2", "p0", "p1", "p2", "tcorrect", "solareph", "matchsolareph",
+    "angtol", "pphasefield", "pphaseoffset", "ophasefield", "ophaseoffset", "barytol", "roiradius", "scwindow",
+    "leapsecfile" };
+  initIncrementalMode(par_group, par_name_cont);
+
+  // Copy the input event file into the output file, if requested, and open the event file(s).
+  {
+    PerformanceMonitor::Stage stage(monitor, "openEventFile");
+    prepareEventFile(par_group);
+    openEventFile(par_group, false);
+  }
 
   // Handle leap seconds.
   std::string leap_sec_file = par_group["leapsecfile"];
   timeSystem::TimeSystem::setDefaultLeapSecFileName(leap_sec_file);
 
   // Setup time correction mode.
-  defineTimeCorrectionMode("NONE", SUPPRESSED, SUPPRESSED, SUPPRESSED);
-  defineTimeCorrectionMode("AUTO", ALLOWED,    ALLOWED,    SUPPRESSED);
-  defineTimeCorrectionMode("BARY", REQUIRED,   SUPPRESSED, SUPPRESSED);
-  defineTimeCorrectionMode("BIN",  REQUIRED,   REQUIRED,   SUPPRESSED);
-  defineTimeCorrectionMode("ALL",  REQUIRED,   REQUIRED,   SUPPRESSED);
+  for (const TimeCorrectionMode * itor = std::begin(s_tcmode_cont); itor != std::end(s_tcmode_cont); ++itor) {
+    defineTimeCorrectionMode(itor->m_name, itor->m_bary, itor->m_bin, itor->m_pdot);
+  }
   selectTimeCorrectionMode(par_group);
+  TimeCorrectionSetting tcmode(readTimeCorrectionSetting(par_group));
 
-  // Set up EphComputer for arrival time corrections.
-  pulsarDb::StrictEphChooser chooser;
-  initEphComputer(par_group, chooser, m_os.info(4));
+  // Set up EphComputer for arrival time corrections, with an ephemeris chooser that saves a search for an ephemeris
+  // while event times stay in the same segment of ephemeris validity.
+  CachedEphChooser chooser((pulsarDb::StrictEphChooser()));
+  {
+    PerformanceMonitor::Stage stage(monitor, "initEphComputer");
+    preparePulsarDb(par_group);
+    initEphComputer(par_group, chooser, m_os.info(4));
+  }
 
   // Use user input (parameters) together with computer to determine corrections to apply.
-  bool vary_ra_dec = true;
   bool guess_pdot = false;
-  initTimeCorrection(par_group, vary_ra_dec, guess_pdot, m_os.info(3), "START");
+  {
+    PerformanceMonitor::Stage stage(monitor, "initTimeCorrection");
+    initTimeCorrection(par_group, tcmode.m_vary_ra_dec, guess_pdot, m_os.info(3), "START");
+  }
 
   // Report ephemeris status.
   std::set<pulsarDb::EphStatusCodeType> code_to_report;
@@ -145,31 +208,126 @@ void PulsePhaseApp::runApp() {
   code_to_report.insert(pulsarDb::Remarked);
   reportEphStatus(m_os.warn(), code_to_report);
 
-  // Reserve output column for creation if not existing in the event file(s).
+  // Read output column name and global phase offset.
   std::string phase_field = par_group["pphasefield"];
-  reserveOutputField(phase_field, "1D");
+  double phase_offset = par_group["pphaseoffset"];
+  PhaseSpec pulse_phase_spec = { PULSE_PHASE, phase_field, phase_offset };
+  PhaseSpecCont phase_spec_cont(1, pulse_phase_spec);
 
-  // Get EphComputer for orbital phase computation.
-  pulsarDb::EphComputer & computer(getEphComputer());
+  // Add orbital phases to compute along with pulse phases, if requested.
+  std::string orbital_phase_field = par_group["ophasefield"];
+  double orbital_phase_offset = par_group["ophaseoffset"];
+  std::string orbital_phase_field_uc(orbital_phase_field);
+  for (std::string::iterator itor = orbital_phase_field_uc.begin(); itor != orbital_phase_field_uc.end(); ++itor) *itor = toupper(*itor);
+  if ("NONE" != orbital_phase_field_uc) {
+    PhaseSpec orbital_phase_spec = { ORBITAL_PHASE, orbital_phase_field, orbital_phase_offset };
+    phase_spec_cont.push_back(orbital_phase_spec);
+  }
 
-  // Read global phase offset.
-  double phase_offset = par_group["pphaseoffset"];
+  // Accumulate sums for the H-test and the Z^2_m statistics along with the phases, if requested.
+  bool htest = par_group["htest"];
+  long z2_harmonic = par_group["zharmonics"];
+  if (htest) {
+    if (z2_harmonic <= 0 || z2_harmonic > s_max_harmonic) {
+      throw std::runtime_error("Number of harmonics of Z^2_m statistic must be between 1 and 20");
+    }
+    initPeriodicityTest(s_max_harmonic);
+  }
 
-  // Iterate over events.
-  for (setFirstEvent(); !isEndOfEventList(); setNextEvent()) {
-    // Get event time as AbsoluteTime.
-    timeSystem::AbsoluteTime abs_evt_time(getEventTime());
+  // Keep arrival times and pulse phases of all events in memory for an ephemeris search, if requested.
+  std::string search_file = par_group["searchfile"];
+  std::string search_file_uc(search_file);
+  for (std::string::iterator itor = search_file_uc.begin(); itor != search_file_uc.end(); ++itor) *itor = toupper(*itor);
+  bool search = ("NONE" != search_file_uc);
+  if (search && (z2_harmonic <= 0 || z2_harmonic > s_max_harmonic)) {
+    throw std::runtime_error("Number of harmonics of Z^2_m statistic must be between 1 and 20");
+  }
+  initEphemerisSearch(search);
 
-    // Compute phase.
-    double phase = computer.calcPulsePhase(abs_evt_time, phase_offset);
+  // Read the list of additional pulsars whose pulse phases are computed in the same pass, if requested.
+  std::string psr_list = par_group["psrlist"];
+  std::string psr_list_uc(psr_list);
+  for (std::string::iterator itor = psr_list_uc.begin(); itor != psr_list_uc.end(); ++itor) *itor = toupper(*itor);
+  PulsarSpecCont pulsar_spec_cont;
+  if ("NONE" != psr_list_uc) readPulsarList(psr_list, pulsar_spec_cont);
 
-    // Write phase into output column.
-    setFieldValue(phase_field, phase);
+  // Compute phases and write them into the event file(s).
+  {
+    PerformanceMonitor::Stage stage(monitor, "assignPhase");
+    assignPhase(par_group, chooser, phase_spec_cont, pulsar_spec_cont);
   }
 
   // Write parameter values to the event file(s).
   std::string creator_name = getName() + " " + getVersion();
   std::string file_modification_time(createUtcTimeString());
   std::string header_line("File modified by " + creator_name + " on " + file_modification_time);
-  writeParameter(par_group, header_line);
+  {
+    PerformanceMonitor::Stage stage(monitor, "writeParameter");
+    restoreParameter(par_group);
+    writeParameter(par_group, header_line);
+    updateChecksum();
+  }
+
+  // Report the H-test and the Z^2_m statistics, if requested.
+  const PeriodicityTest * periodicity_test = getPeriodicityTest();
+  if (periodicity_test) {
+    long h_harmonic = 0;
+    double h = periodicity_test->computeH(h_harmonic);
+    double h_log_prob = PeriodicityTest::computeHLogProbability(h);
+    double z2 = periodicity_test->computeZ2(z2_harmonic);
+    double z2_log_prob = PeriodicityTest::computeZ2LogProbability(z2, z2_harmonic);
+    st_stream::OStream & os(m_os.info(1));
+    os << "Number of events in periodicity tests: " << periodicity_test->getNumEvent() << std::endl;
+    os << "H-test statistic: " << h << " (" << h_harmonic << " harmonics), chance probability: " <<
+      std::exp(h_log_prob) << " (" << PeriodicityTest::computeSigma(h_log_prob) << " sigma)" << std::endl;
+    os << "Z^2_" << z2_harmonic << " statistic: " << z2 << ", chance probability: " << std::exp(z2_log_prob) << " (" <<
+      PeriodicityTest::computeSigma(z2_log_prob) << " sigma)" << std::endl;
+  }
+
+  // Search for the frequency and its derivative around the ephemeris, reusing the arrival times of events, and report
+  // the trial with the largest H-test statistic.
+  const EphemerisSearch * ephemeris_search = getEphemerisSearch();
+  if (ephemeris_search) {
+    long num_f0 = par_group["nf0"];
+    double f0_step = par_group["df0"];
+    long num_f1 = par_group["nf1"];
+    double f1_step = par_group["df1"];
+    long num_thread = par_group["nthreads"];
+    bool clobber = par_group["clobber"];
+    EphemerisSearch::TrialCont trial_cont;
+    {
+      PerformanceMonitor::Stage stage(monitor, "ephemerisSearch");
+      ephemeris_search->search(num_f0, f0_step, num_f1, f1_step, z2_harmonic, num_thread, trial_cont);
+      EphemerisSearch::write(search_file, trial_cont, z2_harmonic, clobber);
+    }
+    monitor.addCount("ephemeris search trials", trial_cont.size());
+    EphemerisSearch::TrialCont::const_iterator best_itor = trial_cont.begin();
+    for (EphemerisSearch::TrialCont::const_iterator itor = trial_cont.begin(); itor != trial_cont.end(); ++itor) {
+      if (itor->m_h > best_itor->m_h) best_itor = itor;
+    }
+    st_stream::OStream & os(m_os.info(1));
+    os << "Number of events in ephemeris search: " << ephemeris_search->getNumEvent() << std::endl;
+    if (best_itor != trial_cont.end()) {
+      os << "Largest H-test statistic in ephemeris search: " << best_itor->m_h << " (" << best_itor->m_h_harmonic <<
+        " harmonics) at frequency offset " << best_itor->m_f0_offset << " Hz and frequency derivative offset " <<
+        best_itor->m_f1_offset << " Hz/s, " << trial_cont.size() << " trials" << std::endl;
+    }
+  }
+
+  // Report times spent in stages of processing, if requested.
+  reportPerformance(par_group, chooser, m_os.info(2));
+}
+
+PhaseToolApp::TimeCorrectionSetting PulsePhaseApp::readTimeCorrectionSetting(const st_app::AppParGroup & pars) const {
+  std::string mode_name = pars["tcorrect"];
+  std::string mode_name_uc(mode_name);
+  for (std::string::iterator itor = mode_name_uc.begin(); itor != mode_name_uc.end(); ++itor) *itor = std::toupper(*itor);
+  for (const TimeCorrectionMode * itor = std::begin(s_tcmode_cont); itor != std::end(s_tcmode_cont); ++itor) {
+    if (mode_name_uc == itor->m_name) {
+      // Source positions are always taken from the spin ephemerides.
+      TimeCorrectionSetting setting = { itor->m_bary, itor->m_bin, itor->m_pdot, true };
+      return setting;
+    }
+  }
+  throw std::runtime_error("Unknown time correction mode \"" + mode_name + "\"");
 }
@@ -6,14 +6,14 @@
 #ifndef pulsePhase_PulsePhaseApp_h
 #define pulsePhase_PulsePhaseApp_h
 
-#include "pulsarDb/PulsarToolApp.h"
+#include "PhaseToolApp.h"
 
 #include "st_stream/StreamFormatter.h"
 
 /** \class PulsePhaseApp
     \brief Main application class for pulse phase assignment.
 */
-class PulsePhaseApp : public pulsarDb::PulsarToolApp {
+class PulsePhaseApp : public PhaseToolApp {
   public:
     /// \brief Construct a PulsePhaseApp object.
     PulsePhaseApp();
@@ -24,7 +24,23 @@ class PulsePhaseApp : public pulsarDb::PulsarToolApp {
     /// \brief Run the application.
     virtual void runApp();
 
+  protected:
+    /** \brief Return the setting of arrival time corrections selected by tcorrect parameter.
+        \param pars Parameter group.
+    */
+    virtual TimeCorrectionSetting readTimeCorrectionSetting(const st_app::AppParGroup & pars) const;
+
   private:
+    /// \brief Time correction mode which can be selected by tcorrect parameter.
+    struct TimeCorrectionMode {
+      const char * m_name;
+      TimeCorrectionMode_e m_bary;
+      TimeCorrectionMode_e m_bin;
+      TimeCorrectionMode_e m_pdot;
+    };
+
+    static const TimeCorrectionMode s_tcmode_cont[];
+
     st_stream::StreamFormatter m_os;
 };
 
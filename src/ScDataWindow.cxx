@@ -0,0 +1,348 @@
+/** \file ScDataWindow.cxx
+    \brief Implementation of ScDataWindow class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "ScDataWindow.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PhaseUtil.h"
+
+namespace {
+
+  /// \brief First line of an index file, followed by the signature of the spacecraft file.
+  const std::string s_index_magic("pulsePhase ScDataWindow index 1");
+
+  /** \brief Return the number of windows of spacecraft data. Unless there is only one row, windows start at rows
+             before the last row, so that every window has at least two rows.
+      \param num_row Number of rows in the spacecraft data table.
+      \param window_size Number of rows in a window.
+  */
+  long countWindow(long num_row, long window_size) {
+    return (num_row < 2 ? 1 : (num_row - 2) / window_size + 1);
+  }
+
+  /** \brief Return the index of the last element not greater than the given value in a sorted array, by
+             interpolation search alternating with bisection, so that the number of steps is logarithmic at worst.
+      \param begin Pointer to the first element, which must not be greater than the value.
+      \param size Number of elements.
+      \param value Value to search for.
+  */
+  long searchSorted(const double * begin, long size, double value) {
+    long low = 0;
+    long high = size - 1;
+    if (begin[high] <= value) return high;
+    bool bisect = false;
+    while (high - low > 1) {
+      long middle = low + (high - low) / 2;
+      if (!bisect) {
+        double fraction = (value - begin[low]) / (begin[high] - begin[low]);
+        middle = std::min(std::max(low + long(fraction * (high - low)), low + 1), high - 1);
+      }
+      bisect = !bisect;
+      if (begin[middle] <= value) low = middle;
+      else high = middle;
+    }
+    return low;
+  }
+
+}
+
+ScDataWindow::ScDataWindow(const std::string & sc_file_name, const std::string & sc_table_name, long window_size,
+  const std::string & index_file_name): m_sc_file_name(sc_file_name), m_sc_table_name(sc_table_name),
+  m_window_size(window_size), m_fits_file(0), m_start_column(0), m_stop_column(0), m_position_column(0), m_num_row(0),
+  m_stop_time(0.),
+  m_index_cont(), m_window_index(-1), m_start_cont(), m_position_cont(), m_cursor(0), m_hash_first_row(-1),
+  m_hash_last_row(-1), m_hash(pulsePhaseUtil::s_fnv_offset_basis) {
+  if (m_window_size <= 0) throw std::runtime_error("Number of rows in a window of spacecraft data must be positive");
+
+  // Open the spacecraft data table.
+  int status = 0;
+  std::string table_url = m_sc_file_name + "[" + m_sc_table_name + "]";
+  fits_open_file(&m_fits_file, table_url.c_str(), READONLY, &status);
+  if (0 != status) {
+    m_fits_file = 0;
+    fits_clear_errmsg();
+    throw std::runtime_error("Could not open spacecraft file " + m_sc_file_name + "[" + m_sc_table_name + "]");
+  }
+
+  try {
+    // Look for the columns, and read the stop time of the last row, which is the end of the spacecraft data.
+    LONGLONG num_row = 0;
+    char start_name[] = "START";
+    char stop_name[] = "STOP";
+    char position_name[] = "SC_POSITION";
+    fits_get_colnum(m_fits_file, CASEINSEN, start_name, &m_start_column, &status);
+    fits_get_colnum(m_fits_file, CASEINSEN, stop_name, &m_stop_column, &status);
+    fits_get_colnum(m_fits_file, CASEINSEN, position_name, &m_position_column, &status);
+    fits_get_num_rowsll(m_fits_file, &num_row, &status);
+    checkStatus(status);
+    m_num_row = num_row;
+    if (0 == m_num_row) throw std::runtime_error("Spacecraft file " + m_sc_file_name + " contains no spacecraft data");
+    int any_null = 0;
+    fits_read_col_dbl(m_fits_file, m_stop_column, m_num_row, 1, 1, 0., &m_stop_time, &any_null, &status);
+    checkStatus(status);
+
+    // Load the time index from the index file if it is up to date, or build it otherwise.
+    if (index_file_name.empty() || !loadIndex(index_file_name)) {
+      buildIndex();
+      if (!index_file_name.empty()) saveIndex(index_file_name);
+    }
+  } catch (...) {
+    status = 0;
+    fits_close_file(m_fits_file, &status);
+    fits_clear_errmsg();
+    throw;
+  }
+}
+
+ScDataWindow::~ScDataWindow() {
+  int status = 0;
+  fits_close_file(m_fits_file, &status);
+  fits_clear_errmsg();
+}
+
+void ScDataWindow::computePosition(double elapsed_time, std::vector<double> & sc_position) {
+  locateRow(elapsed_time);
+
+  // Interpolate the position linearly, and scale it to the distance interpolated linearly.
+  const double * start = &m_start_cont[0];
+  sc_position.resize(3);
+  const double * position0 = &m_position_cont[3 * m_cursor];
+  if (1 == m_start_cont.size()) {
+    std::copy(position0, position0 + 3, sc_position.begin());
+    return;
+  }
+  const double * position1 = position0 + 3;
+  double time_span = start[m_cursor + 1] - start[m_cursor];
+  double fraction = (time_span > 0. ? (elapsed_time - start[m_cursor]) / time_span : 0.);
+  double radius0 = 0.;
+  double radius1 = 0.;
+  double radius = 0.;
+  for (int axis = 0; axis < 3; ++axis) {
+    sc_position[axis] = position0[axis] + fraction * (position1[axis] - position0[axis]);
+    radius0 += position0[axis] * position0[axis];
+    radius1 += position1[axis] * position1[axis];
+    radius += sc_position[axis] * sc_position[axis];
+  }
+  radius0 = std::sqrt(radius0);
+  radius1 = std::sqrt(radius1);
+  radius = std::sqrt(radius);
+  if (radius > 0.) {
+    double scale = (radius0 + fraction * (radius1 - radius0)) / radius;
+    for (int axis = 0; axis < 3; ++axis) sc_position[axis] *= scale;
+  }
+}
+
+void ScDataWindow::findRowInterval(double elapsed_time, double & start_time, double & stop_time, double & next_time,
+  std::vector<double> & start_position, std::vector<double> & next_position) {
+  locateRow(elapsed_time);
+
+  // Return the row at or before the time and the next row, except that the interval of the last two rows extends to
+  // the end of the spacecraft data, because positions after the start time of the last row are extrapolated.
+  const double * start = &m_start_cont[0];
+  const double * position0 = &m_position_cont[3 * m_cursor];
+  long num_row = m_start_cont.size();
+  start_time = start[m_cursor];
+  start_position.assign(position0, position0 + 3);
+  if (1 == num_row) {
+    stop_time = m_stop_time;
+    next_time = start_time;
+    next_position = start_position;
+    return;
+  }
+  next_time = start[m_cursor + 1];
+  next_position.assign(position0 + 3, position0 + 6);
+  stop_time = next_time;
+  if (m_window_index + 1 == static_cast<long>(m_index_cont.size()) && m_cursor + 2 == num_row) {
+    stop_time = std::max(next_time, m_stop_time);
+  }
+}
+
+std::string ScDataWindow::computeFingerprint(double start_time, double stop_time) {
+  // Hash the rows from the row at or before the start time through the row after the one at or before the stop time,
+  // continuing the hash of the previous call if it started at the same row and did not go beyond the last row.
+  long first_row = findRow(start_time);
+  long last_row = std::max(first_row, std::min(findRow(stop_time) + 1, m_num_row - 1));
+  if (first_row != m_hash_first_row || last_row < m_hash_last_row) {
+    m_hash_first_row = first_row;
+    m_hash_last_row = first_row - 1;
+    m_hash = pulsePhaseUtil::s_fnv_offset_basis;
+  }
+
+  // Read one window of rows at a time.
+  std::vector<double> start_cont;
+  std::vector<double> stop_cont;
+  std::vector<double> position_cont;
+  for (long row_index = m_hash_last_row + 1; row_index <= last_row; row_index += m_window_size) {
+    long num_row = std::min(m_window_size, last_row + 1 - row_index);
+    start_cont.resize(num_row);
+    stop_cont.resize(num_row);
+    position_cont.resize(3 * num_row);
+    int status = 0;
+    int any_null = 0;
+    fits_read_col_dbl(m_fits_file, m_start_column, row_index + 1, 1, num_row, 0., &start_cont[0], &any_null, &status);
+    fits_read_col_dbl(m_fits_file, m_stop_column, row_index + 1, 1, num_row, 0., &stop_cont[0], &any_null, &status);
+    fits_read_col_dbl(m_fits_file, m_position_column, row_index + 1, 1, 3 * num_row, 0., &position_cont[0], &any_null,
+      &status);
+    checkStatus(status);
+    for (long index = 0; index < num_row; ++index) {
+      const char * start = reinterpret_cast<const char *>(&start_cont[index]);
+      const char * stop = reinterpret_cast<const char *>(&stop_cont[index]);
+      const char * position = reinterpret_cast<const char *>(&position_cont[3 * index]);
+      pulsePhaseUtil::updateHash(start, start + sizeof(double), m_hash);
+      pulsePhaseUtil::updateHash(stop, stop + sizeof(double), m_hash);
+      pulsePhaseUtil::updateHash(position, position + 3 * sizeof(double), m_hash);
+    }
+    m_hash_last_row = row_index + num_row - 1;
+  }
+  return pulsePhaseUtil::toHex(m_hash);
+}
+
+void ScDataWindow::locateRow(double elapsed_time) {
+  if (!(elapsed_time >= m_index_cont.front() && elapsed_time <= m_stop_time)) {
+    std::ostringstream os;
+    os.precision(std::numeric_limits<double>::digits10);
+    os << "Could not get spacecraft position for mission elapsed time " << elapsed_time <<
+      " outside the spacecraft data in " << m_sc_file_name;
+    throw std::runtime_error(os.str());
+  }
+
+  // Load the window containing the time unless it is loaded already. A window overlaps with the next window by
+  // one row, so that the time between the last row of a window and the first row of the next falls in it.
+  long num_window = m_index_cont.size();
+  if (m_window_index < 0 || elapsed_time < m_start_cont.front() ||
+    (elapsed_time > m_start_cont.back() && m_window_index + 1 < num_window)) {
+    loadWindow(searchSorted(&m_index_cont[0], num_window, elapsed_time));
+  }
+
+  // Find the row at or before the time, advancing the cursor by up to one row for sorted times, or searching the
+  // window otherwise. The time after the start time of the last row is extrapolated from the last two rows.
+  const double * start = &m_start_cont[0];
+  long num_row = m_start_cont.size();
+  long last_row = std::max(num_row - 2, 0L);
+  if (start[m_cursor] <= elapsed_time && (m_cursor == last_row || elapsed_time < start[m_cursor + 1])) {
+    // Stay at the row of the previous time.
+  } else if (m_cursor < last_row && start[m_cursor + 1] <= elapsed_time &&
+    (m_cursor + 1 == last_row || elapsed_time < start[m_cursor + 2])) {
+    ++m_cursor;
+  } else {
+    m_cursor = std::min(searchSorted(start, num_row, elapsed_time), last_row);
+  }
+}
+
+long ScDataWindow::findRow(double elapsed_time) {
+  if (!(elapsed_time >= m_index_cont.front())) return 0;
+  if (elapsed_time > m_stop_time) return m_num_row - 1;
+  locateRow(elapsed_time);
+  return m_window_index * m_window_size + m_cursor;
+}
+
+std::string ScDataWindow::getSignature() const {
+  // Identify the spacecraft file by its name, its size and its modification time, and the time index by the table
+  // and the number of rows in a window.
+  struct stat file_status;
+  if (0 != stat(m_sc_file_name.c_str(), &file_status)) return std::string();
+  std::ostringstream os;
+  os << m_sc_file_name << " " << file_status.st_size << " " << file_status.st_mtime << " " << m_sc_table_name << " " <<
+    m_num_row << " " << m_window_size;
+  return os.str();
+}
+
+void ScDataWindow::buildIndex() {
+  // Read the start time of the first row of each window.
+  long num_window = countWindow(m_num_row, m_window_size);
+  m_index_cont.resize(num_window);
+  int status = 0;
+  int any_null = 0;
+  for (long window_index = 0; window_index < num_window; ++window_index) {
+    LONGLONG first_row = LONGLONG(window_index) * m_window_size + 1;
+    fits_read_col_dbl(m_fits_file, m_start_column, first_row, 1, 1, 0., &m_index_cont[window_index], &any_null, &status);
+  }
+  checkStatus(status);
+}
+
+bool ScDataWindow::loadIndex(const std::string & index_file_name) {
+  std::string signature(getSignature());
+  if (signature.empty()) return false;
+  std::ifstream ifs(index_file_name.c_str(), std::ios::binary);
+  std::string magic;
+  std::string file_signature;
+  if (!std::getline(ifs, magic) || magic != s_index_magic) return false;
+  if (!std::getline(ifs, file_signature) || file_signature != signature) return false;
+
+  // Read the start times, which must fill the rest of the file exactly.
+  long num_window = countWindow(m_num_row, m_window_size);
+  std::vector<double> index_cont(num_window);
+  if (!ifs.read(reinterpret_cast<char *>(&index_cont[0]), num_window * sizeof(double))) return false;
+  if (ifs.peek() != std::ifstream::traits_type::eof()) return false;
+  m_index_cont.swap(index_cont);
+  return true;
+}
+
+void ScDataWindow::saveIndex(const std::string & index_file_name) const {
+  std::string signature(getSignature());
+  if (signature.empty()) return;
+
+  // Write the index into a temporary file in the same directory, so that it can be renamed to the index file.
+  std::string file_template(index_file_name + ".XXXXXX");
+  std::vector<char> temp_file_name(file_template.begin(), file_template.end());
+  temp_file_name.push_back('\0');
+  int file_descriptor = mkstemp(&temp_file_name[0]);
+  if (-1 == file_descriptor) {
+    throw std::runtime_error("Cannot create spacecraft data index file \"" + index_file_name + "\"");
+  }
+  close(file_descriptor);
+  std::string temp_file(&temp_file_name[0]);
+  {
+    std::ofstream ofs(temp_file.c_str(), std::ios::binary | std::ios::trunc);
+    ofs << s_index_magic << "\n" << signature << "\n";
+    ofs.write(reinterpret_cast<const char *>(&m_index_cont[0]), m_index_cont.size() * sizeof(double));
+    ofs.close();
+    if (!ofs) {
+      std::remove(temp_file.c_str());
+      throw std::runtime_error("Cannot write spacecraft data index file \"" + index_file_name + "\"");
+    }
+  }
+
+  // Replace the index file, making it readable by others sharing the spacecraft file.
+  chmod(temp_file.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (0 != std::rename(temp_file.c_str(), index_file_name.c_str())) {
+    std::remove(temp_file.c_str());
+    throw std::runtime_error("Cannot create spacecraft data index file \"" + index_file_name + "\"");
+  }
+}
+
+void ScDataWindow::loadWindow(long window_index) {
+  long first_row = window_index * m_window_size;
+  long num_row = std::min(m_window_size + 1, m_num_row - first_row);
+  m_window_index = -1;
+  m_start_cont.resize(num_row);
+  m_position_cont.resize(3 * num_row);
+  int status = 0;
+  int any_null = 0;
+  fits_read_col_dbl(m_fits_file, m_start_column, first_row + 1, 1, num_row, 0., &m_start_cont[0], &any_null, &status);
+  fits_read_col_dbl(m_fits_file, m_position_column, first_row + 1, 1, 3 * num_row, 0., &m_position_cont[0], &any_null,
+    &status);
+  checkStatus(status);
+  m_window_index = window_index;
+  m_cursor = 0;
+}
+
+void ScDataWindow::checkStatus(int status) const {
+  if (0 == status) return;
+  char message[FLEN_ERRMSG];
+  fits_get_errstatus(status, message);
+  fits_clear_errmsg();
+  throw std::runtime_error("Cannot read spacecraft file " + m_sc_file_name + "[" + m_sc_table_name + "]: " + message);
+}
@@ -0,0 +1,138 @@
+/** \file ScDataWindow.h
+    \brief Declaration of ScDataWindow class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_ScDataWindow_h
+#define pulsePhase_ScDataWindow_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fitsio.h"
+
+/** \class ScDataWindow
+    \brief Windowed access to spacecraft positions in a spacecraft file, for mission-long spacecraft files which are
+           too large to be loaded as a whole. Rows of the spacecraft data table are divided into windows of a fixed
+           number of rows, and only the start times of the first rows of the windows are kept in memory as a time
+           index, along with the start times and the positions of the rows in one window. The time index is built by
+           reading the start time of one row per window, or loaded from an index file, which is rebuilt automatically
+           if the spacecraft file is modified. A row is located by interpolation search, first in the time index and
+           then in the window, except that a cursor in the window is advanced row by row while the given times
+           increase, so that a position is found in constant time for events sorted by time. A position is
+           interpolated linearly between the two rows around the given time, and then scaled to the distance from
+           the center of the Earth interpolated linearly between the two rows.
+*/
+class ScDataWindow {
+  public:
+    /** \brief Construct an ScDataWindow object.
+        \param sc_file_name Name of spacecraft file.
+        \param sc_table_name Name of the table in the spacecraft file.
+        \param window_size Number of rows in a window.
+        \param index_file_name Name of the file to load the time index from or save it into, or an empty string to
+               build the time index in memory.
+    */
+    ScDataWindow(const std::string & sc_file_name, const std::string & sc_table_name, long window_size,
+      const std::string & index_file_name);
+
+    /// \brief Destruct this ScDataWindow object.
+    ~ScDataWindow();
+
+    /** \brief Compute the spacecraft position at the given time, in meters.
+        \param elapsed_time Mission elapsed time in seconds.
+        \param sc_position Spacecraft position, set by this method.
+    */
+    void computePosition(double elapsed_time, std::vector<double> & sc_position);
+
+    /** \brief Find the interval of time containing the given time, in which spacecraft positions are interpolated
+               from the same two rows. The interval starts at one row and stops at the next row, except that the
+               interval of the last two rows extends to the end of the spacecraft data.
+        \param elapsed_time Mission elapsed time in seconds.
+        \param start_time Start time of the interval, which is the start time of the first row, set by this method.
+        \param stop_time Stop time of the interval, set by this method.
+        \param next_time Start time of the second row, set by this method.
+        \param start_position Spacecraft position in the first row, in meters, set by this method.
+        \param next_position Spacecraft position in the second row, in meters, set by this method.
+    */
+    void findRowInterval(double elapsed_time, double & start_time, double & stop_time, double & next_time,
+      std::vector<double> & start_position, std::vector<double> & next_position);
+
+    /** \brief Return a fingerprint of the spacecraft data from which spacecraft positions are interpolated for times
+               in the given range, computed from the start times, the stop times and the positions of the rows around
+               the times. The fingerprint does not change when rows are appended after those rows, so that it tells
+               whether positions computed in the past for the times are still valid after the spacecraft file grows.
+               If the rows start at the same row as in the previous call, only rows after those hashed in the
+               previous call are read, so that a range growing with appended events is fingerprinted in time
+               proportional to the growth.
+        \param start_time First mission elapsed time of the range in seconds.
+        \param stop_time Last mission elapsed time of the range in seconds.
+    */
+    std::string computeFingerprint(double start_time, double stop_time);
+
+  private:
+    std::string m_sc_file_name;
+    std::string m_sc_table_name;
+    long m_window_size;
+    fitsfile * m_fits_file;
+    int m_start_column;
+    int m_stop_column;
+    int m_position_column;
+    long m_num_row;
+    double m_stop_time;
+    std::vector<double> m_index_cont;
+    long m_window_index;
+    std::vector<double> m_start_cont;
+    std::vector<double> m_position_cont;
+    long m_cursor;
+    long m_hash_first_row;
+    long m_hash_last_row;
+    std::uint64_t m_hash;
+
+    /** \brief Load the window containing the given time, and set the cursor to the row at or before the time.
+        \param elapsed_time Mission elapsed time in seconds.
+    */
+    void locateRow(double elapsed_time);
+
+    /** \brief Return the index of the row from which a spacecraft position is interpolated for the given time, with
+               the next row, counting from zero. The first or the last row is returned for a time before the first row
+               or after the end of the spacecraft data, respectively.
+        \param elapsed_time Mission elapsed time in seconds.
+    */
+    long findRow(double elapsed_time);
+
+    /** \brief Return the signature of the spacecraft file, which is recorded in the index file to detect
+               modification of the spacecraft file.
+    */
+    std::string getSignature() const;
+
+    /// \brief Build the time index by reading the spacecraft file.
+    void buildIndex();
+
+    /** \brief Load the time index from the given index file, and return true if it is up to date.
+        \param index_file_name Name of the index file.
+    */
+    bool loadIndex(const std::string & index_file_name);
+
+    /** \brief Save the time index into the given index file, replacing any existing file atomically so that other
+               processes never read an incomplete index file.
+        \param index_file_name Name of the index file.
+    */
+    void saveIndex(const std::string & index_file_name) const;
+
+    /** \brief Load rows of the given window into memory, including the first row of the next window.
+        \param window_index Index of the window.
+    */
+    void loadWindow(long window_index);
+
+    /** \brief Throw an exception describing a CFITSIO error if the given status is not zero.
+        \param status CFITSIO status code.
+    */
+    void checkStatus(int status) const;
+
+    // Prohibit copying.
+    ScDataWindow(const ScDataWindow &);
+    ScDataWindow & operator =(const ScDataWindow &);
+};
+
+#endif
@@ -0,0 +1,270 @@
+/** \file SpinPhaseTable.cxx
+    \brief Implementation of SpinPhaseTable class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "SpinPhaseTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+#include "pulsarDb/EphChooser.h"
+#include "pulsarDb/EphComputer.h"
+#include "pulsarDb/PulsarEph.h"
+
+#include "timeSystem/AbsoluteTime.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define PULSEPHASE_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  /** \brief Evaluate a polynomial by the compensated Horner scheme, and return the fractional part of the result.
+             Fused multiply-add operations are used wherever the AVX2 kernel uses them, so that the result is the same
+             bit for bit whichever evaluates an event. std::fma is correctly rounded even without hardware support.
+      \param coeff Coefficients of the polynomial, from the constant term upward.
+      \param xx Value of the variable.
+  */
+  inline double evaluatePolynomial(const double * coeff, double xx) {
+    double sum = coeff[SpinPhaseTable::s_num_coeff - 1];
+    double error = 0.;
+    for (int coeff_index = SpinPhaseTable::s_num_coeff - 2; coeff_index >= 0; --coeff_index) {
+      double product = sum * xx;
+      double product_error = std::fma(sum, xx, -product);
+      double new_sum = product + coeff[coeff_index];
+      double virtual_coeff = new_sum - product;
+      double sum_error = (product - (new_sum - virtual_coeff)) + (coeff[coeff_index] - virtual_coeff);
+      error = std::fma(error, xx, product_error + sum_error);
+      sum = new_sum;
+    }
+    double phase = (sum - std::floor(sum)) + error;
+    return phase - std::floor(phase);
+  }
+
+#ifdef PULSEPHASE_AVX2_KERNEL
+  /** \brief Evaluate polynomials for events four at a time with AVX2 and FMA instructions, in the same way as
+             evaluatePolynomial function. Return the number of events evaluated, which is a multiple of four.
+      \param coeff_cont Coefficients of polynomials.
+      \param poly_index Polynomial indices of events.
+      \param num_event Number of events.
+      \param elapsed Elapsed times of events from the anchor times of their polynomials.
+      \param phase Array to store the phases in.
+  */
+  __attribute__((target("avx2,fma")))
+  long evaluateAvx2(const double * coeff_cont, const long * poly_index, long num_event, const double * elapsed,
+    double * phase) {
+    static_assert(sizeof(long) == 8, "Polynomial indices must be 64-bit integers");
+    static_assert(SpinPhaseTable::s_num_coeff == 5, "Offsets of coefficients are computed for five coefficients");
+    const __m256i zero = _mm256_setzero_si256();
+    long event_index = 0;
+    for (; event_index + 4 <= num_event; event_index += 4) {
+      // Compute offsets of coefficients, using the first polynomial in place of negative indices.
+      __m256i offset = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(poly_index + event_index));
+      offset = _mm256_andnot_si256(_mm256_cmpgt_epi64(zero, offset), offset);
+      offset = _mm256_add_epi64(_mm256_slli_epi64(offset, 2), offset);
+
+      // Load coefficients of the polynomial of the first event for all four events if they share the polynomial,
+      // which is the case for most events in time order, or gather coefficients of each event otherwise.
+      __m256d coeff_cont_x4[SpinPhaseTable::s_num_coeff];
+      long first_offset = _mm256_extract_epi64(offset, 0);
+      if (-1 == _mm256_movemask_epi8(_mm256_cmpeq_epi64(offset, _mm256_set1_epi64x(first_offset)))) {
+        for (int coeff_index = 0; coeff_index < SpinPhaseTable::s_num_coeff; ++coeff_index) {
+          coeff_cont_x4[coeff_index] = _mm256_broadcast_sd(coeff_cont + first_offset + coeff_index);
+        }
+      } else {
+        for (int coeff_index = 0; coeff_index < SpinPhaseTable::s_num_coeff; ++coeff_index) {
+          coeff_cont_x4[coeff_index] = _mm256_i64gather_pd(coeff_cont + coeff_index, offset, 8);
+        }
+      }
+
+      __m256d xx = _mm256_loadu_pd(elapsed + event_index);
+      __m256d sum = coeff_cont_x4[4];
+      __m256d error = _mm256_setzero_pd();
+      for (int coeff_index = 3; coeff_index >= 0; --coeff_index) {
+        __m256d coeff = coeff_cont_x4[coeff_index];
+        __m256d product = _mm256_mul_pd(sum, xx);
+        __m256d product_error = _mm256_fmsub_pd(sum, xx, product);
+        __m256d new_sum = _mm256_add_pd(product, coeff);
+        __m256d virtual_coeff = _mm256_sub_pd(new_sum, product);
+        __m256d sum_error = _mm256_add_pd(_mm256_sub_pd(product, _mm256_sub_pd(new_sum, virtual_coeff)),
+          _mm256_sub_pd(coeff, virtual_coeff));
+        error = _mm256_fmadd_pd(error, xx, _mm256_add_pd(product_error, sum_error));
+        sum = new_sum;
+      }
+      __m256d result = _mm256_add_pd(_mm256_sub_pd(sum, _mm256_floor_pd(sum)), error);
+      _mm256_storeu_pd(phase + event_index, _mm256_sub_pd(result, _mm256_floor_pd(result)));
+    }
+    return event_index;
+  }
+
+  /// \brief Return true if the processor supports AVX2 and FMA instructions.
+  bool hasAvx2() {
+    static const bool has_avx2 = (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"));
+    return has_avx2;
+  }
+#endif
+
+}
+
+SpinPhaseTable::SpinPhaseTable(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser,
+  double phase_offset, double tolerance, double min_piece_length): m_computer(computer), m_chooser(chooser),
+  m_phase_offset(phase_offset), m_tolerance(tolerance), m_min_piece_length(min_piece_length), m_guard(1.),
+  m_boundary_cont(), m_covered_cont(), m_coeff_cont(), m_piece_dict(), m_current_day_cont(0), m_current_day(0) {
+  // Collect boundaries of validity windows in time order.
+  const pulsarDb::PulsarEphCont & eph_cont(m_computer.getPulsarEphCont());
+  for (pulsarDb::PulsarEphCont::const_iterator itor = eph_cont.begin(); itor != eph_cont.end(); ++itor) {
+    m_boundary_cont.push_back(PhaseTime::create((*itor)->getValidSince()));
+    m_boundary_cont.push_back(PhaseTime::create((*itor)->getValidUntil()));
+  }
+  std::sort(m_boundary_cont.begin(), m_boundary_cont.end(),
+    [](const PhaseTime & time1, const PhaseTime & time2) { return time1 - time2 < 0.; });
+
+  // Determine whether each segment between boundaries is covered by a validity window.
+  for (std::vector<PhaseTime>::size_type ii = 1; ii < m_boundary_cont.size(); ++ii) {
+    bool covered = false;
+    for (pulsarDb::PulsarEphCont::const_iterator itor = eph_cont.begin(); !covered && itor != eph_cont.end(); ++itor) {
+      covered = (PhaseTime::create((*itor)->getValidSince()) - m_boundary_cont[ii - 1] <= 0. &&
+        m_boundary_cont[ii] - PhaseTime::create((*itor)->getValidUntil()) <= 0.);
+    }
+    m_covered_cont.push_back(covered);
+  }
+}
+
+long SpinPhaseTable::findSegment(const PhaseTime & time) const {
+  std::vector<PhaseTime>::const_iterator itor = std::upper_bound(m_boundary_cont.begin(), m_boundary_cont.end(), time,
+    [](const PhaseTime & time1, const PhaseTime & time2) { return time1 - time2 < 0.; });
+  if (m_boundary_cont.begin() == itor || m_boundary_cont.end() == itor) return -1;
+  return (itor - m_boundary_cont.begin()) - 1;
+}
+
+long SpinPhaseTable::findPolynomial(const PhaseTime & time, double & elapsed) {
+  if (0 == m_current_day_cont || time.m_day != m_current_day) {
+    PieceDict::const_iterator day_itor = m_piece_dict.find(time.m_day);
+    m_current_day_cont = (m_piece_dict.end() == day_itor ? &buildDay(time.m_day) : &day_itor->second);
+    m_current_day = time.m_day;
+  }
+
+  // Find the last piece that starts at or before the given time.
+  PieceCont::const_iterator itor = std::upper_bound(m_current_day_cont->begin(), m_current_day_cont->end(), time.m_sec,
+    [](double sec, const Piece & piece) { return sec < piece.m_start; });
+  if (m_current_day_cont->begin() != itor) --itor;
+  elapsed = time - itor->m_anchor;
+  return itor->m_poly_index;
+}
+
+const double * SpinPhaseTable::getCoefficient() const {
+  return m_coeff_cont.empty() ? 0 : &m_coeff_cont[0];
+}
+
+void SpinPhaseTable::evaluate(const double * coeff_cont, const long * poly_begin, const long * poly_end,
+  const double * elapsed_begin, double * phase_begin) {
+  if (0 == coeff_cont) return;
+  long num_event = poly_end - poly_begin;
+  long event_index = 0;
+#ifdef PULSEPHASE_AVX2_KERNEL
+  if (hasAvx2()) event_index = evaluateAvx2(coeff_cont, poly_begin, num_event, elapsed_begin, phase_begin);
+#endif
+  for (; event_index < num_event; ++event_index) {
+    long poly_index = poly_begin[event_index];
+    if (poly_index >= 0) {
+      phase_begin[event_index] = evaluatePolynomial(coeff_cont + poly_index * s_num_coeff, elapsed_begin[event_index]);
+    }
+  }
+}
+
+const SpinPhaseTable::PieceCont & SpinPhaseTable::buildDay(long day) {
+  // Cut the day at the guard margins around boundaries of validity windows.
+  PhaseTime day_start(day, 0.);
+  double day_length = PhaseTime::s_sec_per_day;
+  std::vector<double> boundary_cont;
+  std::vector<double> cut_cont;
+  cut_cont.push_back(0.);
+  cut_cont.push_back(day_length);
+  for (std::vector<PhaseTime>::const_iterator itor = m_boundary_cont.begin(); itor != m_boundary_cont.end(); ++itor) {
+    double boundary = *itor - day_start;
+    if (boundary <= -m_guard || boundary >= day_length + m_guard) continue;
+    boundary_cont.push_back(boundary);
+    if (0. < boundary - m_guard && boundary - m_guard < day_length) cut_cont.push_back(boundary - m_guard);
+    if (0. < boundary + m_guard && boundary + m_guard < day_length) cut_cont.push_back(boundary + m_guard);
+  }
+  std::sort(cut_cont.begin(), cut_cont.end());
+  cut_cont.erase(std::unique(cut_cont.begin(), cut_cont.end()), cut_cont.end());
+
+  // Build pieces for intervals between cuts, leaving intervals near boundaries or not covered by any validity window
+  // to the EphComputer.
+  PieceCont piece_cont;
+  for (std::vector<double>::size_type cut_index = 1; cut_index < cut_cont.size(); ++cut_index) {
+    double start = cut_cont[cut_index - 1];
+    double stop = cut_cont[cut_index];
+    double middle = .5 * (start + stop);
+    bool exact = false;
+    for (std::vector<double>::const_iterator itor = boundary_cont.begin(); !exact && itor != boundary_cont.end(); ++itor) {
+      exact = (std::fabs(middle - *itor) < m_guard);
+    }
+    if (!exact) {
+      PhaseTime middle_time(day, middle);
+      std::vector<PhaseTime>::const_iterator itor = std::upper_bound(m_boundary_cont.begin(), m_boundary_cont.end(),
+        middle_time, [](const PhaseTime & time1, const PhaseTime & time2) { return time1 - time2 < 0.; });
+      std::vector<PhaseTime>::size_type num_before = itor - m_boundary_cont.begin();
+      exact = (0 == num_before || m_boundary_cont.size() == num_before || !m_covered_cont[num_before - 1]);
+    }
+
+    if (exact) {
+      Piece piece = { start, -1, PhaseTime(day, start) };
+      piece_cont.push_back(piece);
+    } else {
+      buildPiece(day, start, stop, piece_cont);
+    }
+  }
+
+  return m_piece_dict[day] = piece_cont;
+}
+
+void SpinPhaseTable::buildPiece(long day, double start, double stop, PieceCont & piece_cont) {
+  // Compute coefficients of the Taylor polynomial of pulse phase around the middle of the interval.
+  PhaseTime anchor(day, .5 * (start + stop));
+  timeSystem::AbsoluteTime abs_anchor(anchor.getAbsoluteTime());
+  const pulsarDb::PulsarEph & eph(m_chooser.choose(m_computer.getPulsarEphCont(), abs_anchor));
+  double coeff[s_num_coeff] = { computeExactPhase(anchor) };
+  double factorial = 1.;
+  for (int coeff_index = 1; coeff_index < s_num_coeff; ++coeff_index) {
+    factorial *= coeff_index;
+    try {
+      coeff[coeff_index] = eph.calcFrequency(abs_anchor, coeff_index - 1) / factorial;
+    } catch (const std::exception &) {
+      // Leave higher-order coefficients zero if the ephemeris does not compute the derivative.
+      for (; coeff_index < s_num_coeff; ++coeff_index) coeff[coeff_index] = 0.;
+    }
+  }
+
+  // Compare the polynomial with pulse phases computed by the EphComputer throughout the piece, at probe times evenly
+  // spaced from one end to the other, so that a piece is accepted only if the tolerance is met across the piece.
+  bool valid = true;
+  for (int probe_index = 0; valid && probe_index <= s_num_probe_interval; ++probe_index) {
+    double fraction = double(probe_index) / s_num_probe_interval;
+    PhaseTime probe_time(day, (1. - fraction) * start + fraction * stop);
+    double difference = evaluatePolynomial(coeff, probe_time - anchor) - computeExactPhase(probe_time);
+    difference -= std::floor(difference + .5);
+    valid = (std::fabs(difference) <= m_tolerance);
+  }
+
+  if (valid) {
+    Piece piece = { start, long(m_coeff_cont.size() / s_num_coeff), anchor };
+    piece_cont.push_back(piece);
+    m_coeff_cont.insert(m_coeff_cont.end(), coeff, coeff + s_num_coeff);
+  } else if ((stop - start) * .5 >= m_min_piece_length) {
+    double middle = .5 * (start + stop);
+    buildPiece(day, start, middle, piece_cont);
+    buildPiece(day, middle, stop, piece_cont);
+  } else {
+    Piece piece = { start, -1, PhaseTime(day, start) };
+    piece_cont.push_back(piece);
+  }
+}
+
+double SpinPhaseTable::computeExactPhase(const PhaseTime & time) const {
+  return m_computer.calcPulsePhase(time.getAbsoluteTime(), m_phase_offset);
+}
@@ -0,0 +1,123 @@
+/** \file SpinPhaseTable.h
+    \brief Declaration of SpinPhaseTable class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_SpinPhaseTable_h
+#define pulsePhase_SpinPhaseTable_h
+
+#include <map>
+#include <vector>
+
+#include "PhaseTime.h"
+
+namespace pulsarDb {
+  class EphChooser;
+  class EphComputer;
+}
+
+/** \class SpinPhaseTable
+    \brief Table of polynomials which approximate pulse phases computed by an EphComputer object, so that pulse phases
+           of a block of events can be evaluated by a vectorized kernel. The table is built on demand, one day at a time.
+           A day is first cut at the boundaries of validity windows of the spin ephemerides, so that the ephemeris chosen
+           for a time does not change within a piece, and each piece is bisected until the Taylor polynomial of pulse
+           phase around its midpoint, whose coefficients are computed from the frequency and its derivatives of the
+           ephemeris, agrees with pulse phases computed by the EphComputer within a given tolerance at probe times
+           evenly spaced across the piece, both ends included. Pieces near the boundaries, pieces not covered by any
+           validity window, and pieces that do not meet the tolerance at the minimum length are left to the
+           EphComputer. Callers who need pulse phases exactly as computed by the EphComputer should not use a table.
+*/
+class SpinPhaseTable {
+  public:
+    /// \brief Number of polynomial coefficients per piece.
+    static const int s_num_coeff = 5;
+
+    /// \brief Number of intervals between probe times in a piece, at which the polynomial is checked.
+    static const int s_num_probe_interval = 16;
+
+    /** \brief Construct a SpinPhaseTable object.
+        \param computer EphComputer to compute pulse phases with.
+        \param chooser Ephemeris chooser used by the EphComputer object.
+        \param phase_offset Global phase offset to add to all phases.
+        \param tolerance Maximum error of pulse phases allowed, in units of cycles.
+        \param min_piece_length Minimum length of a piece in seconds, below which a piece is not bisected further.
+    */
+    SpinPhaseTable(const pulsarDb::EphComputer & computer, const pulsarDb::EphChooser & chooser, double phase_offset,
+      double tolerance = 1.e-9, double min_piece_length = 1.);
+
+    /** \brief Find the polynomial for the given time, building the table for the time if not built yet. Return the index
+               of the polynomial, or -1 if the pulse phase must be computed by the EphComputer object.
+        \param time Time to find the polynomial for.
+        \param elapsed Number of seconds elapsed from the anchor time of the polynomial, to be set by this method.
+    */
+    long findPolynomial(const PhaseTime & time, double & elapsed);
+
+    /** \brief Return the index of the segment of time between boundaries of validity windows of the spin ephemerides
+               that contains the given time, counted from the earliest boundary. Return -1 if the time is before the
+               earliest boundary or after the latest boundary.
+        \param time Time to find the segment for.
+    */
+    long findSegment(const PhaseTime & time) const;
+
+    /// \brief Return a pointer to the coefficients of all polynomials, s_num_coeff coefficients per polynomial.
+    const double * getCoefficient() const;
+
+    /** \brief Evaluate polynomials for a range of events by the compensated Horner scheme, returning the fractional part
+               of the result. Events whose polynomial index is negative are skipped, and their phases are left undefined.
+        \param coeff_cont Coefficients of polynomials, as returned by getCoefficient method.
+        \param poly_begin Pointer to the polynomial index of the first event.
+        \param poly_end Pointer to one past the polynomial index of the last event.
+        \param elapsed_begin Pointer to the elapsed time of the first event, from the anchor time of its polynomial.
+        \param phase_begin Pointer to the first element of the array to store the phases in.
+    */
+    static void evaluate(const double * coeff_cont, const long * poly_begin, const long * poly_end,
+      const double * elapsed_begin, double * phase_begin);
+
+  private:
+    /// \brief A piece of a day, which is either approximated by a polynomial or left to the EphComputer object.
+    struct Piece {
+      double m_start;
+      long m_poly_index;
+      PhaseTime m_anchor;
+    };
+
+    typedef std::vector<Piece> PieceCont;
+    typedef std::map<long, PieceCont> PieceDict;
+
+    const pulsarDb::EphComputer & m_computer;
+    const pulsarDb::EphChooser & m_chooser;
+    double m_phase_offset;
+    double m_tolerance;
+    double m_min_piece_length;
+    double m_guard;
+    std::vector<PhaseTime> m_boundary_cont;
+    std::vector<bool> m_covered_cont;
+    std::vector<double> m_coeff_cont;
+    PieceDict m_piece_dict;
+    const PieceCont * m_current_day_cont;
+    long m_current_day;
+
+    /** \brief Build the pieces of the given day.
+        \param day Integer part of MJD in TDB.
+    */
+    const PieceCont & buildDay(long day);
+
+    /** \brief Build pieces for an interval of time within a day, bisecting it as needed.
+        \param day Integer part of MJD in TDB.
+        \param start Start of the interval, in seconds of the day.
+        \param stop Stop of the interval, in seconds of the day.
+        \param piece_cont Container to append pieces to.
+    */
+    void buildPiece(long day, double start, double stop, PieceCont & piece_cont);
+
+    /** \brief Compute the pulse phase at the given time with the EphComputer object.
+        \param time Time to compute the pulse phase for.
+    */
+    double computeExactPhase(const PhaseTime & time) const;
+
+    // Prohibit copying.
+    SpinPhaseTable(const SpinPhaseTable &);
+    SpinPhaseTable & operator =(const SpinPhaseTable &);
+};
+
+#endif
@@ -0,0 +1,67 @@
+/** \file StdioPipe.cxx
+    \brief Implementation of StdioPipe class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "StdioPipe.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+StdioPipe::StdioPipe(): m_input_file_name(), m_output_file_name(), m_stdout_buf(0) {}
+
+StdioPipe::~StdioPipe() throw() {
+  // Remove the copy of the standard input.
+  if (!m_input_file_name.empty()) std::remove(m_input_file_name.c_str());
+
+  // Send the output file to the standard output, and remove it.
+  if (!m_output_file_name.empty()) {
+    std::cout.flush();
+    std::cout.rdbuf(m_stdout_buf);
+    std::ifstream ifs(m_output_file_name.c_str(), std::ios::binary);
+    if (!ifs || !(std::cout << ifs.rdbuf()) || !std::cout.flush()) {
+      std::cerr << "Error: cannot send the output file to the standard output" << std::endl;
+    }
+    ifs.close();
+    std::remove(m_output_file_name.c_str());
+  }
+}
+
+std::string StdioPipe::openInputPipe() {
+  if (!m_input_file_name.empty()) throw std::runtime_error("The standard input can be read only once");
+  m_input_file_name = createTemporaryFile("stdin");
+
+  // Copy the standard input into the temporary file.
+  std::ofstream ofs(m_input_file_name.c_str(), std::ios::binary | std::ios::trunc);
+  if (!(ofs << std::cin.rdbuf()) || !ofs.flush()) {
+    throw std::runtime_error("Cannot copy the standard input into file \"" + m_input_file_name + "\"");
+  }
+  return m_input_file_name;
+}
+
+std::string StdioPipe::openOutputPipe() {
+  if (!m_output_file_name.empty()) throw std::runtime_error("The standard output can be written only once");
+  m_output_file_name = createTemporaryFile("stdout");
+
+  // Keep messages off the standard output until the output file is sent.
+  std::cout.flush();
+  m_stdout_buf = std::cout.rdbuf(std::cerr.rdbuf());
+  return m_output_file_name;
+}
+
+std::string StdioPipe::createTemporaryFile(const std::string & prefix) {
+  const char * tmp_dir = std::getenv("TMPDIR");
+  std::string file_template = std::string(tmp_dir ? tmp_dir : "/tmp") + "/pulsePhase_" + prefix + "_XXXXXX";
+  std::vector<char> file_name(file_template.begin(), file_template.end());
+  file_name.push_back('\0');
+  int file_descriptor = mkstemp(&file_name[0]);
+  if (-1 == file_descriptor) throw std::runtime_error("Cannot create a temporary file for the " + prefix);
+  close(file_descriptor);
+  return std::string(&file_name[0]);
+}
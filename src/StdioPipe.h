@@ -0,0 +1,49 @@
+/** \file StdioPipe.h
+    \brief Declaration of StdioPipe class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_StdioPipe_h
+#define pulsePhase_StdioPipe_h
+
+#include <streambuf>
+#include <string>
+
+/** \class StdioPipe
+    \brief Temporary files which stand in for the standard input and the standard output, so that an event file can be
+           read from a pipe and written to a pipe. The standard input is copied into a temporary file before the file
+           is opened. Output is written into another temporary file, which is sent to the standard output when this
+           object is destroyed, that is, after all FITS files have been closed by an application class derived from
+           this class. Until then, the standard output stream is redirected to the standard error, so that messages of
+           the application are not mixed with the output file.
+*/
+class StdioPipe {
+  public:
+    /// \brief Construct a StdioPipe object.
+    StdioPipe();
+
+    /// \brief Destruct this StdioPipe object, sending the output file to the standard output if requested.
+    virtual ~StdioPipe() throw();
+
+    /// \brief Copy the standard input into a temporary file, and return the name of the file.
+    std::string openInputPipe();
+
+    /// \brief Create a temporary file to be sent to the standard output, and return the name of the file.
+    std::string openOutputPipe();
+
+  private:
+    std::string m_input_file_name;
+    std::string m_output_file_name;
+    std::streambuf * m_stdout_buf;
+
+    /** \brief Create a new, empty temporary file, and return its name.
+        \param prefix Prefix of the file name.
+    */
+    static std::string createTemporaryFile(const std::string & prefix);
+
+    // Prohibit copying.
+    StdioPipe(const StdioPipe &);
+    StdioPipe & operator =(const StdioPipe &);
+};
+
+#endif
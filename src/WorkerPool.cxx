@@ -0,0 +1,102 @@
+/** \file WorkerPool.cxx
+    \brief Implementation of WorkerPool class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#include "WorkerPool.h"
+
+#include <stdexcept>
+
+WorkerPool::WorkerPool(long num_worker): m_thread_cont(), m_job_queue(), m_mutex(), m_job_ready(), m_job_done(),
+  m_stop(false) {
+  if (num_worker < 0) throw std::runtime_error("Number of worker threads must be zero or positive");
+  try {
+    for (long worker_index = 0; worker_index < num_worker; ++worker_index) {
+      m_thread_cont.push_back(std::thread(&WorkerPool::work, this));
+    }
+  } catch (...) {
+    // Stop the threads started so far, before this object is abandoned.
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_job_ready.notify_all();
+    for (std::vector<std::thread>::iterator itor = m_thread_cont.begin(); itor != m_thread_cont.end(); ++itor) {
+      itor->join();
+    }
+    throw;
+  }
+}
+
+WorkerPool::~WorkerPool() throw() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_job_ready.notify_all();
+  for (std::vector<std::thread>::iterator itor = m_thread_cont.begin(); itor != m_thread_cont.end(); ++itor) {
+    itor->join();
+  }
+}
+
+long WorkerPool::getNumWorker() const {
+  return m_thread_cont.size();
+}
+
+void WorkerPool::run(const TaskCont & task_cont) {
+  if (task_cont.empty()) return;
+
+  // Run all tasks in the calling thread if there are no worker threads.
+  if (m_thread_cont.empty()) {
+    for (TaskCont::const_iterator itor = task_cont.begin(); itor != task_cont.end(); ++itor) (*itor)();
+    return;
+  }
+
+  // Queue all tasks but the first, which is run in the calling thread.
+  std::vector<std::exception_ptr> error_cont(task_cont.size());
+  std::size_t num_remaining = task_cont.size() - 1;
+  if (0 < num_remaining) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (TaskCont::size_type task_index = 1; task_index < task_cont.size(); ++task_index) {
+        Job job = { &task_cont[task_index], &error_cont[task_index], &num_remaining };
+        m_job_queue.push_back(job);
+      }
+    }
+    m_job_ready.notify_all();
+  }
+  try {
+    task_cont.front()();
+  } catch (...) {
+    error_cont.front() = std::current_exception();
+  }
+
+  // Wait for the queued tasks, which refer to the local variables above, before reporting any error.
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_job_done.wait(lock, [&num_remaining]() { return 0 == num_remaining; });
+  }
+  for (std::vector<std::exception_ptr>::iterator itor = error_cont.begin(); itor != error_cont.end(); ++itor) {
+    if (*itor) std::rethrow_exception(*itor);
+  }
+}
+
+void WorkerPool::work() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_job_ready.wait(lock, [this]() { return m_stop || !m_job_queue.empty(); });
+    if (m_job_queue.empty()) return;
+    Job job = m_job_queue.front();
+    m_job_queue.pop_front();
+
+    // Run the task without the lock, so that other worker threads can take tasks meanwhile.
+    lock.unlock();
+    try {
+      (*job.m_task)();
+    } catch (...) {
+      *job.m_error = std::current_exception();
+    }
+    lock.lock();
+    if (0 == --*job.m_num_remaining) m_job_done.notify_all();
+  }
+}
@@ -0,0 +1,69 @@
+/** \file WorkerPool.h
+    \brief Declaration of WorkerPool class.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+*/
+#ifndef pulsePhase_WorkerPool_h
+#define pulsePhase_WorkerPool_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** \class WorkerPool
+    \brief Pool of worker threads, started once and kept waiting for tasks, so that tasks submitted repeatedly, such as
+           computations for each block of events, do not pay for creating and joining threads every time. Tasks from
+           more than one calling thread may be queued at the same time.
+*/
+class WorkerPool {
+  public:
+    typedef std::function<void ()> TaskType;
+    typedef std::vector<TaskType> TaskCont;
+
+    /** \brief Construct a WorkerPool object, starting the given number of worker threads.
+        \param num_worker Number of worker threads. With no worker threads, all tasks are run in the calling thread.
+    */
+    explicit WorkerPool(long num_worker);
+
+    /// \brief Destruct this WorkerPool object, letting the worker threads finish queued tasks and joining them.
+    virtual ~WorkerPool() throw();
+
+    /// \brief Return the number of worker threads.
+    long getNumWorker() const;
+
+    /** \brief Run the given tasks, and return after all of them are finished. The first task is run in the calling
+               thread, and the others are run by worker threads. If any of the tasks throws an exception, the exception
+               thrown by the first of such tasks in the given order is rethrown.
+        \param task_cont Tasks to run.
+    */
+    void run(const TaskCont & task_cont);
+
+  private:
+    /// \brief A task waiting for a worker thread, with the places to report its result to.
+    struct Job {
+      const TaskType * m_task;
+      std::exception_ptr * m_error;
+      std::size_t * m_num_remaining;
+    };
+
+    std::vector<std::thread> m_thread_cont;
+    std::deque<Job> m_job_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_job_ready;
+    std::condition_variable m_job_done;
+    bool m_stop;
+
+    /// \brief Take tasks from the queue and run them until this object is destroyed.
+    void work();
+
+    // Prohibit copying.
+    WorkerPool(const WorkerPool &);
+    WorkerPool & operator =(const WorkerPool &);
+};
+
+#endif
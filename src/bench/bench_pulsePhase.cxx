@@ -0,0 +1,407 @@
+/** \file bench_pulsePhase.cxx
+    \brief Throughput benchmark of gtpphase and gtophase applications on synthetic event files.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+
+    Usage: bench_pulsePhase [-d data_dir] [-c case_name] [-b barytol] [-t nthreads] [-s span_days] [num_event ...]
+
+    For each number of events given (1e5 by default, up to 1e9 or more), a synthetic event file is created with event
+    times spread evenly over span_days days from the start of the test event data (the one-day span of the test event
+    data by default), and each benchmark case is run on a fresh copy of it, in a separate process. A synthetic
+    spacecraft file covering the same span is created, with the spacecraft on a circular orbit at the altitude and the
+    inclination of the Fermi orbit, so that a span as long as the mission can be benchmarked. Cases with ephemerides
+    from the test pulsar database succeed only within the validity windows of those ephemerides, while cases with a
+    user-supplied ephemeris succeed for any span. One line of JSON is written to the standard output per case, with
+    wall-clock and CPU time, throughput, and peak resident set size of the process. Only cases whose names contain
+    case_name are run if -c option is given. Parameter files of the applications must be found through PFILES
+    environment variable, as for the tools.
+*/
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "EventColumnIo.h"
+#include "OrbitalPhaseApp.h"
+#include "PulsePhaseApp.h"
+
+#include "facilities/commonUtilities.h"
+
+#include "st_app/AppParGroup.h"
+#include "st_app/StApp.h"
+
+#include "timeSystem/EventTimeHandler.h"
+#include "timeSystem/GlastTimeHandler.h"
+
+#include "tip/Header.h"
+#include "tip/IFileSvc.h"
+#include "tip/Table.h"
+#include "tip/TipFile.h"
+
+// List supported event file format(s).
+timeSystem::EventTimeHandlerFactory<timeSystem::GlastScTimeHandler> glast_sctime_handler;
+
+namespace {
+
+  typedef std::vector<std::pair<std::string, std::string> > ParCont;
+
+  /// \brief A benchmark case: an application and parameter values given to it, in addition to common ones.
+  struct BenchCase {
+    std::string m_name;
+    std::string m_tool_name;
+    ParCont m_par_cont;
+  };
+
+  typedef std::vector<BenchCase> BenchCaseCont;
+
+  /// \brief Resource usage of a benchmark case.
+  struct BenchResult {
+    double m_wall_time;
+    double m_cpu_time;
+    long m_peak_rss;
+    bool m_succeeded;
+  };
+
+  /** \brief Create a benchmark case.
+      \param name Name of the case.
+      \param tool_name Name of the application to run, gtpphase or gtophase.
+      \param par_cont Parameter values specific to the case, in pairs of a name and a value.
+  */
+  BenchCase createCase(const std::string & name, const std::string & tool_name, const ParCont & par_cont) {
+    BenchCase bench_case = { name, tool_name, par_cont };
+    return bench_case;
+  }
+
+  /** \brief Create benchmark cases for every ephemeris style and time correction mode of gtpphase, and for every
+             orbital model of gtophase.
+      \param data_dir Directory of the test data files.
+  */
+  BenchCaseCont createCaseCont(const std::string & data_dir) {
+    std::string psrdb_ephcomp = data_dir + "/testpsrdb_ephcomp.fits";
+    std::string spin_freq = data_dir + "/testpsrdb_spin_freq.txt";
+    BenchCaseCont case_cont;
+
+    // Pulse phases from the pulsar database, with each time correction mode.
+    const char * spin_tcorrect[] = { "NONE", "AUTO", "BARY" };
+    for (std::size_t index = 0; index != sizeof(spin_tcorrect) / sizeof(spin_tcorrect[0]); ++index) {
+      ParCont par_cont;
+      par_cont.push_back(std::make_pair("ephstyle", "DB"));
+      par_cont.push_back(std::make_pair("psrdbfile", psrdb_ephcomp));
+      par_cont.push_back(std::make_pair("psrname", "PSR B0540-69"));
+      par_cont.push_back(std::make_pair("tcorrect", spin_tcorrect[index]));
+      case_cont.push_back(createCase(std::string("gtpphase_db_") + spin_tcorrect[index], "gtpphase", par_cont));
+    }
+    const char * binary_tcorrect[] = { "AUTO", "BIN", "ALL" };
+    for (std::size_t index = 0; index != sizeof(binary_tcorrect) / sizeof(binary_tcorrect[0]); ++index) {
+      ParCont par_cont;
+      par_cont.push_back(std::make_pair("ephstyle", "DB"));
+      par_cont.push_back(std::make_pair("psrdbfile", psrdb_ephcomp));
+      par_cont.push_back(std::make_pair("psrname", "PSR J1959+2048"));
+      par_cont.push_back(std::make_pair("tcorrect", binary_tcorrect[index]));
+      case_cont.push_back(createCase(std::string("gtpphase_db_binary_") + binary_tcorrect[index], "gtpphase", par_cont));
+    }
+
+    // Pulse phases from a user-supplied ephemeris.
+    const char * eph_style[] = { "FREQ", "PER" };
+    for (std::size_t style_index = 0; style_index != sizeof(eph_style) / sizeof(eph_style[0]); ++style_index) {
+      const char * user_tcorrect[] = { "NONE", "BARY" };
+      for (std::size_t index = 0; index != sizeof(user_tcorrect) / sizeof(user_tcorrect[0]); ++index) {
+        ParCont par_cont;
+        par_cont.push_back(std::make_pair("ephstyle", eph_style[style_index]));
+        par_cont.push_back(std::make_pair("psrdbfile", "NONE"));
+        par_cont.push_back(std::make_pair("ephepoch", "212380000."));
+        par_cont.push_back(std::make_pair("timeformat", "FERMI"));
+        par_cont.push_back(std::make_pair("timesys", "TDB"));
+        par_cont.push_back(std::make_pair("ra", "85.0482"));
+        par_cont.push_back(std::make_pair("dec", "-69.3319"));
+        par_cont.push_back(std::make_pair("f0", "19.8"));
+        par_cont.push_back(std::make_pair("f1", "-1.88e-10"));
+        par_cont.push_back(std::make_pair("p0", "0.0505"));
+        par_cont.push_back(std::make_pair("p1", "4.79e-13"));
+        par_cont.push_back(std::make_pair("tcorrect", user_tcorrect[index]));
+        std::string style_lc(eph_style[style_index]);
+        for (std::string::iterator itor = style_lc.begin(); itor != style_lc.end(); ++itor) *itor = std::tolower(*itor);
+        case_cont.push_back(createCase("gtpphase_" + style_lc + "_" + user_tcorrect[index], "gtpphase", par_cont));
+
+        // Read the spacecraft file a window of rows at a time, for barycentric corrections.
+        if (std::string("BARY") == user_tcorrect[index]) {
+          par_cont.push_back(std::make_pair("scwindow", "10000"));
+          case_cont.push_back(createCase("gtpphase_" + style_lc + "_" + user_tcorrect[index] + "_scwindow", "gtpphase",
+            par_cont));
+        }
+      }
+    }
+
+    // Orbital phases with each orbital model.
+    const char * orbital_model[] = { "bt", "dd", "ell1", "mss" };
+    for (std::size_t index = 0; index != sizeof(orbital_model) / sizeof(orbital_model[0]); ++index) {
+      std::string list_file = std::string("bench_pulsePhase_") + orbital_model[index] + ".lis";
+      std::FILE * fp = std::fopen(list_file.c_str(), "w");
+      if (0 == fp) throw std::runtime_error("Cannot create file \"" + list_file + "\"");
+      std::fprintf(fp, "%s\n%s/testpsrdb_orbital_%s.txt\n", spin_freq.c_str(), data_dir.c_str(), orbital_model[index]);
+      std::fclose(fp);
+      ParCont par_cont;
+      par_cont.push_back(std::make_pair("psrdbfile", "@" + list_file));
+      par_cont.push_back(std::make_pair("psrname", "PSR J9999+9999"));
+      par_cont.push_back(std::make_pair("srcposition", "DB"));
+      case_cont.push_back(createCase(std::string("gtophase_") + orbital_model[index], "gtophase", par_cont));
+    }
+
+    return case_cont;
+  }
+
+  /** \brief Create a synthetic event file, whose event times are evenly spread over the given span from the start of
+             a template event file, or over the span of the template event file if the given span is not positive.
+      \param template_file Name of the template event file.
+      \param out_file Name of the event file to create.
+      \param num_event Number of events to create.
+      \param span Length of the span of event times in seconds.
+      \param time_start Start time of the span, to be set by this function.
+      \param time_stop Stop time of the span, to be set by this function.
+  */
+  void createEventFile(const std::string & template_file, const std::string & out_file, tip::Index_t num_event,
+    double span, double & time_start, double & time_stop) {
+    tip::IFileSvc::instance().openFile(template_file).copyFile(out_file, true);
+    {
+      std::unique_ptr<tip::Table> table(tip::IFileSvc::instance().editTable(out_file, "EVENTS"));
+      table->getHeader()["TSTART"].get(time_start);
+      table->getHeader()["TSTOP"].get(time_stop);
+      if (0. < span) {
+        time_stop = time_start + span;
+        table->getHeader()["TSTOP"].set(time_stop);
+      }
+      table->setNumRecords(num_event);
+    }
+
+    // Write event times a block at a time.
+    EventColumnIo column_io(EventColumnIo::FileNameCont(1, out_file), "EVENTS");
+    const tip::Index_t block_size = 1000000;
+    std::vector<double> time_block(block_size);
+    double time_step = (time_stop - time_start) / num_event;
+    for (tip::Index_t record_index = 0; record_index < num_event; record_index += block_size) {
+      tip::Index_t num_block = std::min(block_size, num_event - record_index);
+      for (tip::Index_t index = 0; index < num_block; ++index) {
+        time_block[index] = time_start + (record_index + index + .5) * time_step;
+      }
+      column_io.writeColumn("TIME", record_index, &time_block[0], &time_block[0] + num_block);
+    }
+  }
+
+  /** \brief Create a synthetic spacecraft file which covers the given span of time with one row per 30 seconds, with
+             the spacecraft on a circular orbit at the altitude and the inclination of the Fermi orbit.
+      \param template_file Name of the template spacecraft file.
+      \param out_file Name of the spacecraft file to create.
+      \param time_start Start time of the span in mission elapsed time.
+      \param time_stop Stop time of the span in mission elapsed time.
+  */
+  void createScFile(const std::string & template_file, const std::string & out_file, double time_start,
+    double time_stop) {
+    static const double row_length = 30.;
+    static const double orbit_radius = 6.9e6;
+    static const double orbit_period = 5730.;
+    static const double inclination = 25.6 * std::atan(1.) / 45.;
+    static const double two_pi = 8. * std::atan(1.);
+
+    // Cover the span with a margin of one row at each end.
+    double row_start = time_start - row_length;
+    tip::Index_t num_row = static_cast<tip::Index_t>(std::ceil((time_stop - time_start) / row_length)) + 2;
+    tip::IFileSvc::instance().openFile(template_file).copyFile(out_file, true);
+    {
+      std::unique_ptr<tip::Table> table(tip::IFileSvc::instance().editTable(out_file, "SC_DATA"));
+      table->getHeader()["TSTART"].set(row_start);
+      table->getHeader()["TSTOP"].set(row_start + num_row * row_length);
+      table->setNumRecords(num_row);
+    }
+
+    // Write start and stop times and positions of rows a block at a time.
+    fitsfile * fits_file = 0;
+    int status = 0;
+    std::string table_url = out_file + "[SC_DATA]";
+    fits_open_file(&fits_file, table_url.c_str(), READWRITE, &status);
+    int start_column = 0;
+    int stop_column = 0;
+    int position_column = 0;
+    char start_name[] = "START";
+    char stop_name[] = "STOP";
+    char position_name[] = "SC_POSITION";
+    fits_get_colnum(fits_file, CASEINSEN, start_name, &start_column, &status);
+    fits_get_colnum(fits_file, CASEINSEN, stop_name, &stop_column, &status);
+    fits_get_colnum(fits_file, CASEINSEN, position_name, &position_column, &status);
+    const tip::Index_t block_size = 100000;
+    std::vector<double> start_block(block_size);
+    std::vector<double> stop_block(block_size);
+    std::vector<double> position_block(3 * block_size);
+    for (tip::Index_t row_index = 0; 0 == status && row_index < num_row; row_index += block_size) {
+      tip::Index_t num_block = std::min(block_size, num_row - row_index);
+      for (tip::Index_t index = 0; index < num_block; ++index) {
+        double start = row_start + (row_index + index) * row_length;
+        double phase = two_pi * std::fmod(start, orbit_period) / orbit_period;
+        start_block[index] = start;
+        stop_block[index] = start + row_length;
+        position_block[3 * index] = orbit_radius * std::cos(phase);
+        position_block[3 * index + 1] = orbit_radius * std::sin(phase) * std::cos(inclination);
+        position_block[3 * index + 2] = orbit_radius * std::sin(phase) * std::sin(inclination);
+      }
+      fits_write_col_dbl(fits_file, start_column, row_index + 1, 1, num_block, &start_block[0], &status);
+      fits_write_col_dbl(fits_file, stop_column, row_index + 1, 1, num_block, &stop_block[0], &status);
+      fits_write_col_dbl(fits_file, position_column, row_index + 1, 1, 3 * num_block, &position_block[0], &status);
+    }
+    int close_status = 0;
+    if (0 != fits_file) fits_close_file(fits_file, &close_status);
+    if (0 != status || 0 != close_status) throw std::runtime_error("Cannot write spacecraft file \"" + out_file + "\"");
+  }
+
+  /** \brief Run an application in this process.
+      \param bench_case Benchmark case to run.
+      \param common_par_cont Parameter values common to all cases.
+  */
+  void runApplication(const BenchCase & bench_case, const ParCont & common_par_cont) {
+    std::unique_ptr<st_app::StApp> app(nullptr);
+    if ("gtpphase" == bench_case.m_tool_name) app.reset(new PulsePhaseApp);
+    else app.reset(new OrbitalPhaseApp);
+    st_app::AppParGroup & pars(app->getParGroup());
+    pars.suppressPrompts();
+    for (ParCont::const_iterator itor = common_par_cont.begin(); itor != common_par_cont.end(); ++itor) {
+      pars[itor->first] = itor->second;
+    }
+    for (ParCont::const_iterator itor = bench_case.m_par_cont.begin(); itor != bench_case.m_par_cont.end(); ++itor) {
+      pars[itor->first] = itor->second;
+    }
+    app->run();
+  }
+
+  /** \brief Run a benchmark case in a child process, and measure its resource usage.
+      \param bench_case Benchmark case to run.
+      \param common_par_cont Parameter values common to all cases.
+  */
+  BenchResult runCase(const BenchCase & bench_case, const ParCont & common_par_cont) {
+    std::cout.flush();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (-1 == pid) throw std::runtime_error("Cannot create a process for case \"" + bench_case.m_name + "\"");
+    if (0 == pid) {
+      int exit_status = 0;
+      try {
+        runApplication(bench_case, common_par_cont);
+      } catch (const std::exception & x) {
+        std::cerr << bench_case.m_name << ": " << x.what() << std::endl;
+        exit_status = 1;
+      }
+      std::cerr.flush();
+      _exit(exit_status);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (-1 == wait4(pid, &status, 0, &usage)) throw std::runtime_error("Cannot wait for case \"" + bench_case.m_name + "\"");
+    BenchResult result;
+    result.m_wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.m_cpu_time = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1.e-6 + usage.ru_stime.tv_sec +
+      usage.ru_stime.tv_usec * 1.e-6;
+    result.m_peak_rss = usage.ru_maxrss;
+    result.m_succeeded = (WIFEXITED(status) && 0 == WEXITSTATUS(status));
+    return result;
+  }
+
+}
+
+int main(int argc, char ** argv) {
+  try {
+    // Read command-line options.
+    std::string data_dir;
+    std::string case_pattern;
+    std::string bary_tol("0.");
+    std::string num_thread("1");
+    double span = 0.;
+    std::vector<tip::Index_t> num_event_cont;
+    for (int arg_index = 1; arg_index < argc; ++arg_index) {
+      std::string arg(argv[arg_index]);
+      if (("-d" == arg || "-c" == arg || "-b" == arg || "-t" == arg || "-s" == arg) && arg_index + 1 < argc) {
+        std::string value(argv[++arg_index]);
+        if ("-d" == arg) data_dir = value;
+        else if ("-c" == arg) case_pattern = value;
+        else if ("-b" == arg) bary_tol = value;
+        else if ("-s" == arg) span = std::atof(value.c_str()) * 86400.;
+        else num_thread = value;
+      } else {
+        double num_event = std::atof(arg.c_str());
+        if (num_event < 1.) throw std::runtime_error("Invalid number of events \"" + arg + "\"");
+        num_event_cont.push_back(static_cast<tip::Index_t>(num_event));
+      }
+    }
+    if (data_dir.empty()) data_dir = facilities::commonUtilities::getDataPath("pulsePhase");
+    if (num_event_cont.empty()) num_event_cont.push_back(100000);
+
+    // Set up benchmark cases.
+    BenchCaseCont case_cont(createCaseCont(data_dir));
+    std::string template_file = data_dir + "/testevdata_1day_unordered.fits";
+    std::string sc_template_file = data_dir + "/testscdata_1day.fits";
+    std::string sc_file("bench_pulsePhase_sc.fits");
+    std::string source_file("bench_pulsePhase_source.fits");
+    std::string ev_file("bench_pulsePhase.fits");
+
+    bool succeeded = true;
+    for (std::vector<tip::Index_t>::const_iterator num_itor = num_event_cont.begin(); num_itor != num_event_cont.end();
+      ++num_itor) {
+      // Create a synthetic event file for this number of events.
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      double time_start = 0.;
+      double time_stop = 0.;
+      createEventFile(template_file, source_file, *num_itor, span, time_start, time_stop);
+      createScFile(sc_template_file, sc_file, time_start, time_stop);
+      double generation_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      for (BenchCaseCont::const_iterator case_itor = case_cont.begin(); case_itor != case_cont.end(); ++case_itor) {
+        if (std::string::npos == case_itor->m_name.find(case_pattern)) continue;
+
+        // Run the case on a fresh copy of the synthetic event file.
+        start = std::chrono::steady_clock::now();
+        tip::IFileSvc::instance().openFile(source_file).copyFile(ev_file, true);
+        double copy_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ParCont common_par_cont;
+        common_par_cont.push_back(std::make_pair("evfile", ev_file));
+        common_par_cont.push_back(std::make_pair("scfile", sc_file));
+        common_par_cont.push_back(std::make_pair("matchsolareph", "NONE"));
+        common_par_cont.push_back(std::make_pair("barytol", bary_tol));
+        common_par_cont.push_back(std::make_pair("nthreads", num_thread));
+        common_par_cont.push_back(std::make_pair("chatter", "0"));
+        common_par_cont.push_back(std::make_pair("clobber", "yes"));
+        BenchResult result = runCase(*case_itor, common_par_cont);
+        succeeded = succeeded && result.m_succeeded;
+
+        // Report the result.
+        std::ostringstream os;
+        os.precision(6);
+        os << "{\"case\": \"" << case_itor->m_name << "\", \"tool\": \"" << case_itor->m_tool_name << "\", \"events\": " <<
+          *num_itor << ", \"span_sec\": " << (time_stop - time_start) << ", \"barytol\": " << bary_tol <<
+          ", \"nthreads\": " << num_thread << ", \"succeeded\": " <<
+          (result.m_succeeded ? "true" : "false") << ", \"wall_sec\": " << result.m_wall_time << ", \"cpu_sec\": " <<
+          result.m_cpu_time << ", \"events_per_sec\": " << (*num_itor / result.m_wall_time) << ", \"peak_rss_kb\": " <<
+          result.m_peak_rss << ", \"stage_sec\": {\"generate\": " << generation_time << ", \"copy\": " << copy_time <<
+          ", \"run\": " << result.m_wall_time << "}}";
+        std::cout << os.str() << std::endl;
+      }
+    }
+    std::remove(source_file.c_str());
+    std::remove(sc_file.c_str());
+    std::remove(ev_file.c_str());
+    return succeeded ? 0 : 1;
+
+  } catch (const std::exception & x) {
+    std::cerr << "bench_pulsePhase: " << x.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,75 @@
+/** \file gtpphased.cxx
+    \brief Pulse phase assignment server that runs gtpphase jobs requested over a Unix domain socket, keeping the leap
+           second table and the solar system ephemeris loaded in memory between jobs.
+    \author Masaharu Hirayama, GSSC
+            James Peachey, HEASARC/GSSC
+
+    Usage: gtpphased [-j max_job] [-l leapsecfile] [-s solareph] [-d psrdbcache] socket_name
+           gtpphased -c socket_name [name=value ...]
+
+    The first form runs the server, which runs up to max_job jobs (4 by default) at the same time. The values of
+    leapsecfile, solareph and psrdbcache are used by all jobs unless overridden by a job. The second form requests a
+    job with the given parameters of gtpphase, writes the messages from the job to the standard output, and exits with
+    the exit status of the job.
+*/
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "PhaseServer.h"
+
+#include "timeSystem/EventTimeHandler.h"
+#include "timeSystem/GlastTimeHandler.h"
+
+// List supported event file format(s).
+timeSystem::EventTimeHandlerFactory<timeSystem::GlastScTimeHandler> glast_sctime_handler;
+
+int main(int argc, char ** argv) {
+  try {
+    // Request a job to a server, if requested.
+    if (argc >= 3 && std::string("-c") == argv[1]) {
+      PhaseServer::ParCont par_cont;
+      for (int arg_index = 3; arg_index < argc; ++arg_index) {
+        std::string arg(argv[arg_index]);
+        std::string::size_type equal_pos = arg.find('=');
+        if (std::string::npos == equal_pos) throw std::runtime_error("Invalid parameter \"" + arg + "\"");
+        par_cont.push_back(std::make_pair(arg.substr(0, equal_pos), arg.substr(equal_pos + 1)));
+      }
+      return PhaseServer::submitJob(argv[2], par_cont, std::cout);
+    }
+
+    // Read command-line options of the server.
+    long max_job = 4;
+    std::string leap_sec_file("DEFAULT");
+    std::string solar_eph("JPL DE405");
+    std::string psrdb_cache("NONE");
+    std::string socket_name;
+    for (int arg_index = 1; arg_index < argc; ++arg_index) {
+      std::string arg(argv[arg_index]);
+      if (("-j" == arg || "-l" == arg || "-s" == arg || "-d" == arg) && arg_index + 1 < argc) {
+        std::string value(argv[++arg_index]);
+        if ("-j" == arg) max_job = std::atol(value.c_str());
+        else if ("-l" == arg) leap_sec_file = value;
+        else if ("-s" == arg) solar_eph = value;
+        else psrdb_cache = value;
+      } else if (socket_name.empty()) {
+        socket_name = arg;
+      } else {
+        throw std::runtime_error("Invalid argument \"" + arg + "\"");
+      }
+    }
+    if (socket_name.empty()) throw std::runtime_error("Name of a socket must be given");
+
+    // Load resources, and serve jobs.
+    PhaseServer server(socket_name, max_job);
+    server.loadResource(leap_sec_file, solar_eph, psrdb_cache);
+    server.run();
+    return 0;
+
+  } catch (const std::exception & x) {
+    std::cerr << "gtpphased: " << x.what() << std::endl;
+    return 1;
+  }
+}
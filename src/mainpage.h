@@ -13,6 +13,13 @@ phase to the PULSE_PHASE column of the event file.
 The application gtophase operates on an event file to compute
 the orbital phase for the time of each event, and writes this
 phase to the ORBITAL_PHASE column of the event file.
+The server gtpphased runs gtpphase jobs requested over a Unix
+domain socket, keeping the leap second table and the solar system
+ephemeris loaded in memory between jobs.
+The library also provides the PhaseEngine class, which computes
+pulse or orbital phases for arrays of event times in memory, with
+the same arrival time corrections as the applications, for use by
+other programs.
 
     \section parameters Parameters
 
@@ -187,6 +194,23 @@ p2 = 0. [double]
     Name of the field containing the time values for temporal
     analysis.
 
+(outfile = NONE) [file name]
+    Name of output event file. If outfile is NONE
+    (case-insensitive), phases are written into the input event
+    file. Otherwise, the input event file is copied into the output
+    file, phases are written into the copy, and the input event file
+    is left intact. This is not a streaming copy: the whole input
+    event file is copied before phases are computed, a phase column
+    not present in the input is then added to the copy, which
+    rewrites the event table, and phases are finally written into
+    the event table of the copy. The output file therefore costs as
+    much input and output as copying the event file and processing
+    the copy in place. In this case, evfile must name a single event
+    file. If evfile is a dash (-), the input event file is read
+    from the standard input. If outfile is a dash (-), the output
+    event file is written to the standard output, and messages of
+    the tool are written to the standard error instead.
+
 (sctable = SC_DATA) [string]
     Name of the FITS table containing the spacecraft data.
 
@@ -199,6 +223,285 @@ p2 = 0. [double]
     be applied regardless of the source of the ephemeris used, whereas
     phi0 is used only when ephstyle is FREQ or PER.
 
+(ophasefield = NONE) [string]
+    Name of the output column to contain the assigned orbital phase.
+    If ophasefield is not NONE (case-insensitive), orbital phases are
+    computed along with pulse phases from the same corrected event
+    times, and are written into this column, in the same pass over the
+    event file(s). This saves running gtophase separately for a binary
+    pulsar. An orbital ephemeris for the pulsar must be available in
+    the pulsar database. Orbital phases are computed from the same
+    corrected event times as pulse phases, which must therefore be
+    corrected in the same way as in gtophase, i.e., with both the
+    barycentric corrections and the binary demodulation applied. The
+    tool stops with an error if the tcorrect parameter selects other
+    corrections, e.g., tcorrect=BARY, with which orbital phases would
+    not match results of gtophase.
+
+(ophaseoffset = 0.) [double]
+    Global offset applied to all assigned orbital phases. This
+    parameter only has effect if ophasefield is not NONE.
+
+(blocksize = 10000) [integer]
+    Number of events to be processed at a time. Times of this many
+    events are read into memory, phases are computed for all of them,
+    and then the phases are written into the output column at once.
+    Larger values reduce the overhead of accessing the event file, at
+    the expense of memory usage. The computed phases do not depend on
+    this parameter.
+
+(nthreads = 1) [integer]
+    Number of threads to compute phases with. Pulse phases of events
+    in a block are evaluated from polynomials in parallel. Other
+    phases, such as orbital phases and pulse phases computed exactly,
+    are computed by one thread, because the libraries computing them
+    are not reentrant. If nthreads is 0, as many threads as the number
+    of available processor cores will be used. The computed phases do
+    not depend on this parameter.
+
+(barytol = 0.) [real]
+    Tolerance of barycentric corrections in seconds. If barytol is
+    positive, barycentric corrections are not computed for each event;
+    instead, the difference between barycentric and spacecraft arrival
+    times is tabulated between rows of the spacecraft file, and is
+    interpolated for each event with an error of no more than barytol
+    seconds. The error is bounded by the fourth derivative of the
+    difference, which is derived from the spacecraft positions in the
+    rows and from the orbit of the Earth. The difference is tabulated
+    between two rows only if enough events fall between them, and it
+    is computed exactly for each event otherwise. This saves
+    computation time for event files with many events, and costs
+    little for sparse event files. A value of
+    1.e-7 or smaller keeps the interpolation error well below the
+    accuracy of barycentric corrections themselves. Pulse phases are
+    then also evaluated from polynomials, each of which is checked to
+    agree with the pulsar ephemerides within 1.e-9 cycles across its
+    time span. If barytol is 0, barycentric corrections and pulse
+    phases are computed for each event exactly.
+
+(filethreads = 1) [integer]
+    Number of event files to process concurrently, when multiple event
+    files are given to evfile parameter by a list file. Each event
+    file is processed by its own copy of the pulsar ephemerides and
+    its own handles of the event file and the spacecraft file, while
+    reading and writing of files, arrival time corrections and phase
+    computation by the pulsar ephemerides are done by one file at a
+    time, and only evaluation of polynomials of pulse phases is done
+    concurrently. Each event file uses as many threads as given by
+    nthreads parameter for phase computation. If filethreads is 0, as
+    many event files as the number of available processor cores will
+    be processed concurrently. The computed phases do not depend on
+    this parameter.
+
+(perfreport = no) [bool]
+    If perfreport is yes, the application will report the wall-clock
+    time and the CPU time spent in each stage of processing, such as
+    reading event times, arrival time corrections, phase computation,
+    and writing phases, along with counts of events and of searches
+    for ephemerides. The report is also written if perffile is not
+    NONE, or if chatter is 4 or greater.
+
+(perffile = NONE) [file name]
+    Name of the file to write the report of perfreport parameter to,
+    in JSON format. If perffile is NONE, no file will be written.
+
+(incremental = no) [bool]
+    If incremental is yes, the application will record a fingerprint
+    of the phase computation, and the number of events in the event
+    table, in header keywords of the event table. The fingerprint is
+    computed from the values of the parameters which affect phase
+    values, and the names, the sizes and the modification times of
+    the pulsar ephemerides database file(s). Along with it, the range
+    of times of events corrected with spacecraft positions is
+    recorded in header keywords, with a fingerprint of the rows of
+    the spacecraft file around those times. If the application is run
+    again on the same event file with the same fingerprint, and the
+    rows of the spacecraft file around the recorded times are
+    unchanged, phases will be computed only for events appended to
+    the event table after the previous run. Spacecraft data appended
+    to the spacecraft file to cover the appended events do not change
+    the recorded rows, so that a spacecraft file growing with the
+    event file does not make phases of all events computed again.
+
+(psrdbcache = NONE) [string]
+    Name of the directory to keep snapshots of the pulsar ephemerides
+    database in. If psrdbcache is not NONE, the ephemerides for the
+    pulsar given by psrname parameter are selected from the database
+    file(s) given by psrdbfile parameter, and they are saved in a
+    small FITS database file in this directory. Later runs for the
+    same pulsar load the snapshot instead of the whole database,
+    unless the size, the modification time, or the contents of any of
+    the database files have changed, in which case the snapshot is
+    rebuilt. The directory must exist and be writable. This
+    parameter has no effect if psrname is ANY.
+
+(timeorder = yes) [bool]
+    If timeorder is yes, event times are checked to be in ascending
+    order while events are processed in blocks. From the first block
+    out of order, the rest of events in the table are sorted by time
+    before arrival time corrections and phases are computed, and the
+    phases are written back to the rows of the original events. Event
+    files merged from several observations need not be sorted, and
+    processing their events in time order lets interpolated
+    barycentric corrections and ephemerides be reused across
+    neighbouring events. If timeorder is no, events are always
+    processed in the order of rows. Sorting requires event times of
+    the rest of an event table in memory, while an event table sorted
+    by time is processed a block at a time, as with timeorder=no.
+
+(barycol = NONE) [string]
+    Name of the column of the event file(s) to cache arrival times in,
+    after barycentric corrections and binary demodulation. If barycol
+    is not NONE, the column is created if not existing, and the
+    corrected arrival times are written into it in seconds since the
+    reference MJD of the event table in TDB, along with header
+    keywords BARYCFP and BARYCNR which record a fingerprint of the
+    inputs of the corrections and the number of events. The inputs
+    are the time column, the solar system ephemeris, the tolerances,
+    the leap seconds file, the source position(s), and the orbital
+    ephemerides if binary demodulation is applied; spin ephemerides
+    are not. The rows of the spacecraft file used for the corrections
+    are recorded separately in the same way as incremental parameter
+    does. Later runs with the same inputs read arrival times from the
+    column instead of computing corrections, reading only the
+    recorded rows of the spacecraft file to check that they are
+    unchanged, so that rephasing after an update of spin ephemerides
+    costs little more than reading and writing columns.
+    The column must differ from the timefield column.
+
+(psrlist = NONE) [file name]
+    Name of a text file listing additional pulsars whose pulse phases
+    are computed in the same pass over the event file(s) as those of
+    the pulsar given by psrname parameter. Each line of the file
+    consists of the name of the output column, followed by the name
+    of the pulsar, for example "PHASE_J1959 PSR J1959+2048". Blank
+    lines and lines starting with # are ignored. Event times are read
+    only once, and the spacecraft file is opened only once per event
+    file, with barycentric corrections computed for the position of
+    each pulsar given by its spin ephemerides. Ephemerides of each
+    pulsar are selected by name from the database file(s) given by
+    psrdbfile parameter, using snapshots in the directory given by
+    psrdbcache parameter unless it is NONE. Binary demodulation is
+    applied to each pulsar as allowed by tcorrect parameter, and
+    pphaseoffset is added to all pulse phases. The pulse profile,
+    periodicity tests, the ephemeris search and the cache column of
+    arrival times apply to the pulsar given by psrname parameter only.
+    Arrival times of the additional pulsars are always corrected from
+    the event times in the timefield column, even if those of the
+    pulsar given by psrname parameter are read from the cache column.
+
+(roiradius = 0.) [double]
+    Radius of the region of interest around the pulsar in degrees.
+    If roiradius is positive, the angular distance of each event
+    from the pulsar is computed from the RA and DEC columns of the
+    event file(s), and arrival time corrections and phases are
+    computed only for events within roiradius, which are often a
+    small fraction of events in an all-sky event file. Phases of the
+    other events are set to NaN. The region is centered on the
+    source position used for barycentric corrections, or on the
+    position given by the first spin ephemeris at its epoch if
+    positions vary among spin ephemerides. Each pulsar listed in the
+    file given by psrlist parameter has its own region of the same
+    radius. If roiradius is 0, phases of all events are computed.
+
+(scwindow = 0) [integer]
+    Number of rows of the spacecraft data table kept in memory. If
+    scwindow is positive, rows of the spacecraft file are read
+    scwindow rows at a time around the arrival times of events, so
+    that memory use does not depend on the length of the spacecraft
+    file. Rows are located through a time index which holds the start
+    time of every scwindow-th row, first by interpolation search in
+    the index and then by a cursor which follows event times, so that
+    locating a row takes constant time for events in time order.
+    Spacecraft positions are interpolated linearly between rows and
+    scaled to the linearly interpolated distance from the center of
+    the Earth. If scwindow is 0, the whole spacecraft file is loaded.
+
+(scindex = NONE) [file name]
+    Name of the file to keep the time index of the spacecraft file in,
+    when scwindow is positive. The index is loaded from the file if it
+    was built for the same spacecraft file, identified by its name,
+    size and modification time, and the same scwindow. Otherwise the
+    index is built by reading the spacecraft file and saved into the
+    file. If scindex is NONE, the index is built at every run.
+
+(nbins = 0) [integer]
+    Number of bins of the pulse profile to be accumulated while
+    phases are assigned. If nbins is positive, the pphasefield
+    column of all events is histogrammed in nbins bins of equal width
+    from 0 to 1, and the histogram is written into the file given by
+    profile parameter, so that the event file(s) need not be read
+    again to obtain the pulse profile. Events whose phases are up to
+    date in incremental mode are included with the phases already in
+    the event file(s). If nbins is 0, no histogram is accumulated.
+
+(profile = NONE) [file name]
+    Name of the output file of the pulse profile, which must be
+    given if nbins is positive. The file contains a binary table named
+    PROFILE, with columns PHASE_MIN and PHASE_MAX for the edges of
+    each bin, COUNTS for the sum of weights of events in each bin, and
+    ERROR for the square root of the sum of squared weights.
+
+(weightfield = NONE) [string]
+    Name of the column of the event file(s) whose values are used as
+    weights of events in the pulse profile, such as a column of
+    probabilities that events come from the pulsar. If weightfield is
+    NONE, each event counts as 1.
+
+(htest = no) [bool]
+    If htest is yes, sums of trigonometric moments of the pulse phases
+    are accumulated while phases are assigned, and the H-test
+    statistic (de Jager, Raubenheimer & Swanepoel 1989) over up to 20
+    harmonics and the Z^2_m statistic with zharmonics harmonics are
+    reported at the end, along with their chance probabilities and
+    the equivalent significance in units of the standard deviation of
+    a normal distribution. The chance probability of the H-test
+    statistic H is exp(-0.4 * H) (de Jager & Buesching 2010), and the
+    Z^2_m statistic follows the chi-square distribution with 2 * m
+    degrees of freedom. Events are weighted by the column given by
+    weightfield parameter unless it is NONE. Events whose phases are
+    up to date in incremental mode are included with the phases
+    already in the event file(s).
+
+(zharmonics = 2) [integer]
+    Number of harmonics of the Z^2_m statistic, from 1 to 20, used by
+    both htest and searchfile parameters.
+
+(searchfile = NONE) [file name]
+    Name of the output file of an ephemeris search. If searchfile is
+    not NONE, arrival times of all events after all corrections are
+    kept in memory along with their pulse phases, and the H-test and
+    the Z^2_m statistics are computed for a grid of nf0 trial
+    frequencies spaced by df0 and nf1 trial frequency derivatives
+    spaced by df1, centered on the frequency and its derivative of
+    the spin ephemeris at its epoch. Arrival time corrections are
+    applied only once for all trials, and trials are evaluated by as
+    many threads as requested by nthreads parameter. The file
+    contains a binary table named SEARCH, with columns DF0 and DF1 for
+    the offsets of each trial from the ephemeris, H and H_NHARM for
+    the H-test statistic and the number of harmonics at which it is
+    attained, H_SIGMA for its significance, and Z2M for the Z^2_m
+    statistic with zharmonics harmonics. The trial with the largest H
+    is also reported. Pulse phases written into the event file(s) are
+    those by the ephemeris. The search requires exactly one spin
+    ephemeris, such as that given by ephstyle = FREQ or PER, and phases
+    of all events are computed even in incremental mode. Events are
+    weighted by the column given by weightfield parameter unless it is
+    NONE.
+
+(nf0 = 1) [integer]
+    Number of trial frequencies of the ephemeris search.
+
+(df0 = 0.) [double]
+    Step of trial frequencies of the ephemeris search, in Hz.
+
+(nf1 = 1) [integer]
+    Number of trial frequency derivatives of the ephemeris search.
+
+(df1 = 0.) [double]
+    Step of trial frequency derivatives of the ephemeris search, in
+    Hz/s.
+
 (leapsecfile = DEFAULT) [file name]
     Name of the file containing the name of the leap second table, in
     OGIP-compliant leap second table format. If leapsecfile is the
@@ -293,6 +596,23 @@ dec [double]
     Name of the field containing the time values for temporal
     analysis.
 
+(outfile = NONE) [file name]
+    Name of output event file. If outfile is NONE
+    (case-insensitive), phases are written into the input event
+    file. Otherwise, the input event file is copied into the output
+    file, phases are written into the copy, and the input event file
+    is left intact. This is not a streaming copy: the whole input
+    event file is copied before phases are computed, a phase column
+    not present in the input is then added to the copy, which
+    rewrites the event table, and phases are finally written into
+    the event table of the copy. The output file therefore costs as
+    much input and output as copying the event file and processing
+    the copy in place. In this case, evfile must name a single event
+    file. If evfile is a dash (-), the input event file is read
+    from the standard input. If outfile is a dash (-), the output
+    event file is written to the standard output, and messages of
+    the tool are written to the standard error instead.
+
 (sctable = SC_DATA) [string]
     Name of the FITS table containing the spacecraft data.
 
@@ -302,6 +622,183 @@ dec [double]
 (ophaseoffset = 0.) [double]
     Global offset applied to all assigned orbital phases.
 
+(blocksize = 10000) [integer]
+    Number of events to be processed at a time. Times of this many
+    events are read into memory, phases are computed for all of them,
+    and then the phases are written into the output column at once.
+    Larger values reduce the overhead of accessing the event file, at
+    the expense of memory usage. The computed phases do not depend on
+    this parameter.
+
+(nthreads = 1) [integer]
+    Number of threads to compute phases with. Pulse phases of events
+    in a block are evaluated from polynomials in parallel. Other
+    phases, such as orbital phases and pulse phases computed exactly,
+    are computed by one thread, because the libraries computing them
+    are not reentrant. If nthreads is 0, as many threads as the number
+    of available processor cores will be used. The computed phases do
+    not depend on this parameter.
+
+(barytol = 0.) [real]
+    Tolerance of barycentric corrections in seconds. If barytol is
+    positive, barycentric corrections are not computed for each event;
+    instead, the difference between barycentric and spacecraft arrival
+    times is tabulated between rows of the spacecraft file, and is
+    interpolated for each event with an error of no more than barytol
+    seconds. The error is bounded by the fourth derivative of the
+    difference, which is derived from the spacecraft positions in the
+    rows and from the orbit of the Earth. The difference is tabulated
+    between two rows only if enough events fall between them, and it
+    is computed exactly for each event otherwise. This saves
+    computation time for event files with many events, and costs
+    little for sparse event files. A value of
+    1.e-7 or smaller keeps the interpolation error well below the
+    accuracy of barycentric corrections themselves. If barytol is 0,
+    barycentric corrections are computed for each event exactly.
+
+(filethreads = 1) [integer]
+    Number of event files to process concurrently, when multiple event
+    files are given to evfile parameter by a list file. Each event
+    file is processed by its own copy of the pulsar ephemerides and
+    its own handles of the event file and the spacecraft file, while
+    reading and writing of files, arrival time corrections and phase
+    computation by the pulsar ephemerides are done by one file at a
+    time, and only evaluation of polynomials of pulse phases is done
+    concurrently. Each event file uses as many threads as given by
+    nthreads parameter for phase computation. If filethreads is 0, as
+    many event files as the number of available processor cores will
+    be processed concurrently. The computed phases do not depend on
+    this parameter.
+
+(perfreport = no) [bool]
+    If perfreport is yes, the application will report the wall-clock
+    time and the CPU time spent in each stage of processing, such as
+    reading event times, arrival time corrections, phase computation,
+    and writing phases, along with counts of events and of searches
+    for ephemerides. The report is also written if perffile is not
+    NONE, or if chatter is 4 or greater.
+
+(perffile = NONE) [file name]
+    Name of the file to write the report of perfreport parameter to,
+    in JSON format. If perffile is NONE, no file will be written.
+
+(incremental = no) [bool]
+    If incremental is yes, the application will record a fingerprint
+    of the phase computation, and the number of events in the event
+    table, in header keywords of the event table. The fingerprint is
+    computed from the values of the parameters which affect phase
+    values, and the names, the sizes and the modification times of
+    the pulsar ephemerides database file(s). Along with it, the range
+    of times of events corrected with spacecraft positions is
+    recorded in header keywords, with a fingerprint of the rows of
+    the spacecraft file around those times. If the application is run
+    again on the same event file with the same fingerprint, and the
+    rows of the spacecraft file around the recorded times are
+    unchanged, phases will be computed only for events appended to
+    the event table after the previous run. Spacecraft data appended
+    to the spacecraft file to cover the appended events do not change
+    the recorded rows, so that a spacecraft file growing with the
+    event file does not make phases of all events computed again.
+
+(psrdbcache = NONE) [string]
+    Name of the directory to keep snapshots of the pulsar ephemerides
+    database in. If psrdbcache is not NONE, the ephemerides for the
+    pulsar given by psrname parameter are selected from the database
+    file(s) given by psrdbfile parameter, and they are saved in a
+    small FITS database file in this directory. Later runs for the
+    same pulsar load the snapshot instead of the whole database,
+    unless the size, the modification time, or the contents of any of
+    the database files have changed, in which case the snapshot is
+    rebuilt. The directory must exist and be writable. This
+    parameter has no effect if psrname is ANY.
+
+(timeorder = yes) [bool]
+    If timeorder is yes, event times are checked to be in ascending
+    order while events are processed in blocks. From the first block
+    out of order, the rest of events in the table are sorted by time
+    before arrival time corrections and phases are computed, and the
+    phases are written back to the rows of the original events. Event
+    files merged from several observations need not be sorted, and
+    processing their events in time order lets interpolated
+    barycentric corrections and ephemerides be reused across
+    neighbouring events. If timeorder is no, events are always
+    processed in the order of rows. Sorting requires event times of
+    the rest of an event table in memory, while an event table sorted
+    by time is processed a block at a time, as with timeorder=no.
+
+(barycol = NONE) [string]
+    Name of the column of the event file(s) to cache arrival times in,
+    after barycentric corrections and binary demodulation. If barycol
+    is not NONE, the column is created if not existing, and the
+    corrected arrival times are written into it in seconds since the
+    reference MJD of the event table in TDB, along with header
+    keywords BARYCFP and BARYCNR which record a fingerprint of the
+    inputs of the corrections and the number of events. The inputs
+    are the time column, the solar system ephemeris, the tolerances,
+    the leap seconds file, the source position(s), and the orbital
+    ephemerides if binary demodulation is applied; spin ephemerides
+    are not. The rows of the spacecraft file used for the corrections
+    are recorded separately in the same way as incremental parameter
+    does. Later runs with the same inputs read arrival times from the
+    column instead of computing corrections, reading only the
+    recorded rows of the spacecraft file to check that they are
+    unchanged, so that rephasing after an update of spin ephemerides
+    costs little more than reading and writing columns.
+    The column must differ from the timefield column.
+
+(roiradius = 0.) [double]
+    Radius of the region of interest around the binary system in
+    degrees. If roiradius is positive, the angular distance of each
+    event from the source is computed from the RA and DEC columns of
+    the event file(s), and arrival time corrections and orbital
+    phases are computed only for events within roiradius. Phases of
+    the other events are set to NaN. If roiradius is 0, phases of all
+    events are computed.
+
+(scwindow = 0) [integer]
+    Number of rows of the spacecraft data table kept in memory. If
+    scwindow is positive, rows of the spacecraft file are read
+    scwindow rows at a time around the arrival times of events, so
+    that memory use does not depend on the length of the spacecraft
+    file. Rows are located through a time index which holds the start
+    time of every scwindow-th row, first by interpolation search in
+    the index and then by a cursor which follows event times, so that
+    locating a row takes constant time for events in time order.
+    Spacecraft positions are interpolated linearly between rows and
+    scaled to the linearly interpolated distance from the center of
+    the Earth. If scwindow is 0, the whole spacecraft file is loaded.
+
+(scindex = NONE) [file name]
+    Name of the file to keep the time index of the spacecraft file in,
+    when scwindow is positive. The index is loaded from the file if it
+    was built for the same spacecraft file, identified by its name,
+    size and modification time, and the same scwindow. Otherwise the
+    index is built by reading the spacecraft file and saved into the
+    file. If scindex is NONE, the index is built at every run.
+
+(nbins = 0) [integer]
+    Number of bins of the orbital light curve to be accumulated while
+    phases are assigned. If nbins is positive, the ophasefield
+    column of all events is histogrammed in nbins bins of equal width
+    from 0 to 1, and the histogram is written into the file given by
+    profile parameter, so that the event file(s) need not be read
+    again to obtain the orbital light curve. Events whose phases are up to
+    date in incremental mode are included with the phases already in
+    the event file(s). If nbins is 0, no histogram is accumulated.
+
+(profile = NONE) [file name]
+    Name of the output file of the orbital light curve, which must be
+    given if nbins is positive. The file contains a binary table named
+    PROFILE, with columns PHASE_MIN and PHASE_MAX for the edges of
+    each bin, COUNTS for the sum of weights of events in each bin, and
+    ERROR for the square root of the sum of squared weights.
+
+(weightfield = NONE) [string]
+    Name of the column of the event file(s) whose values are used as
+    weights of events in the orbital light curve, such as a column of
+    probabilities that events come from the pulsar. If weightfield is
+    NONE, each event counts as 1.
+
 (leapsecfile = DEFAULT) [file name]
     Name of the file containing the name of the leap second table, in
     OGIP-compliant leap second table format. If leapsecfile is the
@@ -315,6 +812,25 @@ dec [double]
     will not report any ephemeris status.
 \endverbatim
 
+    \subsection gtpphased_usage gtpphased Usage
+\verbatim
+gtpphased [-j max_job] [-l leapsecfile] [-s solareph] [-d psrdbcache] socket_name
+    Run the server, listening to the Unix domain socket socket_name.
+    Up to max_job jobs (4 by default) run at the same time, each in
+    its own process forked from the server, which inherits the leap
+    second table and the solar system ephemeris loaded by the server
+    at startup. The values of leapsecfile, solareph and psrdbcache
+    are used as the values of gtpphase parameters of the same names
+    for all jobs, unless a job gives other values.
+
+gtpphased -c socket_name [name=value ...]
+    Request a job to the server with the given gtpphase parameters,
+    write the messages from the job to the standard output, and exit
+    with the exit status of the job. Parameters not given take their
+    values from the parameter file of gtpphase, as for gtpphase run
+    with no prompts.
+\endverbatim
+
     \section open_issues Open Issues
 \verbatim
 None.
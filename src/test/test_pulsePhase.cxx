@@ -3,26 +3,54 @@
     \authors Masaharu Hirayama, GSSC,
              James Peachey, HEASARC/GSSC
 */
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
-
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "BaryDelayCache.h"
+#include "CachedEphChooser.h"
+#include "DelayTable.h"
+#include "EphemerisSearch.h"
 #include "OrbitalPhaseApp.h"
+#include "PeriodicityTest.h"
+#include "PhaseEngine.h"
+#include "PhaseProfile.h"
+#include "PhaseServer.h"
 #include "PulsePhaseApp.h"
 
+#include "pulsarDb/EphChooser.h"
+#include "pulsarDb/EphComputer.h"
+#include "pulsarDb/FrequencyEph.h"
+
 #include "st_app/AppParGroup.h"
 #include "st_app/StApp.h"
 #include "st_app/StAppFactory.h"
 
+#include "timeSystem/AbsoluteTime.h"
+#include "timeSystem/ElapsedTime.h"
 #include "timeSystem/EventTimeHandler.h"
 #include "timeSystem/GlastTimeHandler.h"
+#include "timeSystem/MjdFormat.h"
 #include "timeSystem/PulsarTestApp.h"
 
 #include "tip/IFileSvc.h"
+#include "tip/Table.h"
 #include "tip/TipFile.h"
 
 static const std::string s_cvs_id("$Name:  $");
@@ -280,6 +308,51 @@ class PulsePhaseTestApp : public timeSystem::PulsarTestApp {
 
     /// \brief Test OrbitalPhaseApp class.
     virtual void testOrbitalPhaseApp();
+
+    /// \brief Test PhaseServer class.
+    virtual void testPhaseServer();
+
+    /// \brief Test PhaseEngine class.
+    virtual void testPhaseEngine();
+
+    /// \brief Test PhaseProfile class.
+    virtual void testPhaseProfile();
+
+    /// \brief Test PeriodicityTest class.
+    virtual void testPeriodicityTest();
+
+    /// \brief Test EphemerisSearch class.
+    virtual void testEphemerisSearch();
+
+    /// \brief Test CachedEphChooser class.
+    virtual void testCachedEphChooser();
+
+    /// \brief Test DelayTable class.
+    virtual void testDelayTable();
+
+  private:
+    /** \brief Read values of a column in the EVENTS extension of an event file.
+        \param file_name Name of the event file.
+        \param field_name Name of the column to read.
+        \param value_cont Container to store the values in.
+    */
+    void readEventColumn(const std::string & file_name, const std::string & field_name,
+      std::vector<double> & value_cont);
+
+    /** \brief Compare phases in a column of an event file with those in a column of a reference event file, and
+               report the first event whose phases differ by more than a given tolerance, after subtracting a given
+               phase shift and modulo one cycle. A tolerance of zero requires phases identical bit for bit. NaN phases
+               only match NaN phases. Return the largest difference found, or infinity if the phases do not match.
+        \param file_name Name of the event file to check.
+        \param field_name Name of the column to check.
+        \param ref_file_name Name of the reference event file.
+        \param ref_field_name Name of the reference column.
+        \param tolerance Tolerance of differences in phase, or infinity not to report any difference.
+        \param phase_shift Phase shift expected from the reference phases.
+    */
+    double comparePhaseColumn(const std::string & file_name, const std::string & field_name,
+      const std::string & ref_file_name, const std::string & ref_field_name, double tolerance,
+      double phase_shift = 0.);
 };
 
 PulsePhaseTestApp::PulsePhaseTestApp(): PulsarTestApp("pulsePhase") {
@@ -291,6 +364,64 @@ void PulsePhaseTestApp::runTest() {
   // Test applications.
   testPulsePhaseApp();
   testOrbitalPhaseApp();
+  testPhaseServer();
+
+  // Test library interface.
+  testPhaseEngine();
+  testPhaseProfile();
+  testPeriodicityTest();
+  testEphemerisSearch();
+  testCachedEphChooser();
+  testDelayTable();
+}
+
+void PulsePhaseTestApp::readEventColumn(const std::string & file_name, const std::string & field_name,
+  std::vector<double> & value_cont) {
+  value_cont.clear();
+  std::unique_ptr<const tip::Table> table(tip::IFileSvc::instance().readTable(file_name, "EVENTS"));
+  for (tip::Table::ConstIterator itor = table->begin(); itor != table->end(); ++itor) {
+    double value = 0.;
+    (*itor)[field_name].get(value);
+    value_cont.push_back(value);
+  }
+}
+
+double PulsePhaseTestApp::comparePhaseColumn(const std::string & file_name, const std::string & field_name,
+  const std::string & ref_file_name, const std::string & ref_field_name, double tolerance, double phase_shift) {
+  std::vector<double> phase_cont;
+  std::vector<double> ref_phase_cont;
+  readEventColumn(file_name, field_name, phase_cont);
+  readEventColumn(ref_file_name, ref_field_name, ref_phase_cont);
+  if (phase_cont.size() != ref_phase_cont.size()) {
+    err() << "Number of events differs between " << file_name << " and " << ref_file_name << "." << std::endl;
+    return std::numeric_limits<double>::infinity();
+  }
+
+  double max_difference = 0.;
+  bool reported = false;
+  for (std::vector<double>::size_type event_index = 0; event_index < phase_cont.size(); ++event_index) {
+    double phase = phase_cont[event_index];
+    double ref_phase = ref_phase_cont[event_index];
+    double difference = 0.;
+    bool matched = true;
+    if (std::isnan(phase) || std::isnan(ref_phase)) {
+      matched = (std::isnan(phase) && std::isnan(ref_phase));
+      difference = matched ? 0. : std::numeric_limits<double>::infinity();
+    } else {
+      difference = phase - ref_phase - phase_shift;
+      difference = std::fabs(difference - std::floor(difference + .5));
+      matched = (0. == tolerance ? 0 == std::memcmp(&phase, &ref_phase, sizeof(double)) : difference <= tolerance);
+    }
+    max_difference = std::max(max_difference, difference);
+    if (!matched && !reported) {
+      err() << "Phase " << phase << " of event " << event_index << " in column " << field_name << " of " << file_name <<
+        " differs from " << ref_phase << " in column " << ref_field_name << " of " << ref_file_name;
+      if (0. != phase_shift) err() << " shifted by " << phase_shift;
+      err() << "." << std::endl;
+      reported = true;
+    }
+  }
+  return max_difference;
 }
 
 void PulsePhaseTestApp::testPulsePhaseApp() {
@@ -326,6 +457,41 @@ void PulsePhaseTestApp::testPulsePhaseApp() {
   test_name_cont.push_back("par11");
   test_name_cont.push_back("par12");
   test_name_cont.push_back("par13");
+  test_name_cont.push_back("par14");
+  test_name_cont.push_back("par15");
+  test_name_cont.push_back("par16");
+  test_name_cont.push_back("par16");
+  test_name_cont.push_back("par17");
+  test_name_cont.push_back("par18");
+  test_name_cont.push_back("par19");
+  test_name_cont.push_back("par20");
+  test_name_cont.push_back("par21");
+  test_name_cont.push_back("par22");
+  test_name_cont.push_back("par23");
+  test_name_cont.push_back("par24");
+  test_name_cont.push_back("par25");
+  test_name_cont.push_back("par26");
+  test_name_cont.push_back("par27");
+  test_name_cont.push_back("par28");
+  test_name_cont.push_back("par29");
+  test_name_cont.push_back("par30");
+  test_name_cont.push_back("par31");
+  test_name_cont.push_back("par32");
+  test_name_cont.push_back("par33");
+  test_name_cont.push_back("par34");
+  test_name_cont.push_back("par35");
+  test_name_cont.push_back("par36");
+  test_name_cont.push_back("par37");
+  test_name_cont.push_back("par38");
+  test_name_cont.push_back("par39");
+  test_name_cont.push_back("par40");
+  test_name_cont.push_back("par41");
+  test_name_cont.push_back("par42");
+  test_name_cont.push_back("par43");
+  test_name_cont.push_back("par44");
+  test_name_cont.push_back("par45");
+  test_name_cont.push_back("par46");
+  test_name_cont.push_back("par47");
 
   // Prepare files to be used in the tests.
   std::string ev_file = prependDataPath("testevdata_1day_unordered.fits");
@@ -335,6 +501,28 @@ void PulsePhaseTestApp::testPulsePhaseApp() {
   std::string ev_file_long = prependDataPath("testevdata_1year.fits");
   std::string sc_file_long = prependDataPath("testscdata_1year.fits");
 
+  // Choose the radius of the region of interest for par38, so that about a half of the events are outside the region
+  // around the source position of par1b.
+  const std::pair<double, double> roi_center(85.0482, -69.3319);
+  std::vector<double> separation_cont;
+  {
+    std::unique_ptr<const tip::Table> table(tip::IFileSvc::instance().readTable(ev_file, "EVENTS"));
+    for (tip::Table::ConstIterator itor = table->begin(); itor != table->end(); ++itor) {
+      double ra = 0.;
+      double dec = 0.;
+      (*itor)["RA"].get(ra);
+      (*itor)["DEC"].get(dec);
+      separation_cont.push_back(BaryDelayCache::computeSeparation(roi_center.first, roi_center.second, ra, dec));
+    }
+  }
+  double roi_radius = 0.;
+  if (!separation_cont.empty()) {
+    std::vector<double> sorted_separation_cont(separation_cont);
+    std::vector<double>::iterator median_itor = sorted_separation_cont.begin() + sorted_separation_cont.size() / 2;
+    std::nth_element(sorted_separation_cont.begin(), median_itor, sorted_separation_cont.end());
+    roi_radius = *median_itor;
+  }
+
   // Loop over parameter sets.
   for (std::list<std::string>::const_iterator test_itor = test_name_cont.begin(); test_itor != test_name_cont.end(); ++test_itor) {
     const std::string & test_name = *test_itor;
@@ -369,9 +557,36 @@ void PulsePhaseTestApp::testPulsePhaseApp() {
     pars["angtol"] = 1.e-8;
     pars["evtable"] = "EVENTS";
     pars["timefield"] = "TIME";
+    pars["outfile"] = "NONE";
     pars["sctable"] = "SC_DATA";
     pars["pphasefield"] = "PULSE_PHASE";
     pars["pphaseoffset"] = 0.;
+    pars["ophasefield"] = "NONE";
+    pars["ophaseoffset"] = 0.;
+    pars["blocksize"] = 10000;
+    pars["nthreads"] = 1;
+    pars["barytol"] = 0.;
+    pars["filethreads"] = 1;
+    pars["perfreport"] = "no";
+    pars["perffile"] = "NONE";
+    pars["incremental"] = "no";
+    pars["psrdbcache"] = "NONE";
+    pars["timeorder"] = "yes";
+    pars["barycol"] = "NONE";
+    pars["psrlist"] = "NONE";
+    pars["roiradius"] = 0.;
+    pars["scwindow"] = 0;
+    pars["scindex"] = "NONE";
+    pars["nbins"] = 0;
+    pars["profile"] = "NONE";
+    pars["weightfield"] = "NONE";
+    pars["htest"] = "no";
+    pars["zharmonics"] = 2;
+    pars["searchfile"] = "NONE";
+    pars["nf0"] = 1;
+    pars["df0"] = 0.;
+    pars["nf1"] = 1;
+    pars["df1"] = 0.;
     pars["leapsecfile"] = "DEFAULT";
     pars["reportephstatus"] = "yes";
     pars["chatter"] = 2;
@@ -772,6 +987,530 @@ void PulsePhaseTestApp::testPulsePhaseApp() {
       out_file_ref.erase();
       ignore_exception = true;
 
+    } else if ("par14" == test_name) {
+      // Test processing in small blocks of events, which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["blocksize"] = 7;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par15" == test_name) {
+      // Test phase computation in multiple threads, which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["blocksize"] = 7;
+      pars["nthreads"] = 3;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par16" == test_name) {
+      // Test interpolated barycentric corrections, which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par17" == test_name) {
+      // Test binary demodulation along with interpolated barycentric corrections, which must produce the same result
+      // as par3a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1959+2048";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      out_file_ref = prependOutrefPath(getMethod() + "_par3a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par18" == test_name) {
+      // Test writing phases into an output file, leaving the input event file intact, which must produce the same
+      // result as par1a.
+      remove(out_file.c_str());
+      pars["evfile"] = ev_file;
+      pars["outfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par19" == test_name) {
+      // Test concurrent processing of event files given by a list file, which must produce the same result as par1a
+      // for each event file.
+      std::string out_file2(getMethod() + "_" + test_name + "_2.fits");
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file2, true);
+      std::string list_file(getMethod() + "_" + test_name + ".lis");
+      remove(list_file.c_str());
+      std::ofstream ofs_list(list_file.c_str());
+      ofs_list << out_file2 << std::endl;
+      ofs_list << out_file << std::endl;
+      ofs_list.close();
+      pars["evfile"] = "@" + list_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      pars["filethreads"] = 2;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par20" == test_name) {
+      // Test orbital phase computation along with pulse phases, which must produce the same pulse phases as par3a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1959+2048";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["ophasefield"] = "ORBITAL_PHASE";
+      out_file_ref = prependOutrefPath(getMethod() + "_par3a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par21" == test_name) {
+      // Test performance report, which must not change the result of par1a.
+      std::string perf_file(getMethod() + "_" + test_name + ".json");
+      remove(perf_file.c_str());
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["perfreport"] = "yes";
+      pars["perffile"] = perf_file;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par22" == test_name) {
+      // Test loading ephemerides from a snapshot of the pulsar ephemerides database, which must produce the same result
+      // as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["psrdbcache"] = ".";
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par23" == test_name) {
+      // Test interpolated barycentric corrections with events processed in the order of rows, which must produce the
+      // same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      pars["timeorder"] = "no";
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par24" == test_name) {
+      // Test accumulation of a pulse profile, which must not change the result of par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      pars["nbins"] = 20;
+      pars["profile"] = getMethod() + "_" + test_name + "_profile.fits";
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par25" == test_name) {
+      // Test periodicity tests of pulse phases, which must not change the result of par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      pars["htest"] = "yes";
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par26" == test_name) {
+      // Test an ephemeris search around a frequency ephemeris, which must not change the result of par1b.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "FREQ";
+      pars["psrdbfile"] = "NONE";
+      pars["tcorrect"] = "BARY";
+      pars["ra"] = 85.0482;
+      pars["dec"] = -69.3319;
+      pars["ephepoch"] = 212380785.922;
+      pars["timeformat"] = "FILE";
+      pars["timesys"] = "TDB";
+      pars["phi0"] = 0.1234;
+      pars["pphaseoffset"] = -0.1234;
+      pars["f0"] = 19.83401688366839422996;
+      pars["f1"] = -1.8869945816704768775044e-10;
+      pars["f2"] = 0.;
+      pars["barytol"] = 1.e-10;
+      pars["searchfile"] = getMethod() + "_" + test_name + "_search.fits";
+      pars["nf0"] = 5;
+      pars["df0"] = 1.e-7;
+      pars["nf1"] = 3;
+      pars["df1"] = 1.e-14;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1b.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par27" == test_name) {
+      // Test selection of a region of interest covering the whole sky, which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      pars["roiradius"] = 180.;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par28" == test_name) {
+      // Test windowed access to the spacecraft file with a window smaller than the file, and a time index file,
+      // which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      pars["scwindow"] = 3;
+      std::string index_file(getMethod() + "_" + test_name + ".idx");
+      remove(index_file.c_str());
+      pars["scindex"] = index_file;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par29" == test_name || "par30" == test_name) {
+      // Test pulse phases evaluated from polynomials by one thread and by three threads, which must be identical bit
+      // for bit, and the same as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      pars["blocksize"] = 7;
+      pars["nthreads"] = ("par29" == test_name ? 1 : 3);
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par31" == test_name) {
+      // Test the incremental mode on a new event file, which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["incremental"] = "yes";
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par32" == test_name) {
+      // Test the incremental mode on the output of par31 with one parameter changed, which must recompute phases of
+      // all events. The phases are compared with those of par31 below.
+      tip::IFileSvc::instance().openFile(getMethod() + "_par31.fits").copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["incremental"] = "yes";
+      pars["pphaseoffset"] = 0.25;
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
+    } else if ("par33" == test_name || "par34" == test_name || "par35" == test_name || "par36" == test_name) {
+      // Test the cache of arrival times with the same settings as par1b. The first run (par33) writes the cache
+      // column, the second run on its output (par34) reads arrival times from the cache, and the other runs on its
+      // output with a different solar system ephemeris (par35) or a different right ascension (par36) must recompute
+      // arrival times. The phases and the fingerprints of the cache are compared below.
+      if ("par33" == test_name) {
+        tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      } else {
+        tip::IFileSvc::instance().openFile(getMethod() + "_par33.fits").copyFile(out_file, true);
+      }
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "FREQ";
+      pars["psrdbfile"] = "NONE";
+      pars["tcorrect"] = "BARY";
+      pars["ra"] = ("par36" == test_name ? 85.1482 : 85.0482);
+      pars["dec"] = -69.3319;
+      pars["ephepoch"] = 212380785.922;
+      pars["timeformat"] = "FILE";
+      pars["timesys"] = "TDB";
+      pars["phi0"] = 0.1234;
+      pars["pphaseoffset"] = -0.1234;
+      pars["f0"] = 19.83401688366839422996;
+      pars["f1"] = -1.8869945816704768775044e-10;
+      pars["f2"] = 0.;
+      pars["solareph"] = ("par35" == test_name ? "JPL DE200" : "JPL DE405");
+      pars["matchsolareph"] = "NONE";
+      pars["barycol"] = "BARY_TIME";
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
+    } else if ("par37" == test_name || "par39" == test_name || "par40" == test_name) {
+      // Test pulse phases of two pulsars computed in one pass, with the pulsar of par1a given by psrname parameter and
+      // the pulsar of par3a given in a list file. The same is tested with the cache of arrival times, which is written
+      // by par39 and read by par40 on the output of par39. Each output column is compared below with the
+      // single-pulsar run.
+      std::string list_file(getMethod() + "_" + test_name + ".lst");
+      std::ofstream ofs_list(list_file.c_str());
+      ofs_list << "# Additional pulsar with binary demodulation" << std::endl;
+      ofs_list << std::endl;
+      ofs_list << "PHASE_J1959 PSR J1959+2048" << std::endl;
+      ofs_list.close();
+      if ("par40" == test_name) {
+        tip::IFileSvc::instance().openFile(getMethod() + "_par39.fits").copyFile(out_file, true);
+      } else {
+        tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      }
+      if ("par37" != test_name) pars["barycol"] = "BARY_TIME";
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["psrlist"] = list_file;
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
+    } else if ("par38" == test_name) {
+      // Test a region of interest which holds about a half of the events, with the settings of par1b. Events outside
+      // the region must have NaN phases and NaN arrival times in the cache column, and the other events must have the
+      // phases of par1b. The phases are compared below.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "FREQ";
+      pars["psrdbfile"] = "NONE";
+      pars["tcorrect"] = "BARY";
+      pars["ra"] = roi_center.first;
+      pars["dec"] = roi_center.second;
+      pars["ephepoch"] = 212380785.922;
+      pars["timeformat"] = "FILE";
+      pars["timesys"] = "TDB";
+      pars["phi0"] = 0.1234;
+      pars["pphaseoffset"] = -0.1234;
+      pars["f0"] = 19.83401688366839422996;
+      pars["f1"] = -1.8869945816704768775044e-10;
+      pars["f2"] = 0.;
+      pars["barycol"] = "BARY_TIME";
+      pars["roiradius"] = roi_radius;
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
+    } else if ("par41" == test_name || "par42" == test_name) {
+      // Test two event files processed concurrently, each by three threads, with pulse phases evaluated from
+      // polynomials (par41) and computed exactly (par42). The phases of both event files are compared below bit for bit
+      // with those computed by one thread in par29 and par1a, respectively.
+      std::string out_file2(getMethod() + "_" + test_name + "_2.fits");
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file2, true);
+      std::string list_file(getMethod() + "_" + test_name + ".lis");
+      remove(list_file.c_str());
+      std::ofstream ofs_list(list_file.c_str());
+      ofs_list << out_file2 << std::endl;
+      ofs_list << out_file << std::endl;
+      ofs_list.close();
+      pars["evfile"] = "@" + list_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = ("par41" == test_name ? 1.e-10 : 0.);
+      pars["blocksize"] = 7;
+      pars["nthreads"] = 3;
+      pars["filethreads"] = 2;
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
+    } else if ("par43" == test_name) {
+      // Test detection of orbital phases requested without binary demodulation, which would not match gtophase.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1959+2048";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["tcorrect"] = "BARY";
+      pars["ophasefield"] = "ORBITAL_PHASE";
+
+      remove(log_file_ref.c_str());
+      std::ofstream ofs(log_file_ref.c_str());
+      std::runtime_error error("Orbital phases require both barycentric corrections and binary demodulation to be "
+        "applied to arrival times, as in gtophase");
+      app_tester.writeException(ofs, error);
+      ofs.close();
+
+      out_file.erase();
+      out_file_ref.erase();
+      ignore_exception = true;
+
+    } else if ("par44" == test_name || "par45" == test_name) {
+      // Test an event file whose event times are sorted only in the first half, with events processed in time order
+      // from the first block out of order (par44) and in the order of rows (par45). The phases are compared below bit
+      // for bit.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      {
+        std::unique_ptr<tip::Table> table(tip::IFileSvc::instance().editTable(out_file, "EVENTS"));
+        std::vector<double> time_cont;
+        for (tip::Table::Iterator itor = table->begin(); itor != table->end(); ++itor) {
+          double time = 0.;
+          (*itor)["TIME"].get(time);
+          time_cont.push_back(time);
+        }
+        std::sort(time_cont.begin(), time_cont.begin() + time_cont.size() / 2);
+        std::vector<double>::size_type event_index = 0;
+        for (tip::Table::Iterator itor = table->begin(); itor != table->end(); ++itor, ++event_index) {
+          (*itor)["TIME"].set(time_cont[event_index]);
+        }
+      }
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["blocksize"] = 7;
+      pars["timeorder"] = ("par44" == test_name ? "yes" : "no");
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
+    } else if ("par46" == test_name || "par47" == test_name) {
+      // Test the incremental mode on the output of par31 with pulse phases replaced by -1, and with a spacecraft file
+      // extended by one row (par46) or with all positions moved by one meter (par47). Phases must be kept only if the
+      // rows of the spacecraft file around the events are unchanged. The phases are checked below.
+      tip::IFileSvc::instance().openFile(getMethod() + "_par31.fits").copyFile(out_file, true);
+      {
+        std::unique_ptr<tip::Table> table(tip::IFileSvc::instance().editTable(out_file, "EVENTS"));
+        for (tip::Table::Iterator itor = table->begin(); itor != table->end(); ++itor) {
+          (*itor)["PULSE_PHASE"].set(-1.);
+        }
+      }
+      std::string test_sc_file(getMethod() + "_" + test_name + "_sc.fits");
+      tip::IFileSvc::instance().openFile(sc_file).copyFile(test_sc_file, true);
+      {
+        std::unique_ptr<tip::Table> table(tip::IFileSvc::instance().editTable(test_sc_file, "SC_DATA"));
+        if ("par46" == test_name) {
+          // Append a row which starts at the stop time of the last row, with the same length and position.
+          double start = 0.;
+          double stop = 0.;
+          std::vector<double> position;
+          for (tip::Table::Iterator itor = table->begin(); itor != table->end(); ++itor) {
+            (*itor)["START"].get(start);
+            (*itor)["STOP"].get(stop);
+            (*itor)["SC_POSITION"].get(position);
+          }
+          tip::Index_t num_record = table->getNumRecords() + 1;
+          table->setNumRecords(num_record);
+          tip::Index_t record_index = 0;
+          for (tip::Table::Iterator itor = table->begin(); itor != table->end(); ++itor, ++record_index) {
+            if (num_record - 1 == record_index) {
+              (*itor)["START"].set(stop);
+              (*itor)["STOP"].set(stop + (stop - start));
+              (*itor)["SC_POSITION"].set(position);
+            }
+          }
+        } else {
+          std::vector<double> position;
+          for (tip::Table::Iterator itor = table->begin(); itor != table->end(); ++itor) {
+            (*itor)["SC_POSITION"].get(position);
+            position[0] += 1.;
+            (*itor)["SC_POSITION"].set(position);
+          }
+        }
+      }
+      pars["evfile"] = out_file;
+      pars["scfile"] = test_sc_file;
+      pars["psrname"] = "PSR B0540-69";
+      pars["ephstyle"] = "DB";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["matchsolareph"] = "NONE";
+      pars["incremental"] = "yes";
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
     } else {
       // Skip this iteration.
       continue;
@@ -780,6 +1519,137 @@ void PulsePhaseTestApp::testPulsePhaseApp() {
     // Test the application.
     app_tester.test(pars, log_file, log_file_ref, out_file, out_file_ref, ignore_exception);
   }
+
+  // Compare pulse phases computed by one thread and by three threads bit for bit, for one event file and for two
+  // event files processed concurrently.
+  comparePhaseColumn(getMethod() + "_par30.fits", "PULSE_PHASE", getMethod() + "_par29.fits", "PULSE_PHASE", 0.);
+  comparePhaseColumn(getMethod() + "_par41.fits", "PULSE_PHASE", getMethod() + "_par29.fits", "PULSE_PHASE", 0.);
+  comparePhaseColumn(getMethod() + "_par41_2.fits", "PULSE_PHASE", getMethod() + "_par29.fits", "PULSE_PHASE", 0.);
+  comparePhaseColumn(getMethod() + "_par42.fits", "PULSE_PHASE", getMethod() + "_par1a.fits", "PULSE_PHASE", 0.);
+  comparePhaseColumn(getMethod() + "_par42_2.fits", "PULSE_PHASE", getMethod() + "_par1a.fits", "PULSE_PHASE", 0.);
+
+  // Compare pulse phases of events processed in time order only from the first block out of order with those of
+  // events processed in the order of rows bit for bit.
+  comparePhaseColumn(getMethod() + "_par44.fits", "PULSE_PHASE", getMethod() + "_par45.fits", "PULSE_PHASE", 0.);
+
+  // Check that the incremental run with a different phase offset recomputed pulse phases of all events, instead of
+  // keeping the phases recorded by the previous run.
+  comparePhaseColumn(getMethod() + "_par32.fits", "PULSE_PHASE", getMethod() + "_par31.fits", "PULSE_PHASE", 1.e-9,
+    .25);
+
+  // Check that the incremental run with spacecraft data appended after the events (par46) kept the pulse phases of
+  // all events, which were replaced by -1, and that the run with spacecraft positions moved (par47) recomputed them.
+  std::vector<double> kept_phase_cont;
+  readEventColumn(getMethod() + "_par46.fits", "PULSE_PHASE", kept_phase_cont);
+  for (std::vector<double>::size_type event_index = 0; event_index < kept_phase_cont.size(); ++event_index) {
+    if (-1. != kept_phase_cont[event_index]) {
+      err() << "Phase " << kept_phase_cont[event_index] << " of event " << event_index << " in " << getMethod() <<
+        "_par46.fits was recomputed after spacecraft data were appended to the spacecraft file." << std::endl;
+      break;
+    }
+  }
+  comparePhaseColumn(getMethod() + "_par47.fits", "PULSE_PHASE", getMethod() + "_par31.fits", "PULSE_PHASE", 1.e-6);
+
+  // Check that the run with the cache of arrival times (par34) reproduces the phases of the run which wrote the
+  // cache (par33), and that a change of the solar system ephemeris (par35) or the source position (par36) changes
+  // the fingerprint of the cache and the phases.
+  const int num_cache_test = 4;
+  std::string cache_test_name[num_cache_test] = { "par33", "par34", "par35", "par36" };
+  std::string cache_fingerprint[num_cache_test];
+  for (int test_index = 0; test_index < num_cache_test; ++test_index) {
+    std::string out_file(getMethod() + "_" + cache_test_name[test_index] + ".fits");
+    std::unique_ptr<const tip::Table> table(tip::IFileSvc::instance().readTable(out_file, "EVENTS"));
+    try {
+      table->getHeader()["BARYCFP"].get(cache_fingerprint[test_index]);
+    } catch (const std::exception &) {
+      err() << "Keyword BARYCFP was not written in " << cache_test_name[test_index] << "." << std::endl;
+    }
+  }
+  std::string first_cache_file(getMethod() + "_" + cache_test_name[0] + ".fits");
+  for (int test_index = 1; test_index < num_cache_test; ++test_index) {
+    std::string out_file(getMethod() + "_" + cache_test_name[test_index] + ".fits");
+    if ("par34" == cache_test_name[test_index]) {
+      if (cache_fingerprint[test_index] != cache_fingerprint[0]) {
+        err() << "Fingerprint of the cache changed from " << cache_test_name[0] << " to " <<
+          cache_test_name[test_index] << " without a change of inputs." << std::endl;
+      }
+      comparePhaseColumn(out_file, "PULSE_PHASE", first_cache_file, "PULSE_PHASE", 1.e-6);
+    } else {
+      if (cache_fingerprint[test_index] == cache_fingerprint[0]) {
+        err() << "Fingerprint of the cache in " << cache_test_name[test_index] << " did not change after a change " <<
+          "of inputs of arrival time corrections." << std::endl;
+      }
+      double max_difference = comparePhaseColumn(out_file, "PULSE_PHASE", first_cache_file, "PULSE_PHASE",
+        std::numeric_limits<double>::infinity());
+      if (max_difference < 1.e-9) {
+        err() << "Pulse phases in " << cache_test_name[test_index] << " were computed from the stale cache of " <<
+          cache_test_name[0] << "." << std::endl;
+      }
+    }
+  }
+
+  // Compare each output column of the runs for two pulsars (par37, par39 and par40) with the PULSE_PHASE column of the
+  // run for each pulsar alone (par1a and par3a), and check that par40 read the cache written by par39.
+  std::string list_test_name[] = { "par37", "par39", "par40" };
+  for (int test_index = 0; test_index < 3; ++test_index) {
+    std::string out_file(getMethod() + "_" + list_test_name[test_index] + ".fits");
+    comparePhaseColumn(out_file, "PULSE_PHASE", getMethod() + "_par1a.fits", "PULSE_PHASE", 1.e-9);
+    comparePhaseColumn(out_file, "PHASE_J1959", getMethod() + "_par3a.fits", "PULSE_PHASE", 1.e-9);
+  }
+  std::string list_cache_fingerprint[2];
+  for (int test_index = 0; test_index < 2; ++test_index) {
+    std::string out_file(getMethod() + "_" + list_test_name[test_index + 1] + ".fits");
+    std::unique_ptr<const tip::Table> table(tip::IFileSvc::instance().readTable(out_file, "EVENTS"));
+    try {
+      table->getHeader()["BARYCFP"].get(list_cache_fingerprint[test_index]);
+    } catch (const std::exception &) {
+      err() << "Keyword BARYCFP was not written in " << list_test_name[test_index + 1] << "." << std::endl;
+    }
+  }
+  if (list_cache_fingerprint[0] != list_cache_fingerprint[1]) {
+    err() << "Fingerprint of the cache changed from par39 to par40 without a change of inputs." << std::endl;
+  }
+
+  // Check phases and cached arrival times of events inside and outside the region of interest of par38. Events too
+  // close to the edge of the region to be classified reliably are skipped.
+  std::vector<double> roi_phase_cont;
+  std::vector<double> roi_cache_cont;
+  std::vector<double> all_phase_cont;
+  readEventColumn(getMethod() + "_par38.fits", "PULSE_PHASE", roi_phase_cont);
+  readEventColumn(getMethod() + "_par38.fits", "BARY_TIME", roi_cache_cont);
+  readEventColumn(getMethod() + "_par1b.fits", "PULSE_PHASE", all_phase_cont);
+  if (roi_phase_cont.size() != separation_cont.size() || all_phase_cont.size() != separation_cont.size()) {
+    err() << "Number of events differs among the event file, par1b and par38." << std::endl;
+  } else {
+    long num_inside = 0;
+    long num_outside = 0;
+    for (std::vector<double>::size_type event_index = 0; event_index < separation_cont.size(); ++event_index) {
+      if (std::fabs(separation_cont[event_index] - roi_radius) < 1.e-6) continue;
+      if (separation_cont[event_index] > roi_radius) {
+        ++num_outside;
+        if (!std::isnan(roi_phase_cont[event_index]) || !std::isnan(roi_cache_cont[event_index])) {
+          err() << "Event " << event_index << " outside the region of interest of par38 has pulse phase " <<
+            roi_phase_cont[event_index] << " and arrival time " << roi_cache_cont[event_index] << ", not NaN." <<
+            std::endl;
+          break;
+        }
+      } else {
+        ++num_inside;
+        double difference = std::fabs(roi_phase_cont[event_index] - all_phase_cont[event_index]);
+        difference = std::min(difference, 1. - difference);
+        if (!(difference <= 1.e-9) || std::isnan(roi_cache_cont[event_index])) {
+          err() << "Event " << event_index << " inside the region of interest of par38 has pulse phase " <<
+            roi_phase_cont[event_index] << " and arrival time " << roi_cache_cont[event_index] << ", not pulse phase " <<
+            all_phase_cont[event_index] << " of par1b and a corrected arrival time." << std::endl;
+          break;
+        }
+      }
+    }
+    if (0 == num_inside || 0 == num_outside) {
+      err() << "Region of interest of par38 with radius " << roi_radius << " degrees did not divide the events: " <<
+        num_inside << " inside and " << num_outside << " outside." << std::endl;
+    }
+  }
 }
 
 void PulsePhaseTestApp::testOrbitalPhaseApp() {
@@ -805,6 +1675,11 @@ void PulsePhaseTestApp::testOrbitalPhaseApp() {
   test_name_cont.push_back("par8");
   test_name_cont.push_back("par9");
   test_name_cont.push_back("par10");
+  test_name_cont.push_back("par11");
+  test_name_cont.push_back("par12");
+  test_name_cont.push_back("par13");
+  test_name_cont.push_back("par14");
+  test_name_cont.push_back("par15");
 
   // Prepare files to be used in the tests.
   std::string ev_file = prependDataPath("testevdata_1day_unordered.fits");
@@ -838,9 +1713,26 @@ void PulsePhaseTestApp::testOrbitalPhaseApp() {
     pars["angtol"] = 1.e-8;
     pars["evtable"] = "EVENTS";
     pars["timefield"] = "TIME";
+    pars["outfile"] = "NONE";
     pars["sctable"] = "SC_DATA";
     pars["ophasefield"] = "ORBITAL_PHASE";
     pars["ophaseoffset"] = 0.;
+    pars["blocksize"] = 10000;
+    pars["nthreads"] = 1;
+    pars["barytol"] = 0.;
+    pars["filethreads"] = 1;
+    pars["perfreport"] = "no";
+    pars["perffile"] = "NONE";
+    pars["incremental"] = "no";
+    pars["psrdbcache"] = "NONE";
+    pars["timeorder"] = "yes";
+    pars["barycol"] = "NONE";
+    pars["roiradius"] = 0.;
+    pars["scwindow"] = 0;
+    pars["scindex"] = "NONE";
+    pars["nbins"] = 0;
+    pars["profile"] = "NONE";
+    pars["weightfield"] = "NONE";
     pars["leapsecfile"] = "DEFAULT";
     pars["reportephstatus"] = "yes";
     pars["chatter"] = 2;
@@ -1092,6 +1984,107 @@ void PulsePhaseTestApp::testOrbitalPhaseApp() {
       out_file_ref.erase();
       ignore_exception = true;
 
+    } else if ("par11" == test_name) {
+      // Test processing in small blocks of events, which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1834-0010";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["ra"] = 85.0482; // Note: Need to use those wrong RA & Dec to match the reference output.
+      pars["dec"] = -69.3319;
+      pars["matchsolareph"] = "NONE";
+      pars["blocksize"] = 7;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par12" == test_name) {
+      // Test phase computation in multiple threads, which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1834-0010";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["ra"] = 85.0482; // Note: Need to use those wrong RA & Dec to match the reference output.
+      pars["dec"] = -69.3319;
+      pars["matchsolareph"] = "NONE";
+      pars["blocksize"] = 7;
+      pars["nthreads"] = 3;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par13" == test_name) {
+      // Test interpolated barycentric corrections, which must produce the same result as par1a.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1834-0010";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["ra"] = 85.0482; // Note: Need to use those wrong RA & Dec to match the reference output.
+      pars["dec"] = -69.3319;
+      pars["matchsolareph"] = "NONE";
+      pars["barytol"] = 1.e-10;
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par14" == test_name) {
+      // Test writing phases into an output file, leaving the input event file intact, which must produce the same
+      // result as par1a.
+      remove(out_file.c_str());
+      pars["evfile"] = ev_file;
+      pars["outfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1834-0010";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["ra"] = 85.0482; // Note: Need to use those wrong RA & Dec to match the reference output.
+      pars["dec"] = -69.3319;
+      pars["matchsolareph"] = "NONE";
+      out_file_ref = prependOutrefPath(getMethod() + "_par1a.fits");
+      log_file.erase();
+      log_file_ref.erase();
+
+    } else if ("par15" == test_name) {
+      // Test two event files processed concurrently, each by three threads. The orbital phases of both event files are
+      // compared below bit for bit with those computed by one thread in par1a.
+      std::string out_file2(getMethod() + "_" + test_name + "_2.fits");
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file2, true);
+      std::string list_file(getMethod() + "_" + test_name + ".lis");
+      remove(list_file.c_str());
+      std::ofstream ofs_list(list_file.c_str());
+      ofs_list << out_file2 << std::endl;
+      ofs_list << out_file << std::endl;
+      ofs_list.close();
+      pars["evfile"] = "@" + list_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1834-0010";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["ra"] = 85.0482; // Note: Need to use those wrong RA & Dec to match the reference output.
+      pars["dec"] = -69.3319;
+      pars["matchsolareph"] = "NONE";
+      pars["blocksize"] = 7;
+      pars["nthreads"] = 3;
+      pars["filethreads"] = 2;
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
+    } else if ("par16" == test_name) {
+      // Test orbital phase computation for the pulsar of testPulsePhaseApp par20, to compare orbital phases below.
+      tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+      pars["evfile"] = out_file;
+      pars["scfile"] = sc_file;
+      pars["psrname"] = "PSR J1959+2048";
+      pars["psrdbfile"] = test_pulsardb;
+      pars["srcposition"] = "DB";
+      pars["matchsolareph"] = "NONE";
+      log_file.erase();
+      log_file_ref.erase();
+      out_file_ref.erase();
+
     } else {
       // Skip this iteration.
       continue;
@@ -1100,6 +2093,500 @@ void PulsePhaseTestApp::testOrbitalPhaseApp() {
     // Test the application.
     app_tester.test(pars, log_file, log_file_ref, out_file, out_file_ref, ignore_exception);
   }
+
+  // Compare orbital phases computed by gtpphase along with pulse phases (testPulsePhaseApp par20) with those computed
+  // by gtophase from the same event file.
+  comparePhaseColumn("testPulsePhaseApp_par20.fits", "ORBITAL_PHASE", getMethod() + "_par16.fits", "ORBITAL_PHASE",
+    1.e-9);
+
+  // Compare orbital phases of two event files processed concurrently by three threads each with those computed by one
+  // thread bit for bit.
+  comparePhaseColumn(getMethod() + "_par15.fits", "ORBITAL_PHASE", getMethod() + "_par1a.fits", "ORBITAL_PHASE", 0.);
+  comparePhaseColumn(getMethod() + "_par15_2.fits", "ORBITAL_PHASE", getMethod() + "_par1a.fits", "ORBITAL_PHASE", 0.);
+}
+
+void PulsePhaseTestApp::testPhaseServer() {
+  setMethod("testPhaseServer");
+
+  // Prepare files to be used in the test.
+  std::string ev_file = prependDataPath("testevdata_1day_unordered.fits");
+  std::string sc_file = prependDataPath("testscdata_1day.fits");
+  std::string test_pulsardb = prependDataPath("testpsrdb_ephcomp.fits");
+  std::string out_file(getMethod() + "_par1a.fits");
+  std::string cli_out_file("testPulsePhaseApp_par1a.fits");
+  std::string socket_name(getMethod() + ".sock");
+  tip::IFileSvc::instance().openFile(ev_file).copyFile(out_file, true);
+
+  // Start a server in a child process, with the socket created in this process so that it is ready for a job.
+  std::unique_ptr<PhaseServer> server(new PhaseServer(socket_name, 1));
+  struct stat socket_status;
+  if (0 != stat(socket_name.c_str(), &socket_status)) {
+    err() << "Socket \"" << socket_name << "\" was not created." << std::endl;
+  } else if ((S_IRUSR | S_IWUSR) != (socket_status.st_mode & 0777)) {
+    err() << "Socket \"" << socket_name << "\" was created with mode " << std::oct << (socket_status.st_mode & 0777) <<
+      std::dec << ", not 600." << std::endl;
+  }
+  std::cout.flush();
+  std::cerr.flush();
+  pid_t server_pid = fork();
+  if (-1 == server_pid) {
+    err() << "Cannot start a server in a child process." << std::endl;
+    return;
+  } else if (0 == server_pid) {
+    try {
+      server->loadResource("DEFAULT", "JPL DE405", "NONE");
+      server->run();
+    } catch (const std::exception & x) {
+      std::cerr << "PhaseServer::run threw an exception: " << x.what() << std::endl;
+    }
+    _exit(1);
+  }
+
+  // Submit a job with the same parameters as par1a of testPulsePhaseApp.
+  PhaseServer::ParCont par_cont;
+  par_cont.push_back(std::make_pair("evfile", out_file));
+  par_cont.push_back(std::make_pair("scfile", sc_file));
+  par_cont.push_back(std::make_pair("psrdbfile", test_pulsardb));
+  par_cont.push_back(std::make_pair("psrname", "PSR B0540-69"));
+  par_cont.push_back(std::make_pair("ephstyle", "DB"));
+  par_cont.push_back(std::make_pair("matchsolareph", "NONE"));
+  std::ostringstream job_os;
+  int exit_status = -1;
+  try {
+    exit_status = PhaseServer::submitJob(socket_name, par_cont, job_os);
+  } catch (const std::exception & x) {
+    err() << "PhaseServer::submitJob threw an exception: " << x.what() << std::endl;
+  }
+  if (0 != exit_status) {
+    err() << "Job submitted to the server exited with status " << exit_status << ", with messages:" << std::endl <<
+      job_os.str() << std::endl;
+  }
+
+  // Stop the server.
+  kill(server_pid, SIGTERM);
+  waitpid(server_pid, 0, 0);
+  server.reset(0);
+  if (0 != exit_status) return;
+
+  // Compare pulse phases computed by the server with those computed by gtpphase for par1a of testPulsePhaseApp bit
+  // for bit.
+  comparePhaseColumn(out_file, "PULSE_PHASE", cli_out_file, "PULSE_PHASE", 0.);
+}
+
+void PulsePhaseTestApp::testPhaseEngine() {
+  setMethod("testPhaseEngine");
+
+  // Read event times, and pulse phases computed for them by par1a of testPulsePhaseApp.
+  std::string sc_file = prependDataPath("testscdata_1day.fits");
+  std::string test_pulsardb = prependDataPath("testpsrdb_ephcomp.fits");
+  std::string out_file_ref = prependOutrefPath("testPulsePhaseApp_par1a.fits");
+  std::vector<double> time_cont;
+  std::vector<double> phase_ref_cont;
+  readEventColumn(out_file_ref, "TIME", time_cont);
+  readEventColumn(out_file_ref, "PULSE_PHASE", phase_ref_cont);
+
+  // Set up a PhaseEngine object in the same way as par1a.
+  pulsarDb::StrictEphChooser chooser;
+  pulsarDb::EphComputer computer(chooser);
+  PhaseEngine::loadEph(test_pulsardb, "PSR B0540-69", computer);
+  PhaseEngine::Setting setting;
+  setting.m_sc_file = sc_file;
+  setting.m_bary_tol = 0.;
+  setting.m_vary_ra_dec = true;
+  PhaseEngine engine(computer, chooser, setting);
+
+  // Compute pulse phases by two threads at the same time, each for a half of the events.
+  std::vector<double> phase_cont(time_cont.size());
+  std::vector<double>::size_type num_half = time_cont.size() / 2;
+  std::exception_ptr error;
+  std::thread worker([&]() {
+    try {
+      engine.computePhase(&time_cont[0], &time_cont[0] + num_half, &phase_cont[0]);
+    } catch (...) {
+      error = std::current_exception();
+    }
+  });
+  try {
+    engine.computePhase(&time_cont[0] + num_half, &time_cont[0] + time_cont.size(), &phase_cont[0] + num_half);
+  } catch (const std::exception & x) {
+    err() << "PhaseEngine::computePhase threw an exception: " << x.what() << std::endl;
+  }
+  worker.join();
+  if (error) {
+    try {
+      std::rethrow_exception(error);
+    } catch (const std::exception & x) {
+      err() << "PhaseEngine::computePhase threw an exception in another thread: " << x.what() << std::endl;
+    }
+  }
+
+  // Compare the pulse phases with those computed by gtpphase.
+  double epsilon = 1.e-6;
+  for (std::vector<double>::size_type event_index = 0; event_index < time_cont.size(); ++event_index) {
+    double difference = std::fabs(phase_cont[event_index] - phase_ref_cont[event_index]);
+    difference = std::min(difference, 1. - difference);
+    if (difference > epsilon) {
+      err() << "PhaseEngine::computePhase returned pulse phase " << phase_cont[event_index] << " for event time " <<
+        time_cont[event_index] << ", not " << phase_ref_cont[event_index] << " as expected." << std::endl;
+    }
+  }
+
+  // Compute phases by four threads at the same time, each for a quarter of the events in blocks of a few events, so
+  // that the threads go through many blocks concurrently. This is done for pulse phases from the table of polynomials
+  // with the same reference as above, and for orbital phases with the reference computed by par1a of
+  // testOrbitalPhaseApp.
+  std::vector<double> orbital_time_cont;
+  std::vector<double> orbital_phase_ref_cont;
+  std::string orbital_out_file_ref(prependOutrefPath("testOrbitalPhaseApp_par1a.fits"));
+  readEventColumn(orbital_out_file_ref, "TIME", orbital_time_cont);
+  readEventColumn(orbital_out_file_ref, "ORBITAL_PHASE", orbital_phase_ref_cont);
+  pulsarDb::EphComputer orbital_computer(chooser);
+  PhaseEngine::loadEph(test_pulsardb, "PSR J1834-0010", orbital_computer);
+  PhaseEngine::Setting pulse_setting(setting);
+  pulse_setting.m_bary_tol = 1.e-10;
+  pulse_setting.m_block_size = 7;
+  PhaseEngine::Setting orbital_setting;
+  orbital_setting.m_phase_type = PhaseEngine::ORBITAL_PHASE;
+  orbital_setting.m_sc_file = sc_file;
+  orbital_setting.m_bary_tol = 0.;
+  orbital_setting.m_ra = 85.0482;
+  orbital_setting.m_dec = -69.3319;
+  orbital_setting.m_block_size = 7;
+  std::string phase_name_cont[] = { "pulse", "orbital" };
+  PhaseEngine pulse_engine(computer, chooser, pulse_setting);
+  PhaseEngine orbital_engine(orbital_computer, chooser, orbital_setting);
+  const PhaseEngine * engine_cont[] = { &pulse_engine, &orbital_engine };
+  const std::vector<double> * time_ref_cont[] = { &time_cont, &orbital_time_cont };
+  const std::vector<double> * phase_expected_cont[] = { &phase_ref_cont, &orbital_phase_ref_cont };
+  for (int engine_index = 0; engine_index < 2; ++engine_index) {
+    const std::vector<double> & engine_time_cont(*time_ref_cont[engine_index]);
+    const std::vector<double> & engine_phase_ref_cont(*phase_expected_cont[engine_index]);
+    std::vector<double> engine_phase_cont(engine_time_cont.size());
+    const int num_thread = 4;
+    std::vector<double>::size_type range_size = (engine_time_cont.size() + num_thread - 1) / num_thread;
+    std::vector<std::exception_ptr> error_cont(num_thread);
+    std::vector<std::thread> thread_cont;
+    for (int thread_index = 0; thread_index < num_thread; ++thread_index) {
+      std::vector<double>::size_type range_begin = std::min(range_size * thread_index, engine_time_cont.size());
+      std::vector<double>::size_type range_end = std::min(range_begin + range_size, engine_time_cont.size());
+      const PhaseEngine & engine_ref(*engine_cont[engine_index]);
+      thread_cont.push_back(std::thread([&, range_begin, range_end, thread_index]() {
+        try {
+          engine_ref.computePhase(&engine_time_cont[0] + range_begin, &engine_time_cont[0] + range_end,
+            &engine_phase_cont[0] + range_begin);
+        } catch (...) {
+          error_cont[thread_index] = std::current_exception();
+        }
+      }));
+    }
+    for (std::vector<std::thread>::iterator itor = thread_cont.begin(); itor != thread_cont.end(); ++itor) itor->join();
+    bool failed = false;
+    for (std::vector<std::exception_ptr>::iterator itor = error_cont.begin(); itor != error_cont.end(); ++itor) {
+      if (!*itor) continue;
+      failed = true;
+      try {
+        std::rethrow_exception(*itor);
+      } catch (const std::exception & x) {
+        err() << "PhaseEngine::computePhase threw an exception in one of four threads computing " <<
+          phase_name_cont[engine_index] << " phases: " << x.what() << std::endl;
+      }
+    }
+    if (failed) continue;
+    for (std::vector<double>::size_type event_index = 0; event_index < engine_time_cont.size(); ++event_index) {
+      double difference = std::fabs(engine_phase_cont[event_index] - engine_phase_ref_cont[event_index]);
+      difference = std::min(difference, 1. - difference);
+      if (difference > epsilon) {
+        err() << "PhaseEngine::computePhase returned " << phase_name_cont[engine_index] << " phase " <<
+          engine_phase_cont[event_index] << " for event time " << engine_time_cont[event_index] << " in one of four " <<
+          "threads, not " << engine_phase_ref_cont[event_index] << " as expected." << std::endl;
+      }
+    }
+  }
+}
+
+void PulsePhaseTestApp::testPhaseProfile() {
+  setMethod("testPhaseProfile");
+
+  // Fill a histogram with phases at bin edges and beyond, with and without weights.
+  PhaseProfile profile(4);
+  double phase_array[] = { 0., .25, .3, .999999, 1., std::numeric_limits<double>::quiet_NaN() };
+  double weight_array[] = { 2., 1., .5, 1., 3., 1. };
+  profile.fill(phase_array, phase_array + 6);
+  PhaseProfile weighted_profile(4);
+  weighted_profile.fill(phase_array, phase_array + 6, weight_array);
+  profile.merge(weighted_profile);
+
+  // Compare the contents with expected values.
+  double count_array[] = { 3., 3.5, 0., 6. };
+  double square_sum_array[] = { 5., 3.25, 0., 12. };
+  for (long bin_index = 0; bin_index < profile.getNumBin(); ++bin_index) {
+    if (count_array[bin_index] != profile.getCount()[bin_index]) {
+      err() << "PhaseProfile::getCount returned " << profile.getCount()[bin_index] << " for bin " << bin_index <<
+        ", not " << count_array[bin_index] << " as expected." << std::endl;
+    }
+    if (square_sum_array[bin_index] != profile.getSquareSum()[bin_index]) {
+      err() << "PhaseProfile::getSquareSum returned " << profile.getSquareSum()[bin_index] << " for bin " << bin_index <<
+        ", not " << square_sum_array[bin_index] << " as expected." << std::endl;
+    }
+  }
+
+  // Test merging histograms with different numbers of bins.
+  try {
+    profile.merge(PhaseProfile(5));
+    err() << "PhaseProfile::merge did not throw an exception for histograms with different numbers of bins." <<
+      std::endl;
+  } catch (const std::exception &) {
+    // This is fine.
+  }
+}
+
+void PulsePhaseTestApp::testPeriodicityTest() {
+  setMethod("testPeriodicityTest");
+
+  // Test phases evenly spaced over a cycle, for which all moments vanish.
+  std::vector<double> phase_cont(1000);
+  for (std::vector<double>::size_type index = 0; index < phase_cont.size(); ++index) phase_cont[index] = index / 1000.;
+  PeriodicityTest uniform_test(20);
+  uniform_test.fill(&phase_cont[0], &phase_cont[0] + phase_cont.size());
+  double z2 = uniform_test.computeZ2(20);
+  if (std::fabs(z2) > 1.e-6) {
+    err() << "PeriodicityTest::computeZ2 returned " << z2 << " for evenly spaced phases, not 0 as expected." << std::endl;
+  }
+
+  // Test identical phases, filled in two parts and merged, for which Z^2_m = 2 * N * m, and H = Z^2_20 - 76.
+  std::vector<double> pulse_cont(1000, .25);
+  PeriodicityTest pulse_test(20);
+  pulse_test.fill(&pulse_cont[0], &pulse_cont[0] + 400);
+  PeriodicityTest other_test(20);
+  other_test.fill(&pulse_cont[0] + 400, &pulse_cont[0] + pulse_cont.size());
+  pulse_test.merge(other_test);
+  if (1000 != pulse_test.getNumEvent()) {
+    err() << "PeriodicityTest::getNumEvent returned " << pulse_test.getNumEvent() << ", not 1000 as expected." <<
+      std::endl;
+  }
+  for (long harmonic = 1; harmonic <= 20; ++harmonic) {
+    z2 = pulse_test.computeZ2(harmonic);
+    if (std::fabs(z2 - 2000. * harmonic) > 1.e-6 * z2) {
+      err() << "PeriodicityTest::computeZ2(" << harmonic << ") returned " << z2 << " for identical phases, not " <<
+        2000. * harmonic << " as expected." << std::endl;
+    }
+  }
+  long h_harmonic = 0;
+  double h = pulse_test.computeH(h_harmonic);
+  if (20 != h_harmonic || std::fabs(h - 39924.) > 1.e-6 * h) {
+    err() << "PeriodicityTest::computeH returned " << h << " at " << h_harmonic <<
+      " harmonics for identical phases, not 39924 at 20 harmonics as expected." << std::endl;
+  }
+
+  // Test chance probabilities and significance.
+  double log_prob = PeriodicityTest::computeZ2LogProbability(10., 1);
+  if (std::fabs(log_prob + 5.) > 1.e-9) {
+    err() << "PeriodicityTest::computeZ2LogProbability(10, 1) returned " << log_prob << ", not -5 as expected." <<
+      std::endl;
+  }
+  double sigma = PeriodicityTest::computeSigma(std::log(1.3498980316e-3));
+  if (std::fabs(sigma - 3.) > 1.e-6) {
+    err() << "PeriodicityTest::computeSigma returned " << sigma << " for a chance probability of 3 sigma, not 3 as " <<
+      "expected." << std::endl;
+  }
+}
+
+void PulsePhaseTestApp::testEphemerisSearch() {
+  setMethod("testEphemerisSearch");
+
+  // Create events which arrive at phase 0 of a pulsar whose frequency is higher than that of the ephemeris by 2.e-6 Hz.
+  PhaseTime epoch(55000, 0.);
+  double f0_offset = 2.e-6;
+  std::vector<PhaseTime> time_cont;
+  std::vector<double> phase_cont;
+  for (long event_index = 0; event_index < 10000; ++event_index) {
+    double elapsed_time = (event_index - 5000) * 10.;
+    PhaseTime event_time(epoch);
+    event_time += elapsed_time;
+    time_cont.push_back(event_time);
+    double phase = -f0_offset * elapsed_time;
+    phase_cont.push_back(phase - std::floor(phase));
+  }
+  EphemerisSearch search(epoch);
+  search.add(&time_cont[0], &phase_cont[0], &phase_cont[0] + 4000);
+  EphemerisSearch other_search(epoch);
+  other_search.add(&time_cont[0] + 4000, &phase_cont[0] + 4000, &phase_cont[0] + phase_cont.size());
+  search.merge(other_search);
+
+  // Search a grid which contains the true frequency, by two threads.
+  EphemerisSearch::TrialCont trial_cont;
+  search.search(5, 1.e-6, 3, 1.e-10, 2, 2, trial_cont);
+  if (15 != trial_cont.size()) {
+    err() << "EphemerisSearch::search returned " << trial_cont.size() << " trials, not 15 as expected." << std::endl;
+  } else {
+    const EphemerisSearch::Trial & trial(trial_cont[9]);
+    if (std::fabs(trial.m_f0_offset - f0_offset) > 1.e-12 || 0. != trial.m_f1_offset) {
+      err() << "EphemerisSearch::search returned trial offsets (" << trial.m_f0_offset << ", " << trial.m_f1_offset <<
+        "), not (" << f0_offset << ", 0) as expected." << std::endl;
+    }
+    double z2 = 2. * 2. * search.getNumEvent();
+    if (std::fabs(trial.m_z2 - z2) > 1.e-6 * z2) {
+      err() << "EphemerisSearch::search returned Z^2_2 statistic " << trial.m_z2 << " at the true frequency, not " <<
+        z2 << " as expected." << std::endl;
+    }
+    for (EphemerisSearch::TrialCont::const_iterator itor = trial_cont.begin(); itor != trial_cont.end(); ++itor) {
+      if (itor->m_h > trial.m_h) {
+        err() << "EphemerisSearch::search returned H-test statistic " << itor->m_h << " at frequency offset " <<
+          itor->m_f0_offset << ", larger than " << trial.m_h << " at the true frequency." << std::endl;
+      }
+    }
+  }
+}
+
+void PulsePhaseTestApp::testCachedEphChooser() {
+  setMethod("testCachedEphChooser");
+
+  // Create spin ephemerides whose validity windows overlap, leave a gap, and touch each other, in seconds since the
+  // origin below.
+  timeSystem::AbsoluteTime origin("TDB", timeSystem::Mjd(55000, 0.));
+  double window_array[][2] = { { 0., 10000. }, { 5000., 20000. }, { 30000., 40000. }, { 40000., 50000. } };
+  std::vector<std::unique_ptr<pulsarDb::PulsarEph> > eph_holder;
+  pulsarDb::PulsarEphCont eph_cont;
+  for (std::size_t eph_index = 0; eph_index < sizeof(window_array) / sizeof(window_array[0]); ++eph_index) {
+    timeSystem::AbsoluteTime valid_since(origin + timeSystem::ElapsedTime("TDB",
+      timeSystem::Duration(0, window_array[eph_index][0])));
+    timeSystem::AbsoluteTime valid_until(origin + timeSystem::ElapsedTime("TDB",
+      timeSystem::Duration(0, window_array[eph_index][1])));
+    eph_holder.push_back(std::unique_ptr<pulsarDb::PulsarEph>(new pulsarDb::FrequencyEph("TDB", valid_since,
+      valid_until, valid_since, 0., 0., 0., 1. + eph_index, 0., 0.)));
+    eph_cont.push_back(eph_holder.back().get());
+  }
+
+  // Prepare times on a regular grid, and times around every boundary of validity windows, within and beyond the
+  // guard margin of 1 second around segment boundaries.
+  std::vector<double> elapsed_cont;
+  for (double elapsed = -2000.; elapsed <= 52000.; elapsed += 250.) elapsed_cont.push_back(elapsed);
+  double offset_array[] = { -2., -1.001, -1., -.999, -.5, -1.e-6, 0., 1.e-6, .5, .999, 1., 1.001, 2. };
+  for (std::size_t eph_index = 0; eph_index < sizeof(window_array) / sizeof(window_array[0]); ++eph_index) {
+    for (int edge_index = 0; edge_index < 2; ++edge_index) {
+      for (std::size_t offset_index = 0; offset_index < sizeof(offset_array) / sizeof(double); ++offset_index) {
+        elapsed_cont.push_back(window_array[eph_index][edge_index] + offset_array[offset_index]);
+      }
+    }
+  }
+  std::sort(elapsed_cont.begin(), elapsed_cont.end());
+
+  // Compare choices in ascending order, in descending order, and in an order jumping between segments, with those of
+  // the choosers to which the searches are delegated. Where the chooser throws an exception, so must the cached one.
+  std::vector<std::vector<double> > order_cont;
+  order_cont.push_back(elapsed_cont);
+  order_cont.push_back(std::vector<double>(elapsed_cont.rbegin(), elapsed_cont.rend()));
+  order_cont.push_back(std::vector<double>());
+  for (std::vector<double>::size_type index = 0; index < elapsed_cont.size(); ++index) {
+    order_cont.back().push_back(elapsed_cont[(index * 37) % elapsed_cont.size()]);
+  }
+  pulsarDb::StrictEphChooser strict_chooser;
+  pulsarDb::SloppyEphChooser sloppy_chooser;
+  const pulsarDb::EphChooser * chooser_array[] = { &strict_chooser, &sloppy_chooser };
+  std::string chooser_name_array[] = { "StrictEphChooser", "SloppyEphChooser" };
+  for (int chooser_index = 0; chooser_index < 2; ++chooser_index) {
+    const pulsarDb::EphChooser & chooser(*chooser_array[chooser_index]);
+    for (std::vector<std::vector<double> >::const_iterator order_itor = order_cont.begin(); order_itor != order_cont.end();
+      ++order_itor) {
+      CachedEphChooser cached_chooser(chooser);
+      for (std::vector<double>::const_iterator itor = order_itor->begin(); itor != order_itor->end(); ++itor) {
+        timeSystem::AbsoluteTime abs_time(origin + timeSystem::ElapsedTime("TDB", timeSystem::Duration(0, *itor)));
+        const pulsarDb::PulsarEph * expected_eph = 0;
+        const pulsarDb::PulsarEph * result_eph = 0;
+        try {
+          expected_eph = &chooser.choose(eph_cont, abs_time);
+        } catch (const std::exception &) {
+          // Leave expected_eph null.
+        }
+        try {
+          result_eph = &cached_chooser.choose(eph_cont, abs_time);
+        } catch (const std::exception &) {
+          // Leave result_eph null.
+        }
+        if (expected_eph != result_eph) {
+          err() << "CachedEphChooser::choose with " << chooser_name_array[chooser_index] << " chose " <<
+            (result_eph ? "an ephemeris" : "no ephemeris") << " different from the one chosen by the chooser itself " <<
+            "for " << *itor << " seconds after 55000.0 MJD (TDB)." << std::endl;
+        }
+      }
+    }
+  }
+}
+
+void PulsePhaseTestApp::testDelayTable() {
+  setMethod("testDelayTable");
+
+  // Tabulate a function that mimics a barycentric delay: a smooth oscillation, plus an oscillation interpolated
+  // linearly between rows every 30 seconds, which changes its slope abruptly at every row. The fourth derivative of
+  // the function is bounded by that of the smooth oscillation in every interval between rows.
+  const double amplitude = 1.e-2;
+  const double frequency = 2. * M_PI / 600.;
+  const double row_interval = 30.;
+  const double tolerance = 1.e-9;
+  long num_evaluation = 0;
+  DelayTable::FunctionType function = [&](double time) {
+    ++num_evaluation;
+    double row_index = std::floor(time / row_interval);
+    double row_value = std::sin(row_index);
+    double next_row_value = std::sin(row_index + 1.);
+    double fraction = time / row_interval - row_index;
+    return amplitude * std::sin(frequency * time) + row_value + fraction * (next_row_value - row_value);
+  };
+  DelayTable::IntervalFunctionType interval_function = [&](double time) {
+    double start = std::floor(time / row_interval) * row_interval;
+    DelayTable::Interval interval = { start, start + row_interval, amplitude * std::pow(frequency, 4) };
+    return interval;
+  };
+
+  // Check the interpolation error for times dense enough for cells to be built, and check that the function is
+  // computed fewer times than requested.
+  DelayTable dense_table(function, interval_function, tolerance);
+  long num_time = 0;
+  for (double time = 0.; time < 3000.; time += .37, ++num_time) {
+    double result = dense_table.compute(time);
+    double expected = function(time);
+    if (!(std::fabs(result - expected) <= tolerance)) {
+      err() << "DelayTable::compute returned " << result << " for time " << time << ", not within " << tolerance <<
+        " of the expected value " << expected << "." << std::endl;
+      break;
+    }
+  }
+  if (!(dense_table.getNumEvaluation() < num_time / 4)) {
+    err() << "DelayTable computed the function " << dense_table.getNumEvaluation() << " times for " << num_time <<
+      " dense times, not fewer than " << num_time / 4 << " times." << std::endl;
+  }
+
+  // Check that the function is computed no more times than requested for sparse times, for which the table is not
+  // worth building.
+  DelayTable sparse_table(function, interval_function, tolerance);
+  num_time = 0;
+  for (double time = 0.; time < 3000.; time += 61., ++num_time) {
+    double result = sparse_table.compute(time);
+    double expected = function(time);
+    if (!(std::fabs(result - expected) <= tolerance)) {
+      err() << "DelayTable::compute returned " << result << " for sparse time " << time << ", not within " <<
+        tolerance << " of the expected value " << expected << "." << std::endl;
+      break;
+    }
+  }
+  if (sparse_table.getNumEvaluation() > num_time) {
+    err() << "DelayTable computed the function " << sparse_table.getNumEvaluation() << " times for " << num_time <<
+      " sparse times." << std::endl;
+  }
+
+  // Check that a step in a function, which violates the bound of the fourth derivative, is detected, and the function
+  // is computed directly around the step.
+  DelayTable::FunctionType step_function = [](double time) { return 1.e-3 * time + (time < 1000.5 ? 0. : 1.); };
+  DelayTable step_table(step_function, tolerance, 0.);
+  for (double time = 0.; time < 3600.; time += .5) {
+    double result = step_table.compute(time);
+    double expected = step_function(time);
+    if (!(std::fabs(result - expected) <= tolerance)) {
+      err() << "DelayTable::compute returned " << result << " for time " << time << " around a step, not within " <<
+        tolerance << " of the expected value " << expected << "." << std::endl;
+      break;
+    }
+  }
 }
 
 st_app::StAppFactory<PulsePhaseTestApp> g_factory("test_pulsePhase");